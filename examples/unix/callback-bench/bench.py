@@ -0,0 +1,94 @@
+import nespy
+import utime
+
+# Compares python thread callbacks delivered one event per call with the
+# batched delivery of nespy.Thread(callback=cb, batch=n). Both are first
+# checked to deliver the data of a burst of posts in order.
+#
+#      micropython bench.py
+
+EVENTS = 50000
+BURST = 200     # events posted before the scheduler runs, below the queue max
+BATCH = 64
+
+process = nespy.Process()
+init = nespy.Init()
+
+count = 0
+
+def per_call(ev, data):
+    global count
+    count += 1
+
+def batched(events, data):
+    global count
+    count += len(events)
+
+def drain():
+    while process.run():
+        pass
+
+def check(batch):
+    received = []
+    def per_call_data(ev, data):
+        received.append(data)
+    def batched_data(events, data):
+        received.extend(data)
+    thread = nespy.Thread(callback=batched_data if batch else per_call_data,
+                          batch=batch)
+    thread.start()
+    drain()
+    event = process.alloc_event()
+    for i in range(BURST):
+        thread.post(event, i)
+    drain()
+    thread.delete()
+    drain()
+    return received == list(range(BURST))
+
+def bench(callback, batch):
+    global count
+    thread = nespy.Thread(callback=callback, batch=batch)
+    thread.start()
+    drain()
+    event = process.alloc_event()
+    count = 0
+    elapsed = 0
+    posted = 0
+    while posted < EVENTS:
+        for i in range(BURST):
+            thread.post(event, None)
+        posted += BURST
+        # only the dispatch is timed, not the posting from python
+        start = utime.ticks_us()
+        drain()
+        elapsed += utime.ticks_diff(utime.ticks_us(), start)
+    thread.delete()
+    drain()
+    return count, elapsed
+
+def main():
+    init.node_id(1)
+    init.protocol()
+
+    for batch in (0, BATCH):
+        if not check(batch):
+            print("FAIL: batch %d delivered the posted data out of order" % batch)
+            return
+
+    n, us = bench(per_call, 0)
+    per_call_rate = n * 1000000 // us
+    print("per-call: %d events in %d us, %d events/s" % (n, us, per_call_rate))
+
+    n, us = bench(batched, BATCH)
+    batched_rate = n * 1000000 // us
+    print("batched(%d): %d events in %d us, %d events/s" % (BATCH, n, us, batched_rate))
+
+    if batched_rate > per_call_rate:
+        print("SUCCESS: batched delivery is %d.%02dx faster" %
+              (batched_rate // per_call_rate, batched_rate * 100 // per_call_rate % 100))
+    else:
+        print("FAIL: batched delivery is not faster")
+
+if __name__ == "__main__":
+    main()
@@ -1,3 +1,4 @@
+import nespy
 from lib import ns
 from lib import hello
 
@@ -32,9 +33,8 @@ def main():
     # autostart internal nespy processes
     ns.process.autostart()
 
-    while True:
-        ns.process.run()
-        ns.platform.process_update()
+    # run the netstack scheduler loop natively
+    nespy.run_forever()
 
 if __name__ == "__main__":
     main()
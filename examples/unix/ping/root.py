@@ -29,9 +29,8 @@ def main():
     # autostart internal nespy processes
     process.autostart()
 
-    while True:
-        process.run()
-        platform.process_update()
+    # run the netstack scheduler loop natively
+    nespy.run_forever()
 
 if __name__ == "__main__":
     main()
@@ -0,0 +1,107 @@
+/**
+ * \file
+ *         AES-128 with the x86-64 AES-NI instructions.
+ *
+ *         The instructions are enabled for the functions using them
+ *         only, so no -maes is needed. Whether the CPU has them is
+ *         checked with cpuid on first use, and the T-table driver is
+ *         used when it does not.
+ */
+
+#include "lib/aes-128.h"
+
+#if AES_128_NI
+
+#include <cpuid.h>
+#include <wmmintrin.h>
+
+#define AES_NI __attribute__((target("aes")))
+
+static __m128i round_keys[11];
+/* 1 when the CPU has AES-NI, 0 when not and -1 until checked */
+static int has_ni = -1;
+
+/*---------------------------------------------------------------------------*/
+static AES_NI __m128i
+expand_step(__m128i key, __m128i assist)
+{
+  assist = _mm_shuffle_epi32(assist, 0xff);
+  key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+  key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+  key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+  return _mm_xor_si128(key, assist);
+}
+/*---------------------------------------------------------------------------*/
+static AES_NI void
+ni_set_key(const uint8_t *key)
+{
+  /* the round constant has to be an immediate */
+#define EXPAND(I, RCON) \
+  round_keys[I] = expand_step(round_keys[I - 1], \
+      _mm_aeskeygenassist_si128(round_keys[I - 1], RCON))
+
+  round_keys[0] = _mm_loadu_si128((const __m128i *)key);
+  EXPAND(1, 0x01);
+  EXPAND(2, 0x02);
+  EXPAND(3, 0x04);
+  EXPAND(4, 0x08);
+  EXPAND(5, 0x10);
+  EXPAND(6, 0x20);
+  EXPAND(7, 0x40);
+  EXPAND(8, 0x80);
+  EXPAND(9, 0x1b);
+  EXPAND(10, 0x36);
+#undef EXPAND
+}
+/*---------------------------------------------------------------------------*/
+static AES_NI void
+ni_encrypt(uint8_t *state)
+{
+  __m128i s;
+  int round;
+
+  s = _mm_xor_si128(_mm_loadu_si128((const __m128i *)state), round_keys[0]);
+  for(round = 1; round < 10; round++) {
+    s = _mm_aesenc_si128(s, round_keys[round]);
+  }
+  s = _mm_aesenclast_si128(s, round_keys[10]);
+  _mm_storeu_si128((__m128i *)state, s);
+}
+/*---------------------------------------------------------------------------*/
+static int
+aes_ni_available(void)
+{
+  unsigned int eax, ebx, ecx, edx;
+
+  if(has_ni < 0) {
+    has_ni = __get_cpuid(1, &eax, &ebx, &ecx, &edx) && (ecx & bit_AES) != 0;
+  }
+  return has_ni;
+}
+/*---------------------------------------------------------------------------*/
+static void
+set_key(const uint8_t *key)
+{
+  if(aes_ni_available()) {
+    ni_set_key(key);
+  } else {
+    aes_128_ttable_driver.set_key(key);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+encrypt(uint8_t *state)
+{
+  if(aes_ni_available()) {
+    ni_encrypt(state);
+  } else {
+    aes_128_ttable_driver.encrypt(state);
+  }
+}
+/*---------------------------------------------------------------------------*/
+const struct aes_128_driver aes_128_ni_driver = {
+  set_key,
+  encrypt
+};
+/*---------------------------------------------------------------------------*/
+#endif /* AES_128_NI */
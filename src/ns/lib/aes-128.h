@@ -45,6 +45,12 @@
 #define AES_128_BLOCK_SIZE 16
 #define AES_128_KEY_LENGTH 16
 
+/*
+ * The driver behind AES_128. aes_128_driver is the byte oriented
+ * reference, aes_128_ttable_driver uses 32-bit T-tables and
+ * aes_128_ni_driver the x86-64 AES-NI instructions, or T-tables on a
+ * CPU without them.
+ */
 #ifdef AES_128_CONF
 #define AES_128            AES_128_CONF
 #else /* AES_128_CONF */
@@ -69,4 +75,17 @@ struct aes_128_driver {
 
 extern const struct aes_128_driver AES_128;
 
+extern const struct aes_128_driver aes_128_driver;
+extern const struct aes_128_driver aes_128_ttable_driver;
+/* Whether the compiler can build aes_128_ni_driver */
+#if defined(__x86_64__) && defined(__GNUC__)
+#define AES_128_NI 1
+#else
+#define AES_128_NI 0
+#endif
+
+#if AES_128_NI
+extern const struct aes_128_driver aes_128_ni_driver;
+#endif /* AES_128_NI */
+
 #endif /* AES_128_H_ */
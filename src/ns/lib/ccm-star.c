@@ -46,6 +46,29 @@
 #define CCM_STAR_AUTH_FLAGS(Adata, M) ((Adata ? (1u << 6) : 0) | (((M - 2u) >> 1) << 3) | 1u)
 #define CCM_STAR_ENCRYPTION_FLAGS     1
 
+/*---------------------------------------------------------------------------*/
+/* XORs len <= 16 bytes of src into dst, whole blocks a word at a time */
+static void
+xor_block(uint8_t *dst, const uint8_t *src, uint8_t len)
+{
+  uint32_t d[AES_128_BLOCK_SIZE / 4];
+  uint32_t s[AES_128_BLOCK_SIZE / 4];
+
+  if(len == AES_128_BLOCK_SIZE) {
+    memcpy(d, dst, AES_128_BLOCK_SIZE);
+    memcpy(s, src, AES_128_BLOCK_SIZE);
+    d[0] ^= s[0];
+    d[1] ^= s[1];
+    d[2] ^= s[2];
+    d[3] ^= s[3];
+    memcpy(dst, d, AES_128_BLOCK_SIZE);
+    return;
+  }
+
+  while(len--) {
+    *dst++ ^= *src++;
+  }
+}
 /*---------------------------------------------------------------------------*/
 static void
 set_iv(uint8_t *iv,
@@ -59,85 +82,30 @@ set_iv(uint8_t *iv,
   iv[15] = counter;
 }
 /*---------------------------------------------------------------------------*/
-/* XORs the block m[pos] ... m[pos + 15] with K_{counter} */
+/* Starts the CBC-MAC in x with B_0 and the additional authenticated data */
 static void
-ctr_step(const uint8_t *nonce,
-    uint8_t pos,
-    uint8_t *m_and_result,
+mic_start(uint8_t *x,
+    const uint8_t *nonce,
     uint8_t m_len,
-    uint8_t counter)
-{
-  uint8_t a[AES_128_BLOCK_SIZE];
-  uint8_t i;
-  
-  set_iv(a, CCM_STAR_ENCRYPTION_FLAGS, nonce, counter);
-  AES_128.encrypt(a);
-  
-  for(i = 0; (pos + i < m_len) && (i < AES_128_BLOCK_SIZE); i++) {
-    m_and_result[pos + i] ^= a[i];
-  }
-}
-/*---------------------------------------------------------------------------*/
-static void
-mic(const uint8_t *nonce,
-    const uint8_t *m, uint8_t m_len,
     const uint8_t *a, uint8_t a_len,
-    uint8_t *result,
     uint8_t mic_len)
 {
-  uint8_t x[AES_128_BLOCK_SIZE];
-  uint8_t pos;
-  uint8_t i;
+  unsigned int pos;
   
   set_iv(x, CCM_STAR_AUTH_FLAGS(a_len, mic_len), nonce, m_len);
   AES_128.encrypt(x);
   
   if(a_len) {
     x[1] = x[1] ^ a_len;
-    for(i = 2; (i - 2 < a_len) && (i < AES_128_BLOCK_SIZE); i++) {
-      x[i] ^= a[i - 2];
-    }
+    xor_block(x + 2, a, MIN(a_len, AES_128_BLOCK_SIZE - 2));
     
     AES_128.encrypt(x);
     
-    pos = 14;
-    while(pos < a_len) {
-      for(i = 0; (pos + i < a_len) && (i < AES_128_BLOCK_SIZE); i++) {
-        x[i] ^= a[pos + i];
-      }
-      pos += AES_128_BLOCK_SIZE;
-      AES_128.encrypt(x);
-    }
-  }
-  
-  if(m_len) {
-    pos = 0;
-    while(pos < m_len) {
-      for(i = 0; (pos + i < m_len) && (i < AES_128_BLOCK_SIZE); i++) {
-        x[i] ^= m[pos + i];
-      }
-      pos += AES_128_BLOCK_SIZE;
+    for(pos = 14; pos < a_len; pos += AES_128_BLOCK_SIZE) {
+      xor_block(x, a + pos, MIN(a_len - pos, AES_128_BLOCK_SIZE));
       AES_128.encrypt(x);
     }
   }
-  
-  ctr_step(nonce, 0, x, AES_128_BLOCK_SIZE, 0);
-  
-  memcpy(result, x, mic_len);
-}
-/*---------------------------------------------------------------------------*/
-static void
-ctr(const uint8_t *nonce, uint8_t *m, uint8_t m_len)
-{
-  uint8_t pos;
-  uint8_t counter;
-  
-  pos = 0;
-  counter = 1;
-  while(pos < m_len) {
-    ctr_step(nonce, pos, m, m_len, counter++);
-    pos += AES_128_BLOCK_SIZE;
-  }
 }
 /*---------------------------------------------------------------------------*/
 static void
@@ -146,6 +114,12 @@ set_key(const uint8_t *key)
   AES_128.set_key(key);
 }
 /*---------------------------------------------------------------------------*/
+/*
+ * Runs the CBC-MAC and CTR passes of RFC 3610 together, one message
+ * block at a time. The counter block is set up once and only its last
+ * byte changes, messages are at most 255 bytes or 16 blocks. Without a
+ * MIC (mic_len 0, the ENC security levels) the CBC-MAC is skipped.
+ */
 static void
 aead(const uint8_t* nonce,
     uint8_t* m, uint8_t m_len,
@@ -153,25 +127,59 @@ aead(const uint8_t* nonce,
     uint8_t *result, uint8_t mic_len,
     int forward)
 {
-  if(!forward) {
-    /* decrypt */
-    ctr(nonce, m, m_len);
+  uint8_t x[AES_128_BLOCK_SIZE];
+  uint8_t ctr[AES_128_BLOCK_SIZE];
+  uint8_t s[AES_128_BLOCK_SIZE];
+  unsigned int pos;
+  uint8_t len;
+  
+  if(mic_len) {
+    mic_start(x, nonce, m_len, a, a_len, mic_len);
   }
+  set_iv(ctr, CCM_STAR_ENCRYPTION_FLAGS, nonce, 0);
   
-  mic(nonce,
-    m, m_len,
-    a, a_len,
-    result,
-    mic_len);
+  for(pos = 0; pos < m_len; pos += AES_128_BLOCK_SIZE) {
+    len = MIN(m_len - pos, AES_128_BLOCK_SIZE);
+    ctr[15]++;
+    memcpy(s, ctr, AES_128_BLOCK_SIZE);
+    AES_128.encrypt(s);
+    
+    if(mic_len && forward) {
+      /* the MIC covers the plaintext */
+      xor_block(x, m + pos, len);
+      AES_128.encrypt(x);
+    }
+    xor_block(m + pos, s, len);
+    if(mic_len && !forward) {
+      xor_block(x, m + pos, len);
+      AES_128.encrypt(x);
+    }
+  }
   
-  if(forward) {
-    /* encrypt */
-    ctr(nonce, m, m_len);
+  if(mic_len) {
+    /* encrypt the MIC with the key stream block of counter 0 */
+    ctr[15] = 0;
+    AES_128.encrypt(ctr);
+    xor_block(x, ctr, mic_len);
+    memcpy(result, x, mic_len);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+aead_batch(struct ccm_star_frame *frames, uint8_t count, int forward)
+{
+  for(; count; count--, frames++) {
+    aead(frames->nonce,
+      frames->m, frames->m_len,
+      frames->a, frames->a_len,
+      frames->result, frames->mic_len,
+      forward);
   }
 }
 /*---------------------------------------------------------------------------*/
 const struct ccm_star_driver ccm_star_driver = {
   set_key,
-  aead
+  aead,
+  aead_batch
 };
 /*---------------------------------------------------------------------------*/
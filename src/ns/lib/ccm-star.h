@@ -50,6 +50,20 @@
 
 #define CCM_STAR_NONCE_LENGTH 13
 
+/**
+ * A frame for ccm_star_driver.aead_batch(), the fields are the
+ * arguments of ccm_star_driver.aead().
+ */
+struct ccm_star_frame {
+  const uint8_t *nonce;
+  uint8_t *m;
+  const uint8_t *a;
+  uint8_t *result;
+  uint8_t m_len;
+  uint8_t a_len;
+  uint8_t mic_len;
+};
+
 /**
  * Structure of CCM* drivers.
  */
@@ -75,6 +89,16 @@ struct ccm_star_driver {
       const uint8_t* a, uint8_t a_len,
       uint8_t *result, uint8_t mic_len,
       int forward);
+  
+  /**
+   * \brief         Runs aead() on a number of frames with the current key,
+   *                e.g. for the frames of one neighbor queue.
+   * \param frames  The frames to encrypt or decrypt.
+   * \param count   The number of frames.
+   * \param forward != 0 if used in forward direction.
+   */
+  void (* aead_batch)(struct ccm_star_frame *frames, uint8_t count,
+      int forward);
 };
 
 extern const struct ccm_star_driver CCM_STAR;
@@ -1,7 +1,15 @@
 #include "py/nlr.h"
 #include "py/runtime.h"
+#include "ns/contiki.h"
+#include "ns/lib/py/obj-process.h"
 #include <stdio.h>
 
+// Example usage to the native scheduler loop
+//
+//      nespy.run_forever()     # run netstack processes and platform update in C
+//      nespy.stop()            # make run_forever() return (e.g. from a callback)
+//      nespy.loop_stats()      # (iterations, idle) counters of the native loop
+
 extern const mp_obj_type_t ns_hello_type;
 extern const mp_obj_type_t ns_init_type;
 extern const mp_obj_type_t ns_process_type;
@@ -13,6 +21,59 @@ extern const mp_obj_type_t ns_coap_resource_type;
 #endif
 extern const mp_obj_type_t ns_etimer_type;
 
+#if defined(UNIX)
+extern void unix_process_wait(void);
+#endif
+
+static volatile bool loop_stop_requested = false;
+static mp_uint_t loop_iterations = 0;
+static mp_uint_t loop_idle = 0;
+
+// nespy.run_forever()
+STATIC mp_obj_t ns_run_forever(void)
+{
+    loop_stop_requested = false;
+
+    while (!loop_stop_requested) {
+        loop_iterations++;
+        if (process_run() == 0) {
+            // the event queue drained, hand batched threads their events
+            if (ns_thread_flush() == 0) {
+                loop_idle++;
+            }
+        }
+#if defined(UNIX)
+        // returns immediately if there are still events or polls pending
+        unix_process_wait();
+#endif
+        // raise KeyboardInterrupt or run scheduled callbacks
+        mp_handle_pending();
+    }
+
+    return mp_const_none;
+}
+
+// nespy.stop()
+STATIC mp_obj_t ns_stop(void)
+{
+    loop_stop_requested = true;
+    return mp_const_none;
+}
+
+// nespy.loop_stats()
+STATIC mp_obj_t ns_loop_stats(void)
+{
+    mp_obj_t tuple[2] = {
+        mp_obj_new_int_from_uint(loop_iterations),
+        mp_obj_new_int_from_uint(loop_idle),
+    };
+    return mp_obj_new_tuple(2, tuple);
+}
+
+STATIC MP_DEFINE_CONST_FUN_OBJ_0(ns_run_forever_obj, ns_run_forever);
+STATIC MP_DEFINE_CONST_FUN_OBJ_0(ns_stop_obj, ns_stop);
+STATIC MP_DEFINE_CONST_FUN_OBJ_0(ns_loop_stats_obj, ns_loop_stats);
+
 STATIC const mp_rom_map_elem_t ns_module_globals_table[] = {
     { MP_ROM_QSTR(MP_QSTR___name__), MP_OBJ_NEW_QSTR(MP_QSTR_ns) },
     { MP_ROM_QSTR(MP_QSTR_Hello), MP_ROM_PTR(&ns_hello_type) },
@@ -25,6 +86,9 @@ STATIC const mp_rom_map_elem_t ns_module_globals_table[] = {
     { MP_ROM_QSTR(MP_QSTR_CoapResource), MP_ROM_PTR(&ns_coap_resource_type) },
 #endif
     { MP_ROM_QSTR(MP_QSTR_Etimer), MP_ROM_PTR(&ns_etimer_type) },
+    { MP_ROM_QSTR(MP_QSTR_run_forever), MP_ROM_PTR(&ns_run_forever_obj) },
+    { MP_ROM_QSTR(MP_QSTR_stop), MP_ROM_PTR(&ns_stop_obj) },
+    { MP_ROM_QSTR(MP_QSTR_loop_stats), MP_ROM_PTR(&ns_loop_stats_obj) },
 };
 
 STATIC MP_DEFINE_CONST_DICT(ns_module_globals, ns_module_globals_table);
@@ -1,3 +1,5 @@
+#include "ns/contiki.h"
+#include "ns/lib/py/nstd.h"
 #include <stdint.h>
 #include <stddef.h>
 #include <ctype.h>
@@ -6,6 +8,38 @@
 #include <stdio.h>
 #include <string.h>
 
+// NS_STD_CONF_LIBC selects the platform libc for the string and memory
+// helpers on hosted ports. Otherwise they are implemented here without any
+// libc call, copying and scanning a machine word at a time where possible.
+#ifdef NS_STD_CONF_LIBC
+#define NS_STD_LIBC NS_STD_CONF_LIBC
+#else
+#define NS_STD_LIBC 0
+#endif
+
+#if !NS_STD_LIBC
+#if defined(__GNUC__)
+typedef uintptr_t __attribute__((__may_alias__)) ns_word_t;
+#else
+typedef uintptr_t ns_word_t;
+#endif
+
+#define NS_WORD_SIZE    sizeof(ns_word_t)
+#define NS_WORD_MASK    (NS_WORD_SIZE - 1)
+#define NS_WORD_ONES    ((ns_word_t)-1 / 0xff)
+#define NS_WORD_HIGHS   (NS_WORD_ONES * 0x80)
+// non zero if any byte of w is zero
+#define NS_WORD_HAS_ZERO(w) (((w) - NS_WORD_ONES) & ~(w) & NS_WORD_HIGHS)
+
+// keep gcc from turning the copy loops back into memcpy() calls, there is
+// no libc to call on freestanding ports
+#if defined(__GNUC__) && !defined(__clang__)
+#define NS_NO_LIBCALL __attribute__((optimize("no-tree-loop-distribute-patterns")))
+#else
+#define NS_NO_LIBCALL
+#endif
+#endif // !NS_STD_LIBC
+
 int ns_tolower(int chr)
 {
     return (chr >= 'A' && chr <= 'Z') ? (chr + 32) : (chr);
@@ -13,17 +47,27 @@ int ns_tolower(int chr)
 
 int ns_strncmp(const char *s1, const char *s2, size_t n)
 {
+#if NS_STD_LIBC
+    return strncmp(s1, s2, n);
+#else
     for ( ; n--; ++s1, ++s2) {
         if (*s1 != *s2) {
-            return *s1 - *s2;
+            return (unsigned char)*s1 - (unsigned char)*s2;
+        }
+        if (*s1 == '\0') {
+            break;
         }
     }
 
     return 0;
+#endif
 }
 
 int ns_strcmp(const char *s1, const char *s2)
 {
+#if NS_STD_LIBC
+    return strcmp(s1, s2);
+#else
     while ((*s1 != '\0' && *s2 != '\0') && *s1 == *s2) {
         s1++;
         s2++;
@@ -32,30 +76,82 @@ int ns_strcmp(const char *s1, const char *s2)
     if (*s1 == *s2) {
         return 0; // strings are identical
     } else {
-        return *s1 - *s2;
+        return (unsigned char)*s1 - (unsigned char)*s2;
     }
+#endif
 }
 
 size_t ns_strlen(const char *s)
 {
-    size_t ret;
+#if NS_STD_LIBC
+    return strlen(s);
+#else
+    const char *p = s;
+    const ns_word_t *w;
+
+    // aligned word reads never cross into the next page
+    for ( ; ((uintptr_t)p & NS_WORD_MASK) != 0; p++) {
+        if (*p == '\0') {
+            return p - s;
+        }
+    }
+
+    for (w = (const ns_word_t *)p; !NS_WORD_HAS_ZERO(*w); w++) {
+        // empty loop
+    }
 
-    for (ret = 0; s[ret] != 0; ret++) {
+    for (p = (const char *)w; *p != '\0'; p++) {
         // empty loop
     }
 
-    return ret;
+    return p - s;
+#endif
 }
 
+#if NS_STD_LIBC
 void ns_memcpy(void *dest, const void *src, size_t n)
 {
-    const char *csrc = (const char *)src;
-    char *cdest = (char *)dest;
+    memcpy(dest, src, n);
+}
+#else
+NS_NO_LIBCALL void ns_memcpy(void *dest, const void *src, size_t n)
+{
+    const unsigned char *csrc = (const unsigned char *)src;
+    unsigned char *cdest = (unsigned char *)dest;
+
+    // word copies only when both sides can be aligned together
+    if (n >= 2 * NS_WORD_SIZE &&
+        (((uintptr_t)cdest ^ (uintptr_t)csrc) & NS_WORD_MASK) == 0) {
+        ns_word_t *wdest;
+        const ns_word_t *wsrc;
+
+        for ( ; ((uintptr_t)cdest & NS_WORD_MASK) != 0; n--) {
+            *cdest++ = *csrc++;
+        }
 
-    for (int i = 0; i < n; i++) {
-        cdest[i] = csrc[i];
+        wdest = (ns_word_t *)cdest;
+        wsrc = (const ns_word_t *)csrc;
+        for ( ; n >= 4 * NS_WORD_SIZE; n -= 4 * NS_WORD_SIZE) {
+            wdest[0] = wsrc[0];
+            wdest[1] = wsrc[1];
+            wdest[2] = wsrc[2];
+            wdest[3] = wsrc[3];
+            wdest += 4;
+            wsrc += 4;
+        }
+        for ( ; n >= NS_WORD_SIZE; n -= NS_WORD_SIZE) {
+            *wdest++ = *wsrc++;
+        }
+
+        cdest = (unsigned char *)wdest;
+        csrc = (const unsigned char *)wsrc;
+    }
+
+    while (n--) {
+        *cdest++ = *csrc++;
     }
 }
+#endif
 
 size_t ns_strncpy(char *dest, const char *src, size_t size)
 {
@@ -89,12 +185,25 @@ size_t ns_strncat(char *dest, const char *src, size_t size)
 
 int ns_strncasecmp(const char *s1, const char *s2, size_t n)
 {
-    return ns_strncmp(s1, s2, n);
+    int c1, c2;
+
+    for ( ; n--; ++s1, ++s2) {
+        c1 = ns_tolower((unsigned char)*s1);
+        c2 = ns_tolower((unsigned char)*s2);
+        if (c1 != c2) {
+            return c1 - c2;
+        }
+        if (c1 == '\0') {
+            break;
+        }
+    }
+
+    return 0;
 }
 
 int ns_strcasecmp(const char *s1, const char *s2)
 {
-  return ns_strcmp(s1, s2);
+    return ns_strncasecmp(s1, s2, (size_t)-1);
 }
 
 void ns_log(const char *format, ...)
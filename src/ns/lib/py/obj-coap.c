@@ -3,12 +3,13 @@
 #include "py/runtime.h"
 #include "ns/contiki.h"
 #include "ns/contiki-net.h"
-#include "ns/sys/int-master.h"
 #include "ns/net/app-layer/coap/coap-engine.h"
 #include "ns/net/app-layer/coap/coap-blocking-api.h"
 #include "ns/lib/py/obj-coap.h"
+#include "ns/lib/py/obj-pool.h"
 #include "ns/lib/py/nstd.h"
 #include <stdio.h>
+#include <string.h>
 
 // Example usage to Coap Resource objects
 //
@@ -29,7 +30,8 @@
 //                                     period=0)
 
 const mp_obj_type_t ns_coap_resource_type;
-static ns_coap_res_obj_all_t coap_res_obj_all;
+// resource objects linked into the coap engine, indexed by resource id
+static ns_obj_pool_t coap_res_pool = NS_OBJ_POOL(ns_coap_res_pool, COAP_RES_OBJ_ALL_NUM);
 static process_event_t client_get_event;
 static process_event_t client_post_event;
 static process_event_t client_put_event;
@@ -39,19 +41,6 @@ static bool is_coap_resource_init = false;
 
 void ns_coap_resource_init(void)
 {
-    coap_res_obj_all.remain = COAP_RES_OBJ_ALL_NUM;
-    for (int i = 0; i < COAP_RES_OBJ_ALL_NUM; i++) {
-        ns_coap_res_obj_t *res = &coap_res_obj_all.res[i];
-        res->server_activated = false;
-        res->is_initialized = false;
-        res->get_obj = mp_const_none;
-        res->post_obj = mp_const_none;
-        res->put_obj = mp_const_none;
-        res->delete_obj = mp_const_none;
-        res->client_msg_callback_obj = mp_const_none;
-        res->obs_notif_callback_obj = mp_const_none;
-        res->periodic_callback_obj = mp_const_none;
-    }
     // initialize coap resource event
     client_get_event    = process_alloc_event();
     client_post_event   = process_alloc_event();
@@ -59,41 +48,32 @@ void ns_coap_resource_init(void)
     client_delete_event = process_alloc_event();
 }
 
-static ns_coap_res_id_t coap_res_get_id(void);
-
-// predefined resource handler
-COAP_RES_HANDLER(get_handler0);
-COAP_RES_HANDLER(get_handler1);
-
-COAP_RES_HANDLER(post_handler0);
-COAP_RES_HANDLER(post_handler1);
-
-COAP_RES_HANDLER(put_handler0);
-COAP_RES_HANDLER(put_handler1);
+// the engine hands its own coap_resource_t to the handlers below, the
+// python resource object is recovered from it
+static inline ns_coap_res_obj_t *coap_res_from_resource(coap_resource_t *resource)
+{
+    if (resource == NULL) {
+        return NULL;
+    }
+    return (ns_coap_res_obj_t *)((char *)resource - offsetof(ns_coap_res_obj_t, res));
+}
 
-COAP_RES_HANDLER(delete_handler0);
-COAP_RES_HANDLER(delete_handler1);
+// resource handlers shared by every python coap resource
+COAP_RES_HANDLER(get_handler);
+COAP_RES_HANDLER(post_handler);
+COAP_RES_HANDLER(put_handler);
+COAP_RES_HANDLER(delete_handler);
+static void periodic_handler(void);
 
-// predefined periodic handler
-COAP_RES_PERIODIC_HANDLER(periodic0);
-COAP_RES_PERIODIC_HANDLER(periodic1);
+static const coap_periodic_resource_t periodic_template = { 0, { 0 }, periodic_handler };
 
-static void obs_notif0(coap_observee_t *obs, void *notification, coap_notification_flag_t flag);
-static void obs_notif1(coap_observee_t *obs, void *notification, coap_notification_flag_t flag);
+static void obs_notif(coap_observee_t *obs, void *notification, coap_notification_flag_t flag);
 
 // predefined coap client process
 PROCESS(ns_coap_client_process, "coap client process");
 
 // predefined client message handler
-static void client_msg_handler0(coap_message_t *response);
-static void client_msg_handler1(coap_message_t *response);
-
-static ns_coap_resource_handler_t res_handler[] = {
-    { get_handler0, post_handler0, put_handler0, delete_handler0,
-      &res_periodic0, client_msg_handler0, obs_notif0 },
-    { get_handler1, post_handler1, put_handler1, delete_handler1,
-      &res_periodic1, client_msg_handler1, obs_notif1 },
-};
+static void client_msg_handler(coap_message_t *response);
 
 STATIC mp_obj_t ns_coap_resource_make_new(const mp_obj_type_t *type,
                                           size_t n_args,
@@ -111,14 +91,6 @@ STATIC mp_obj_t ns_coap_resource_make_new(const mp_obj_type_t *type,
         is_coap_resource_init = true;
     }
 
-    ns_coap_res_id_t res_id = coap_res_get_id();
-
-    if (res_id < 0) {
-        nlr_raise(mp_obj_new_exception_msg_varg(&mp_type_ValueError,
-                  "ns: coap periodic resource overflow! max(%d)",
-                  COAP_RES_OBJ_ALL_NUM));
-    }
-
     enum {ARG_attr, ARG_get, ARG_post, ARG_put, ARG_delete, ARG_period, ARG_callback};
     static const mp_arg_t allowed_args[] = {
         { MP_QSTR_attr,     MP_ARG_KW_ONLY | MP_ARG_OBJ, {.u_obj = mp_const_none} },
@@ -149,17 +121,41 @@ STATIC mp_obj_t ns_coap_resource_make_new(const mp_obj_type_t *type,
         }
     }
 
-    // create coap resource object
-    ns_coap_res_obj_t *res_obj = m_new_obj(ns_coap_res_obj_t);
+    if (args[ARG_period].u_int != 0 && args[ARG_callback].u_obj == mp_const_none) {
+        nlr_raise(mp_obj_new_exception_msg_varg(&mp_type_ValueError,
+                  "ns: periodic coap resource callback can't be empty"));
+    }
+
+    // raises for a non str attr, before a pool slot is taken
+    const char *attributes = mp_obj_str_get_str(args[ARG_attr].u_obj);
+
+    // create coap resource object, it is linked into the coap engine as is
+    // and the pool keeps it alive while the engine can call back into it
+    ns_coap_res_obj_t *res_obj = m_new0(ns_coap_res_obj_t, 1);
     res_obj->base.type = &ns_coap_resource_type;
-    res_obj->id = res_id;
+    res_obj->id = ns_obj_pool_add(&coap_res_pool, MP_OBJ_FROM_PTR(res_obj));
+
+    if (res_obj->id < 0) {
+#if COAP_RES_OBJ_ALL_NUM
+        nlr_raise(mp_obj_new_exception_msg_varg(&mp_type_ValueError,
+                  "ns: coap periodic resource overflow! max(%d)",
+                  COAP_RES_OBJ_ALL_NUM));
+#else
+        // no limit, only running out of memory stops the pool
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_MemoryError,
+                  "ns: coap periodic resource overflow!"));
+#endif
+    }
+
+    res_obj->obs_notif_callback_obj = mp_const_none;
+    res_obj->periodic_callback_obj = mp_const_none;
     res_obj->res.next = NULL;
     res_obj->res.url = NULL;
     res_obj->res.flags = IS_OBSERVABLE | IS_PERIODIC;
-    res_obj->res.attributes = mp_obj_str_get_str(args[ARG_attr].u_obj);
+    res_obj->res.attributes = attributes;
     // check get method
     if (args[ARG_get].u_obj != mp_const_none) {
-        res_obj->res.get_handler = res_handler[res_obj->id].get;
+        res_obj->res.get_handler = get_handler;
         res_obj->get_obj = args[ARG_get].u_obj;
     } else {
         res_obj->res.get_handler = NULL;
@@ -167,7 +163,7 @@ STATIC mp_obj_t ns_coap_resource_make_new(const mp_obj_type_t *type,
     }
     // check post method
     if (args[ARG_post].u_obj != mp_const_none) {
-        res_obj->res.post_handler = res_handler[res_obj->id].post;
+        res_obj->res.post_handler = post_handler;
         res_obj->post_obj = args[ARG_post].u_obj;
     } else {
         res_obj->res.post_handler = NULL;
@@ -175,7 +171,7 @@ STATIC mp_obj_t ns_coap_resource_make_new(const mp_obj_type_t *type,
     }
     // check put method
     if (args[ARG_put].u_obj != mp_const_none) {
-        res_obj->res.put_handler = res_handler[res_obj->id].put;
+        res_obj->res.put_handler = put_handler;
         res_obj->put_obj = args[ARG_put].u_obj;
     } else {
         res_obj->res.put_handler = NULL;
@@ -183,7 +179,7 @@ STATIC mp_obj_t ns_coap_resource_make_new(const mp_obj_type_t *type,
     }
     // check delete method
     if (args[ARG_delete].u_obj != mp_const_none) {
-        res_obj->res.delete_handler = res_handler[res_obj->id].del;
+        res_obj->res.delete_handler = delete_handler;
         res_obj->delete_obj = args[ARG_delete].u_obj;
     } else {
         res_obj->res.delete_handler = NULL;
@@ -192,14 +188,10 @@ STATIC mp_obj_t ns_coap_resource_make_new(const mp_obj_type_t *type,
     // check periodic method
     if (args[ARG_period].u_int != 0) {
         // set coap resource periodic
-        res_handler[res_obj->id].periodic->period = (uint32_t)args[ARG_period].u_int;
-        res_obj->res.periodic = res_handler[res_obj->id].periodic;
-        if (args[ARG_callback].u_obj == mp_const_none) {
-            nlr_raise(mp_obj_new_exception_msg_varg(&mp_type_ValueError,
-                      "ns: periodic coap resource callback can't be empty"));
-        } else {
-            res_obj->periodic_callback_obj = args[ARG_callback].u_obj;
-        }
+        memcpy(&res_obj->periodic, &periodic_template, sizeof(periodic_template));
+        res_obj->periodic.period = (uint32_t)args[ARG_period].u_int;
+        res_obj->res.periodic = &res_obj->periodic;
+        res_obj->periodic_callback_obj = args[ARG_callback].u_obj;
     } else {
         res_obj->res.periodic = NULL;
     }
@@ -207,8 +199,7 @@ STATIC mp_obj_t ns_coap_resource_make_new(const mp_obj_type_t *type,
     // set this to none unless this node is set as client
     res_obj->client_msg_callback_obj = mp_const_none;
 
-    // put this object into container
-    coap_res_obj_all.res[res_obj->id] = *res_obj;
+    res_obj->is_initialized = true;
 
     return MP_OBJ_FROM_PTR(res_obj);
 }
@@ -228,14 +219,13 @@ STATIC void ns_coap_resource_print(const mp_print_t *print,
     mp_printf(print, "ns: has delete   : %s\n", self->res.delete_handler != NULL ? "1" : "1");
     mp_printf(print, "ns: as server    : %s\n", self->server_activated ? "1" : "0");
     mp_printf(print, "ns: server uri   : %s\n", self->server_activated ? self->uri_path : "NULL");
-    mp_printf(print, "ns: remain       : %u\n", coap_res_obj_all.remain);
+    mp_printf(print, "ns: remain       : %u\n", (unsigned)ns_obj_pool_remain(&coap_res_pool));
 }
 
 // res.server_activate("test/hello") # set this node as a coap server
 STATIC mp_obj_t ns_coap_resource_server_activate(mp_obj_t self_in, mp_obj_t uri_path_in)
 {
     ns_coap_res_obj_t *self = MP_OBJ_TO_PTR(self_in);
-    self = &coap_res_obj_all.res[self->id];
 
     self->uri_path = mp_obj_str_get_str(uri_path_in);
     self->server_activated = true;
@@ -247,7 +237,6 @@ STATIC mp_obj_t ns_coap_resource_server_activate(mp_obj_t self_in, mp_obj_t uri_
 STATIC mp_obj_t ns_coap_resource_client_ep(mp_obj_t self_in, mp_obj_t server_ipaddr_in)
 {
     ns_coap_res_obj_t *self = MP_OBJ_TO_PTR(self_in);
-    self = &coap_res_obj_all.res[self->id];
 
     const char *server_ipaddr = mp_obj_str_get_str(server_ipaddr_in);
 
@@ -273,7 +262,6 @@ STATIC mp_obj_t ns_coap_resource_client_get(mp_obj_t self_in,
                                             mp_obj_t callback_in)
 {
     ns_coap_res_obj_t *self = MP_OBJ_TO_PTR(self_in);
-    self = &coap_res_obj_all.res[self->id];
 
     const char *uri_path = mp_obj_str_get_str(uri_path_in);
     self->client_msg_callback_obj = callback_in;
@@ -285,7 +273,7 @@ STATIC mp_obj_t ns_coap_resource_client_get(mp_obj_t self_in,
         process_start(&ns_coap_client_process, NULL);
     }
 
-    process_post(&ns_coap_client_process, client_get_event, (void *)&self->id);
+    process_post(&ns_coap_client_process, client_get_event, self);
     return mp_const_none;
 }
 
@@ -295,13 +283,12 @@ STATIC mp_obj_t ns_coap_resource_client_observe(mp_obj_t self_in,
                                                 mp_obj_t callback_in)
 {
     ns_coap_res_obj_t *self = MP_OBJ_TO_PTR(self_in);
-    self = &coap_res_obj_all.res[self->id];
     char *uri_path = (char *)mp_obj_str_get_str(uri_path_in);
     self->obs_notif_callback_obj = callback_in;
     coap_obs_request_registration(&self->end_point,
                                  uri_path,
-                                 res_handler[self->id].obs_notif,
-                                 NULL);
+                                 obs_notif,
+                                 self);
     return mp_const_none;
 }
 
@@ -373,35 +360,6 @@ const mp_obj_type_t ns_coap_resource_type = {
     .locals_dict = (mp_obj_dict_t *)&ns_coap_resource_locals_dict,
 };
 
-// helper functions ------------------------------------------------------------
-
-static ns_coap_res_id_t coap_res_get_id(void)
-{
-    bool is_get_id = false;
-    ns_coap_res_id_t id = 0;
-
-    int_master_status_t int_status = int_master_read_and_disable();
-
-    for (int i= 0; i < COAP_RES_OBJ_ALL_NUM; i++) {
-        if (coap_res_obj_all.res[i].is_initialized == false) {
-            is_get_id = true;
-            id = i;
-            break;
-        }
-    }
-
-    if (!is_get_id) {
-        return -1;
-    }
-
-    coap_res_obj_all.remain--;
-
-    int_master_status_set(int_status);
-    int_master_enable();
-
-    return id;
-}
-
 // predefined private functions for coap handlers ------------------------------
 
 static void res_set_payload(mp_obj_t payload,
@@ -417,27 +375,17 @@ static void res_set_payload(mp_obj_t payload,
     coap_set_payload(response, (uint8_t *)buffer, ns_strlen((char *)buffer));
 }
 
-static void get_handler0(coap_message_t *request, coap_message_t *response, uint8_t *buffer,
-                         uint16_t preferred_size, int32_t *offset)
+static void get_handler(coap_message_t *request, coap_message_t *response, uint8_t *buffer,
+                        uint16_t preferred_size, int32_t *offset)
 {
-    ns_coap_res_obj_t *res = &coap_res_obj_all.res[0];
+    ns_coap_res_obj_t *res = coap_res_from_resource(coap_get_current_resource());
     mp_obj_t payload = mp_const_none;
 
-    if (res->get_obj != mp_const_none) {
-        // get the payload
-        payload = mp_call_function_1(res->get_obj, MP_OBJ_FROM_PTR(res));
-    }
-
-    if (payload != mp_const_none) {
-        res_set_payload(payload, request, response, buffer, preferred_size, offset);
+    if (res == NULL) {
+        // called outside of a request or notification for a resource
+        coap_set_status_code(response, INTERNAL_SERVER_ERROR_5_00);
+        return;
     }
-}
-
-static void get_handler1(coap_message_t *request, coap_message_t *response, uint8_t *buffer,
-                         uint16_t preferred_size, int32_t *offset)
-{
-    ns_coap_res_obj_t *res = &coap_res_obj_all.res[1];
-    mp_obj_t payload = mp_const_none;
 
     if (res->get_obj != mp_const_none) {
         // get the payload
@@ -449,81 +397,61 @@ static void get_handler1(coap_message_t *request, coap_message_t *response, uint
     }
 }
 
-static void post_handler0(coap_message_t *request, coap_message_t *response, uint8_t *buffer,
-                          uint16_t preferred_size, int32_t *offset)
-{
-    // TODO:
-}
-
-static void post_handler1(coap_message_t *request, coap_message_t *response, uint8_t *buffer,
-                          uint16_t preferred_size, int32_t *offset)
-{
-    // TODO:
-}
-
-static void put_handler0(coap_message_t *request, coap_message_t *response, uint8_t *buffer,
+static void post_handler(coap_message_t *request, coap_message_t *response, uint8_t *buffer,
                          uint16_t preferred_size, int32_t *offset)
 {
     // TODO:
 }
 
-static void put_handler1(coap_message_t *request, coap_message_t *response, uint8_t *buffer,
-                         uint16_t preferred_size, int32_t *offset)
+static void put_handler(coap_message_t *request, coap_message_t *response, uint8_t *buffer,
+                        uint16_t preferred_size, int32_t *offset)
 {
     // TODO:
 }
 
-static void delete_handler0(coap_message_t *request, coap_message_t *response, uint8_t *buffer,
-                            uint16_t preferred_size, int32_t *offset)
+static void delete_handler(coap_message_t *request, coap_message_t *response, uint8_t *buffer,
+                           uint16_t preferred_size, int32_t *offset)
 {
     // TODO:
 }
 
-static void delete_handler1(coap_message_t *request, coap_message_t *response, uint8_t *buffer,
-                            uint16_t preferred_size, int32_t *offset)
+static void periodic_handler(void)
 {
-    // TODO:
-}
-
-static void periodic0(void)
-{
-    ns_coap_res_obj_t *res = &coap_res_obj_all.res[0];
-    if (res->periodic_callback_obj != mp_const_none) {
+    ns_coap_res_obj_t *res = coap_res_from_resource(coap_get_current_resource());
+    if (res != NULL && res->periodic_callback_obj != mp_const_none) {
         mp_call_function_1(res->periodic_callback_obj, MP_OBJ_FROM_PTR(res));
     }
 }
 
-static void periodic1(void)
-{
-    ns_coap_res_obj_t *res = &coap_res_obj_all.res[1];
-    if (res->periodic_callback_obj != mp_const_none) {
-        mp_call_function_1(res->periodic_callback_obj, MP_OBJ_FROM_PTR(res));
-    }
-}
+// resource whose blocking request is in flight, its response handler has no
+// other way to find it
+static ns_coap_res_obj_t *client_res;
 
 // predefined PROCESS_THREAD to handle CoAP message ----------------------------
 PROCESS_THREAD(ns_coap_client_process, ev, data)
 {
-    static ns_coap_res_id_t data_id;
     PROCESS_BEGIN();
     while (1) {
         PROCESS_WAIT_EVENT();
         if (ev == client_get_event && data != NULL) {
-            data_id = *(ns_coap_res_id_t *)data;
-            if (data_id >= 0 && data_id < COAP_RES_OBJ_ALL_NUM) {
-                COAP_BLOCKING_REQUEST(&coap_res_obj_all.res[data_id].end_point,
-                                      coap_res_obj_all.res[data_id].client_request,
-                                      res_handler[data_id].client_msg);
-            }
+            client_res = data;
+            COAP_BLOCKING_REQUEST(&client_res->end_point,
+                                  client_res->client_request,
+                                  client_msg_handler);
+            client_res = NULL;
         }
     }
     PROCESS_END();
 }
 
 // predefined client message handler
-static void client_msg_process(ns_coap_res_obj_t *res, coap_message_t *response)
+static void client_msg_handler(coap_message_t *response)
 {
+    ns_coap_res_obj_t *res = client_res;
     const uint8_t *msg;
+    if (res == NULL) {
+        return;
+    }
     coap_get_payload(response, &msg);
     res->get_payload = msg;
     if (res->client_msg_callback_obj != mp_const_none) {
@@ -531,23 +459,11 @@ static void client_msg_process(ns_coap_res_obj_t *res, coap_message_t *response)
     }
 }
 
-static void client_msg_handler0(coap_message_t *response)
-{
-    ns_coap_res_obj_t *res = &coap_res_obj_all.res[0];
-    client_msg_process(res, response);
-}
-
-static void client_msg_handler1(coap_message_t *response)
-{
-    ns_coap_res_obj_t *res = &coap_res_obj_all.res[1];
-    client_msg_process(res, response);
-}
-
-static void obs_notif_process(ns_coap_res_obj_t *res,
-                              coap_observee_t *obs,
-                              void *notification,
-                              coap_notification_flag_t flag)
+static void obs_notif(coap_observee_t *obs,
+                      void *notification,
+                      coap_notification_flag_t flag)
 {
+    ns_coap_res_obj_t *res = obs->data;
     int len = 0;
     const uint8_t *payload = NULL;
     if (notification) {
@@ -578,16 +494,4 @@ static void obs_notif_process(ns_coap_res_obj_t *res,
         break;
     }
 }
-
-static void obs_notif0(coap_observee_t *obs, void *notification, coap_notification_flag_t flag)
-{
-    ns_coap_res_obj_t *res = &coap_res_obj_all.res[0];
-    obs_notif_process(res, obs, notification, flag);
-}
-
-static void obs_notif1(coap_observee_t *obs, void *notification, coap_notification_flag_t flag)
-{
-    ns_coap_res_obj_t *res = &coap_res_obj_all.res[1];
-    obs_notif_process(res, obs, notification, flag);
-}
 #endif // #if APP_CONF_WITH_COAP
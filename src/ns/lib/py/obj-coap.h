@@ -1,18 +1,16 @@
 #ifndef NS_LIB_PY_OBJ_COAP_H_
 #define NS_LIB_PY_OBJ_COAP_H_
 
-#define COAP_RES_OBJ_ALL_NUM 2
+// Maximum number of coap resources, 0 leaves it to the MicroPython heap
+#ifndef COAP_RES_OBJ_ALL_NUM
+#define COAP_RES_OBJ_ALL_NUM 0
+#endif
 
 #define COAP_RES_HANDLER(name) \
     static void name(coap_message_t *request, coap_message_t *response, uint8_t *buffer, uint16_t preferred_size, int32_t *offset)
 
-#define COAP_RES_PERIODIC_HANDLER(name) \
-    static void name(void); \
-    static coap_periodic_resource_t res_##name = { 0, { 0 }, name }
-    
 
 typedef int ns_coap_res_id_t;
-typedef void (*ns_coap_client_msg_handler_t)(coap_message_t *response);
 
 typedef struct _ns_coap_res_obj_t {
     mp_obj_base_t base;
@@ -27,6 +25,7 @@ typedef struct _ns_coap_res_obj_t {
     coap_notification_flag_t obs_flag;
     ns_coap_res_id_t id;
     coap_resource_t res;
+    coap_periodic_resource_t periodic;
     coap_message_t client_request[1];
     coap_endpoint_t end_point;
     uip_ipaddr_t end_point_ipaddr;
@@ -38,21 +37,4 @@ typedef struct _ns_coap_res_obj_t {
     bool is_initialized;
 } ns_coap_res_obj_t;
 
-typedef struct _ns_coap_res_obj_all_t {
-    ns_coap_res_obj_t res[COAP_RES_OBJ_ALL_NUM];
-    uint8_t remain;
-} ns_coap_res_obj_all_t;
-
-struct ns_coap_resource_handler_s {
-    coap_resource_handler_t get;
-    coap_resource_handler_t post;
-    coap_resource_handler_t put;
-    coap_resource_handler_t del;
-    coap_periodic_resource_t *periodic;
-    ns_coap_client_msg_handler_t client_msg;
-    notification_callback_t obs_notif;
-};
-
-typedef struct ns_coap_resource_handler_s ns_coap_resource_handler_t;
-
 #endif // NS_LIB_PY_OBJ_COAP_H_
@@ -1,10 +1,30 @@
 #include "py/nlr.h"
 #include "py/runtime.h"
+#include "ns/contiki.h"
+#include "ns/net/queuebuf.h"
+#include "ns/net/ipv6/sicslowpan.h"
+#if MAC_CONF_WITH_CSMA
+#include "ns/net/mac/csma/csma-output.h"
+#endif
 
 // Example usage to Platform objects
 //
 //      platform = nespy.Platform()
 //      platform.process_update() # use to update low level driver process
+//      platform.process_wait()   # same as process_update() but sleep until the
+//                                # next netstack deadline or driver activity
+//      platform.radio_neighbors([1, 3]) # only send radio frames to these nodes
+//      platform.etimer_stats()   # (expirations, mean, max) etimer wakeup
+//                                # latency past the deadline in microseconds
+//      platform.queuebuf_stats() # (copied, shared, freed) packet bytes copied
+//                                # and shared by queuebufs, packets freed
+//      platform.reass_stats()    # (reassembled, timeouts, no_context, invalid,
+//                                # duplicates, forwarded, forwarded_fragments,
+//                                # forward_dropped) 6lowpan reassembly and
+//                                # fragment forwarding counters
+//      platform.csma_stats()     # [(lladdr, queue_len, max_queue_len, tx,
+//                                # drops, failed, backoffs, collisions,
+//                                # bursts), ...] CSMA neighbor statistics
 
 const mp_obj_type_t ns_plat_type;
 
@@ -14,6 +34,11 @@ typedef struct _ns_plat_obj_t {
 
 #if defined(UNIX)
 extern void unix_process_update(void);
+extern void unix_process_wait(void);
+extern void unix_radio_set_neighbors(const uint16_t *ids, size_t num);
+extern void unix_etimer_stats(unsigned long *expirations,
+                              unsigned long *mean_latency,
+                              unsigned long *max_latency);
 #endif
 
 STATIC mp_obj_t ns_plat_make_new(const mp_obj_type_t *type,
@@ -39,10 +64,130 @@ STATIC mp_obj_t ns_plat_process_update(mp_obj_t self_in)
     return mp_const_none;
 }
 
+STATIC mp_obj_t ns_plat_process_wait(mp_obj_t self_in)
+{
+#if defined(UNIX)
+    unix_process_wait();
+#endif
+    return mp_const_none;
+}
+
+STATIC mp_obj_t ns_plat_radio_neighbors(mp_obj_t self_in, mp_obj_t ids_in)
+{
+#if defined(UNIX)
+    size_t len;
+    mp_obj_t *items;
+    mp_obj_get_array(ids_in, &len, &items);
+    uint16_t *ids = m_new(uint16_t, len);
+    for (size_t i = 0; i < len; i++) {
+        ids[i] = (uint16_t)mp_obj_get_int(items[i]);
+    }
+    unix_radio_set_neighbors(ids, len);
+    m_del(uint16_t, ids, len);
+#else
+    nlr_raise(mp_obj_new_exception_msg_varg(&mp_type_ValueError,
+                "ns: this feature only available in unix build"));
+#endif
+    return mp_const_none;
+}
+
+STATIC mp_obj_t ns_plat_etimer_stats(mp_obj_t self_in)
+{
+#if defined(UNIX)
+    unsigned long expirations, mean_latency, max_latency;
+    unix_etimer_stats(&expirations, &mean_latency, &max_latency);
+    mp_obj_t tuple[3] = {
+        mp_obj_new_int_from_uint(expirations),
+        mp_obj_new_int_from_uint(mean_latency),
+        mp_obj_new_int_from_uint(max_latency),
+    };
+    return mp_obj_new_tuple(3, tuple);
+#else
+    nlr_raise(mp_obj_new_exception_msg_varg(&mp_type_ValueError,
+                "ns: this feature only available in unix build"));
+#endif
+}
+
+STATIC mp_obj_t ns_plat_queuebuf_stats(mp_obj_t self_in)
+{
+#if QUEUEBUF_STATS
+    mp_obj_t tuple[3] = {
+        mp_obj_new_int_from_uint(queuebuf_bytes_copied),
+        mp_obj_new_int_from_uint(queuebuf_bytes_shared),
+        mp_obj_new_int_from_uint(queuebuf_num_freed),
+    };
+    return mp_obj_new_tuple(3, tuple);
+#else
+    nlr_raise(mp_obj_new_exception_msg_varg(&mp_type_ValueError,
+                "ns: queuebuf stats not enabled in this build"));
+#endif
+}
+
+STATIC mp_obj_t ns_plat_reass_stats(mp_obj_t self_in)
+{
+#if SICSLOWPAN_CONF_FRAG
+    mp_obj_t tuple[8] = {
+        mp_obj_new_int_from_uint(sicslowpan_reass_stats.reassembled),
+        mp_obj_new_int_from_uint(sicslowpan_reass_stats.timeouts),
+        mp_obj_new_int_from_uint(sicslowpan_reass_stats.no_context),
+        mp_obj_new_int_from_uint(sicslowpan_reass_stats.invalid),
+        mp_obj_new_int_from_uint(sicslowpan_reass_stats.duplicates),
+        mp_obj_new_int_from_uint(sicslowpan_reass_stats.forwarded),
+        mp_obj_new_int_from_uint(sicslowpan_reass_stats.forwarded_fragments),
+        mp_obj_new_int_from_uint(sicslowpan_reass_stats.forward_dropped),
+    };
+    return mp_obj_new_tuple(8, tuple);
+#else
+    nlr_raise(mp_obj_new_exception_msg_varg(&mp_type_ValueError,
+                "ns: 6lowpan fragmentation not enabled in this build"));
+#endif
+}
+
+STATIC mp_obj_t ns_plat_csma_stats(mp_obj_t self_in)
+{
+#if MAC_CONF_WITH_CSMA
+    struct csma_neighbor_stats stats;
+    linkaddr_t addr;
+    mp_obj_t list = mp_obj_new_list(0, NULL);
+    int i;
+
+    for (i = 0; csma_output_stats(i, &addr, &stats); i++) {
+        mp_obj_t tuple[9] = {
+            mp_obj_new_bytes(addr.u8, LINKADDR_SIZE),
+            MP_OBJ_NEW_SMALL_INT(stats.queue_len),
+            MP_OBJ_NEW_SMALL_INT(stats.max_queue_len),
+            mp_obj_new_int_from_uint(stats.tx),
+            mp_obj_new_int_from_uint(stats.drops),
+            mp_obj_new_int_from_uint(stats.failed),
+            mp_obj_new_int_from_uint(stats.backoffs),
+            mp_obj_new_int_from_uint(stats.collisions),
+            mp_obj_new_int_from_uint(stats.bursts),
+        };
+        mp_obj_list_append(list, mp_obj_new_tuple(9, tuple));
+    }
+    return list;
+#else
+    nlr_raise(mp_obj_new_exception_msg_varg(&mp_type_ValueError,
+                "ns: csma not enabled in this build"));
+#endif
+}
+
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(ns_plat_process_update_obj, ns_plat_process_update);
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(ns_plat_process_wait_obj, ns_plat_process_wait);
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(ns_plat_radio_neighbors_obj, ns_plat_radio_neighbors);
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(ns_plat_etimer_stats_obj, ns_plat_etimer_stats);
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(ns_plat_queuebuf_stats_obj, ns_plat_queuebuf_stats);
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(ns_plat_reass_stats_obj, ns_plat_reass_stats);
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(ns_plat_csma_stats_obj, ns_plat_csma_stats);
 
 STATIC const mp_rom_map_elem_t ns_plat_locals_dict_table[] = {
     { MP_ROM_QSTR(MP_QSTR_process_update), MP_ROM_PTR(&ns_plat_process_update_obj) },
+    { MP_ROM_QSTR(MP_QSTR_process_wait), MP_ROM_PTR(&ns_plat_process_wait_obj) },
+    { MP_ROM_QSTR(MP_QSTR_radio_neighbors), MP_ROM_PTR(&ns_plat_radio_neighbors_obj) },
+    { MP_ROM_QSTR(MP_QSTR_etimer_stats), MP_ROM_PTR(&ns_plat_etimer_stats_obj) },
+    { MP_ROM_QSTR(MP_QSTR_queuebuf_stats), MP_ROM_PTR(&ns_plat_queuebuf_stats_obj) },
+    { MP_ROM_QSTR(MP_QSTR_reass_stats), MP_ROM_PTR(&ns_plat_reass_stats_obj) },
+    { MP_ROM_QSTR(MP_QSTR_csma_stats), MP_ROM_PTR(&ns_plat_csma_stats_obj) },
 };
 
 STATIC MP_DEFINE_CONST_DICT(ns_plat_locals_dict, ns_plat_locals_dict_table);
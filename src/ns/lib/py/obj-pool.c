@@ -0,0 +1,63 @@
+#include "py/nlr.h"
+#include "py/runtime.h"
+#include "ns/lib/py/obj-pool.h"
+#include <string.h>
+
+// grow the slot array to `len` slots, new slots are empty
+void ns_obj_pool_reserve(ns_obj_pool_t *pool, size_t len)
+{
+    if (pool->max != 0 && len > pool->max) {
+        len = pool->max;
+    }
+    if (len <= pool->len) {
+        return;
+    }
+    mp_obj_t *slot = m_renew(mp_obj_t, *pool->slot, pool->len, len);
+    memset(&slot[pool->len], 0, (len - pool->len) * sizeof(mp_obj_t));
+    *pool->slot = slot;
+    pool->len = len;
+}
+
+// store `obj` in the first free slot and return its id, -1 when full
+int ns_obj_pool_add(ns_obj_pool_t *pool, mp_obj_t obj)
+{
+    if (pool->used == pool->len) {
+        if (pool->max != 0 && pool->len >= pool->max) {
+            return -1;
+        }
+        ns_obj_pool_reserve(pool, pool->len ? pool->len * 2 : NS_OBJ_POOL_INIT_LEN);
+    }
+
+    mp_obj_t *slot = *pool->slot;
+    for (size_t i = pool->free_hint; i < pool->len; i++) {
+        if (slot[i] == MP_OBJ_NULL) {
+            slot[i] = obj;
+            pool->used++;
+            pool->free_hint = i + 1;
+            return (int)i;
+        }
+    }
+
+    return -1;
+}
+
+// release slot `id`, the object is left to the garbage collector
+void ns_obj_pool_remove(ns_obj_pool_t *pool, int id)
+{
+    if (ns_obj_pool_get(pool, id) == MP_OBJ_NULL) {
+        return;
+    }
+    (*pool->slot)[id] = MP_OBJ_NULL;
+    pool->used--;
+    if ((size_t)id < pool->free_hint) {
+        pool->free_hint = id;
+    }
+}
+
+size_t ns_obj_pool_remain(const ns_obj_pool_t *pool)
+{
+    if (pool->max == 0) {
+        return pool->len - pool->used;
+    }
+    return pool->max - pool->used;
+}
@@ -0,0 +1,38 @@
+#ifndef NS_LIB_PY_OBJ_POOL_H_
+#define NS_LIB_PY_OBJ_POOL_H_
+
+#include "py/obj.h"
+
+// Number of slots allocated the first time an object is added to a pool,
+// the slot array doubles every time it runs full
+#define NS_OBJ_POOL_INIT_LEN 4
+
+// Object pool used by the bindings that hand their objects over to the
+// network stack (threads, coap resources). The slot array lives on the
+// MicroPython heap and is referenced from a port root pointer, so every
+// object kept in the pool stays alive while the stack can call back into it.
+// The slot index is the object id and is used for O(1) lookups on dispatch.
+typedef struct _ns_obj_pool_t {
+    mp_obj_t **slot;    // root pointer holding the slot array
+    size_t len;         // allocated slots
+    size_t used;        // occupied slots
+    size_t max;         // capacity limit, 0 for unlimited
+    size_t free_hint;   // lowest slot that may be free
+} ns_obj_pool_t;
+
+#define NS_OBJ_POOL(root, max) { &MP_STATE_PORT(root), 0, 0, (max), 0 }
+
+int ns_obj_pool_add(ns_obj_pool_t *pool, mp_obj_t obj);
+void ns_obj_pool_remove(ns_obj_pool_t *pool, int id);
+void ns_obj_pool_reserve(ns_obj_pool_t *pool, size_t len);
+size_t ns_obj_pool_remain(const ns_obj_pool_t *pool);
+
+static inline mp_obj_t ns_obj_pool_get(const ns_obj_pool_t *pool, int id)
+{
+    if (id < 0 || (size_t)id >= pool->len) {
+        return MP_OBJ_NULL;
+    }
+    return (*pool->slot)[id];
+}
+
+#endif // NS_LIB_PY_OBJ_POOL_H_
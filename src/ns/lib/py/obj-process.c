@@ -1,8 +1,8 @@
 #include "py/nlr.h"
 #include "py/runtime.h"
-#include "ns/sys/int-master.h"
 #include "ns/lib/py/obj-process.h"
 #include <stdio.h>
+#include <string.h>
 
 // Example usage to Process & Thread objects
 //
@@ -19,48 +19,66 @@
 //      test.post(event, data)           # post event with data to `test` process thread
 //      test.delete()                    # delete `test` process thread
 //      print(test)                      # print this thread information
+//
+//      # batched delivery: events are collected while the event queue is
+//      # busy and handed over at once, cb(events, data) gets two lists
+//      # that are reused for the next batch
+//      test = nespy.Thread(callback=cb, batch=64)
 
 const mp_obj_type_t ns_process_type;
 const mp_obj_type_t ns_thread_type;
 
-static ns_thread_obj_all_t thread_obj_all;
+// thread objects owned by their running process, indexed by thread id
+static ns_obj_pool_t thread_pool = NS_OBJ_POOL(ns_thread_pool, THREAD_OBJ_ALL_NUM);
 static bool is_process_obj_created = false;
-static ns_thread_id_t thread_get_id(void);
-
-PROCESS(thread0, "thread0");
-PROCESS(thread1, "thread1");
-PROCESS(thread2, "thread2");
-PROCESS(thread3, "thread3");
-PROCESS(thread4, "thread4");
-PROCESS(thread5, "thread5");
-PROCESS(thread6, "thread6");
-PROCESS(thread7, "thread7");
-PROCESS(thread8, "thread8");
-PROCESS(thread9, "thread9");
-
-struct process *ns_process[] = {
-    &thread0,
-    &thread1,
-    &thread2,
-    &thread3,
-    &thread4,
-    &thread5,
-    &thread6,
-    &thread7,
-    &thread8,
-    &thread9,
-};
-
-NS_PROCESS_THREAD(0);
-NS_PROCESS_THREAD(1);
-NS_PROCESS_THREAD(2);
-NS_PROCESS_THREAD(3);
-NS_PROCESS_THREAD(4);
-NS_PROCESS_THREAD(5);
-NS_PROCESS_THREAD(6);
-NS_PROCESS_THREAD(7);
-NS_PROCESS_THREAD(8);
-NS_PROCESS_THREAD(9);
+// batched threads holding events, polled once the event queue drained
+static ns_thread_obj_t *batch_pending;
+
+static mp_obj_t thread_take_data(ns_thread_obj_t *self, process_data_t data);
+static void thread_clear_posted(ns_thread_obj_t *self);
+static void thread_batch_add(ns_thread_obj_t *self, process_event_t ev, mp_obj_t data);
+static void thread_batch_clear(ns_thread_obj_t *self);
+static void thread_batch_flush(ns_thread_obj_t *self);
+static void thread_batch_dequeue(ns_thread_obj_t *self);
+
+// every thread object embeds its own process running this protothread, the
+// object is recovered from the process it is called for
+static PT_THREAD(ns_thread_process(struct pt *process_pt,
+                                   process_event_t ev,
+                                   process_data_t data))
+{
+    ns_thread_obj_t *self = (ns_thread_obj_t *)
+        ((char *)process_pt - offsetof(ns_thread_obj_t, process.pt));
+
+    PROCESS_BEGIN();
+    while (1) {
+        PROCESS_WAIT_EVENT();
+        if (ev == PROCESS_EVENT_EXIT) {
+            // the process is unlinked and its pending events are dropped
+            // right after, no python code runs until then. So are the
+            // events of a batch not delivered yet.
+            self->cb = mp_const_none;
+            thread_clear_posted(self);
+            self->is_used = false;
+            thread_batch_dequeue(self);
+            if (self->batch_size != 0) {
+                thread_batch_clear(self);
+            }
+            ns_obj_pool_remove(&thread_pool, self->id);
+            PROCESS_EXIT();
+        } else if (ev == PROCESS_EVENT_EXITED) {
+            continue;
+        } else if (self->batch_size == 0) {
+            mp_call_function_2(self->cb, MP_OBJ_NEW_SMALL_INT(ev),
+                               thread_take_data(self, data));
+        } else if (ev == PROCESS_EVENT_POLL) {
+            thread_batch_flush(self);
+        } else {
+            thread_batch_add(self, ev, thread_take_data(self, data));
+        }
+    }
+    PROCESS_END();
+}
 
 // process = ns.Process() constructor
 STATIC mp_obj_t ns_process_make_new(const mp_obj_type_t *type,
@@ -75,15 +93,6 @@ STATIC mp_obj_t ns_process_make_new(const mp_obj_type_t *type,
     if (is_process_obj_created) {
         nlr_raise(mp_obj_new_exception_msg_varg(&mp_type_ValueError,
                   "ns: can't create more than one process object"));
-    } else {
-        // initialize thread status
-        for (int i = 0; i < THREAD_OBJ_ALL_NUM; i++) {
-            thread_obj_all.thread[i].cb = mp_const_none;
-            thread_obj_all.thread[i].id = 0;
-            thread_obj_all.thread[i].data = mp_const_none;
-            thread_obj_all.thread[i].is_used = false;
-        }
-        thread_obj_all.remain = THREAD_OBJ_ALL_NUM;
     }
 
     // create process object
@@ -97,7 +106,11 @@ STATIC mp_obj_t ns_process_make_new(const mp_obj_type_t *type,
 // process.run()
 STATIC mp_obj_t ns_process_run(mp_obj_t self_in)
 {
-    return mp_obj_new_int(process_run());
+    int ret = process_run();
+    if (ret == 0) {
+        ret = ns_thread_flush();
+    }
+    return mp_obj_new_int(ret);
 }
 
 // process.autostart()
@@ -125,6 +138,10 @@ STATIC void ns_process_print(const mp_print_t *print,
     }
     mp_printf(print, "ns: ----------------\n");
     mp_printf(print, "ns: process events waiting (%d)", process_nevents());
+#if PROCESS_CONF_STATS
+    mp_printf(print, "\nns: process events max (%d) dropped (%lu)",
+              (int)process_maxevents, process_dropped_events);
+#endif
 }
 
 // test = ns.Thread(callback=cb) # thread creation
@@ -144,9 +161,10 @@ STATIC mp_obj_t ns_thread_make_new(const mp_obj_type_t *type,
                   "ns: invalid argument!"));
     }
 
-    enum { ARG_callback };
+    enum { ARG_callback, ARG_batch };
     static const mp_arg_t allowed_args[] = {
         { MP_QSTR_callback, MP_ARG_KW_ONLY | MP_ARG_OBJ, {.u_obj = mp_const_none} },
+        { MP_QSTR_batch,    MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = 0} },
     };
 
     // parse args
@@ -159,26 +177,45 @@ STATIC mp_obj_t ns_thread_make_new(const mp_obj_type_t *type,
                   "ns: thread callback can't empty!"));
     }
 
-    // get valid thread id and assigned PROCESS_EVENT_INT to this thread event
-    ns_thread_id_t thread_id = thread_get_id();
+    if (args[ARG_batch].u_int < 0) {
+        nlr_raise(mp_obj_new_exception_msg_varg(&mp_type_ValueError,
+                  "ns: thread batch can't be negative!"));
+    }
+
+    // create thread object, the pool slot it lands in is its thread id
+    ns_thread_obj_t *t = m_new0(ns_thread_obj_t, 1);
+    t->base.type = &ns_thread_type;
+    t->cb = args[ARG_callback].u_obj;
+    t->posted = mp_obj_new_list(0, NULL);
+#if !PROCESS_CONF_NO_PROCESS_NAMES
+    t->process.name = "thread";
+#endif
+    t->process.thread = ns_thread_process;
+    t->process.priority = PROCESS_PRIORITY_APP;
+    t->batch_size = args[ARG_batch].u_int;
+    if (t->batch_size != 0) {
+        // room for a full batch up front, nothing is allocated on delivery
+        t->batch_events = mp_obj_new_list(t->batch_size, NULL);
+        t->batch_data = mp_obj_new_list(t->batch_size, NULL);
+        mp_obj_list_set_len(t->batch_events, 0);
+        mp_obj_list_set_len(t->batch_data, 0);
+    }
+    t->id = ns_obj_pool_add(&thread_pool, MP_OBJ_FROM_PTR(t));
 
-    if (thread_id < 0) {
+    if (t->id < 0) {
+#if THREAD_OBJ_ALL_NUM
         nlr_raise(mp_obj_new_exception_msg_varg(&mp_type_ValueError,
                   "ns: thread container overflow! max(%d)",
                   THREAD_OBJ_ALL_NUM));
+#else
+        // no limit, only running out of memory stops the pool
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_MemoryError,
+                  "ns: thread container overflow!"));
+#endif
     }
 
-    // create thread object
-    ns_thread_obj_t *t = m_new_obj(ns_thread_obj_t);
-    t->base.type = &ns_thread_type;
-    t->cb = args[ARG_callback].u_obj;
-    t->id = thread_id;
-    t->data = mp_const_none;
     t->is_used = true;
 
-    // store this object to thread obj all container
-    thread_obj_all.thread[t->id] = *t;
-
     return MP_OBJ_FROM_PTR(t);
 }
 
@@ -186,7 +223,12 @@ STATIC mp_obj_t ns_thread_make_new(const mp_obj_type_t *type,
 STATIC mp_obj_t ns_thread_start(mp_obj_t self_in)
 {
     ns_thread_obj_t *self = MP_OBJ_TO_PTR(self_in);
-    process_start(ns_process[self->id], NULL);
+    if (!self->is_used) {
+        nlr_raise(mp_obj_new_exception_msg_varg(&mp_type_ValueError,
+                  "ns: thread id (%d) is not used",
+                  (int)self->id));
+    }
+    process_start(&self->process, NULL);
     return mp_const_none;
 }
 
@@ -194,7 +236,7 @@ STATIC mp_obj_t ns_thread_start(mp_obj_t self_in)
 STATIC mp_obj_t ns_thread_is_running(mp_obj_t self_in)
 {
     ns_thread_obj_t *self = MP_OBJ_TO_PTR(self_in);
-    bool ret = process_is_running(ns_process[self->id]) ? true : false;
+    bool ret = self->is_used && process_is_running(&self->process);
     return mp_obj_new_bool(ret);
 }
 
@@ -204,10 +246,31 @@ STATIC mp_obj_t ns_thread_post(mp_obj_t self_in,
                                mp_obj_t data_in)
 {
     ns_thread_obj_t *self = MP_OBJ_TO_PTR(self_in);
-    self = &thread_obj_all.thread[self->id];
-    self->data = data_in;
+    if (!self->is_used) {
+        nlr_raise(mp_obj_new_exception_msg_varg(&mp_type_ValueError,
+                  "ns: thread id (%d) is not used",
+                  (int)self->id));
+    }
     process_event_t event = (process_event_t)mp_obj_get_int(event_in);
-    process_post(ns_process[self->id], event, NULL);
+    // a thread not started yet would never take the data, the event is
+    // lost as it would be on delivery
+    if (!process_is_running(&self->process)) {
+        return mp_const_none;
+    }
+    // the event carries the data object, kept reachable until delivered
+    mp_obj_list_append(self->posted, data_in);
+    if (process_post(&self->process, event, (process_data_t)data_in) != PROCESS_ERR_OK) {
+        size_t len;
+        mp_obj_t *items;
+        mp_obj_list_get(self->posted, &len, &items);
+        items[len - 1] = MP_OBJ_NULL;
+        mp_obj_list_set_len(self->posted, len - 1);
+        if (self->posted_head == len - 1) {
+            // every other entry was taken already
+            mp_obj_list_set_len(self->posted, 0);
+            self->posted_head = 0;
+        }
+    }
     return mp_const_none;
 }
 
@@ -215,7 +278,7 @@ STATIC mp_obj_t ns_thread_delete(mp_obj_t self_in)
 {
     ns_thread_obj_t *self = MP_OBJ_TO_PTR(self_in);
     if (self->is_used) {
-        process_post(ns_process[self->id], PROCESS_EVENT_EXIT, NULL);
+        process_post(&self->process, PROCESS_EVENT_EXIT, NULL);
     } else {
         nlr_raise(mp_obj_new_exception_msg_varg(&mp_type_ValueError,
                   "ns: thread id (%d) is not used",
@@ -231,8 +294,9 @@ STATIC void ns_thread_print(const mp_print_t *print,
     ns_thread_obj_t *self = MP_OBJ_TO_PTR(self_in);
     mp_printf(print, "ns: thread id (%d)\n", (int)self->id);
     mp_printf(print, "ns: thread is running (%s)\n",
-              process_is_running(ns_process[self->id]) ? "1" : "0");
-    mp_printf(print, "ns: thread resource remain (%d)", (int)thread_obj_all.remain);
+              self->is_used && process_is_running(&self->process) ? "1" : "0");
+    mp_printf(print, "ns: thread batch (%d)\n", (int)self->batch_size);
+    mp_printf(print, "ns: thread resource remain (%d)", (int)ns_obj_pool_remain(&thread_pool));
 }
 
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(ns_process_run_obj, ns_process_run);
@@ -276,30 +340,132 @@ const mp_obj_type_t ns_thread_type = {
     .locals_dict = (mp_obj_dict_t *)&ns_thread_locals_dict,
 };
 
-static ns_thread_id_t thread_get_id(void)
+// posted data -----------------------------------------------------------------
+
+// events are delivered in the order they were posted, so the data is almost
+// always found at the head. Taken entries are cleared and the list is
+// emptied once all of them are. Events not posted by post(), timers or polls,
+// carry other data and get None.
+static mp_obj_t thread_take_data(ns_thread_obj_t *self, process_data_t data)
 {
-    int i;
-    bool is_get_id = false;
-    ns_thread_id_t id = 0;
+    size_t len, i;
+    mp_obj_t *items;
 
-    int_master_status_t int_status = int_master_read_and_disable();
+    if (data == NULL) {
+        return mp_const_none;
+    }
 
-    for (i = 0; i < THREAD_OBJ_ALL_NUM; i++) {
-        if (thread_obj_all.thread[i].is_used == false) {
-            is_get_id = true;
-            id = i;
-            break;
+    mp_obj_list_get(self->posted, &len, &items);
+    for (i = self->posted_head; i < len; i++) {
+        if (items[i] == (mp_obj_t)data) {
+            items[i] = MP_OBJ_NULL;
+            while (self->posted_head < len && items[self->posted_head] == MP_OBJ_NULL) {
+                self->posted_head++;
+            }
+            if (self->posted_head == len) {
+                mp_obj_list_set_len(self->posted, 0);
+                self->posted_head = 0;
+            }
+            return (mp_obj_t)data;
         }
     }
+    return mp_const_none;
+}
+
+static void thread_clear_posted(ns_thread_obj_t *self)
+{
+    size_t len;
+    mp_obj_t *items;
+
+    mp_obj_list_get(self->posted, &len, &items);
+    memset(items, 0, len * sizeof(mp_obj_t));
+    mp_obj_list_set_len(self->posted, 0);
+    self->posted_head = 0;
+}
+
+// batched delivery ------------------------------------------------------------
+
+static void thread_batch_add(ns_thread_obj_t *self, process_event_t ev, mp_obj_t data)
+{
+    size_t len;
+    mp_obj_t *items;
+
+    // appending stays within the preallocated room unless the callback
+    // shrank the lists, they grow back then
+    mp_obj_list_append(self->batch_events, MP_OBJ_NEW_SMALL_INT(ev));
+    mp_obj_list_append(self->batch_data, data);
+
+    mp_obj_list_get(self->batch_events, &len, &items);
+    if (len >= self->batch_size) {
+        thread_batch_flush(self);
+    } else if (!self->batch_queued) {
+        self->batch_queued = true;
+        self->batch_next = batch_pending;
+        batch_pending = self;
+    }
+}
+
+static void thread_batch_clear(ns_thread_obj_t *self)
+{
+    size_t len;
+    mp_obj_t *items;
+
+    // drop the references held by the last batch
+    mp_obj_list_get(self->batch_data, &len, &items);
+    memset(items, 0, len * sizeof(mp_obj_t));
+    mp_obj_list_set_len(self->batch_data, 0);
+    mp_obj_list_set_len(self->batch_events, 0);
+}
+
+static void thread_batch_flush(ns_thread_obj_t *self)
+{
+    size_t len;
+    mp_obj_t *items;
+    nlr_buf_t nlr;
+
+    mp_obj_list_get(self->batch_events, &len, &items);
+    if (len == 0) {
+        return;
+    }
 
-    if (!is_get_id) {
-        return -1;
+    if (nlr_push(&nlr) == 0) {
+        mp_call_function_2(self->cb, self->batch_events, self->batch_data);
+        nlr_pop();
+        thread_batch_clear(self);
+    } else {
+        thread_batch_clear(self);
+        nlr_jump(nlr.ret_val);
     }
+}
 
-    thread_obj_all.remain--;
+static void thread_batch_dequeue(ns_thread_obj_t *self)
+{
+    ns_thread_obj_t **tp;
 
-    int_master_status_set(int_status);
-    int_master_enable();
+    for (tp = &batch_pending; *tp != NULL; tp = &(*tp)->batch_next) {
+        if (*tp == self) {
+            *tp = self->batch_next;
+            break;
+        }
+    }
+    self->batch_next = NULL;
+    self->batch_queued = false;
+}
+
+// poll every thread holding a batch, they deliver it from their own process
+// so that timers set by the callback stay bound to the thread
+int ns_thread_flush(void)
+{
+    int n = 0;
+
+    while (batch_pending != NULL) {
+        ns_thread_obj_t *t = batch_pending;
+        batch_pending = t->batch_next;
+        t->batch_next = NULL;
+        t->batch_queued = false;
+        process_poll(&t->process);
+        n++;
+    }
 
-    return id;
+    return n;
 }
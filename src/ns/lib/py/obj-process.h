@@ -2,33 +2,12 @@
 #define NS_LIB_PY_OBJ_PROCESS_H_
 
 #include "ns/contiki.h"
+#include "ns/lib/py/obj-pool.h"
 
-#define THREAD_OBJ_ALL_NUM 10
-
-#define NS_PROCESS_THREAD(n)                                                  \
-PROCESS_THREAD(thread ## n, ev, data) {                                       \
-    PROCESS_BEGIN();                                                          \
-    while (1) {                                                               \
-        PROCESS_WAIT_EVENT();                                                 \
-        ns_thread_obj_t *self = &thread_obj_all.thread[n];                    \
-        if (ev != PROCESS_EVENT_EXIT) {                                       \
-            if (self->is_used) {                                              \
-                mp_obj_t event = mp_obj_new_int_from_uint(ev);                \
-                mp_call_function_2(self->cb, event, self->data);              \
-                self->data = mp_const_none;                                   \
-            }                                                                 \
-        } else {                                                              \
-            self->cb = mp_const_none;                                         \
-            self->id = 0;                                                     \
-            self->data = mp_const_none;                                       \
-            self->is_used = false;                                            \
-            thread_obj_all.thread[n] = *self;                                 \
-            thread_obj_all.remain++;                                          \
-            PROCESS_EXIT();                                                   \
-        }                                                                     \
-    }                                                                         \
-    PROCESS_END();                                                            \
-}
+// Maximum number of threads, 0 leaves it to the MicroPython heap
+#ifndef THREAD_OBJ_ALL_NUM
+#define THREAD_OBJ_ALL_NUM 0
+#endif
 
 typedef int ns_thread_id_t;
 
@@ -36,17 +15,24 @@ typedef struct _ns_thread_obj_t {
     mp_obj_base_t base;
     mp_obj_t cb;
     ns_thread_id_t id;
-    mp_obj_t data;
+    // data of the events posted and not delivered yet, the event carries
+    // the object itself and this list keeps it reachable until then
+    mp_obj_t posted;
+    size_t posted_head;
     bool is_used;
+    struct process process;
+    // batched delivery, the callback gets lists of events and data
+    mp_obj_t batch_events;
+    mp_obj_t batch_data;
+    size_t batch_size;
+    bool batch_queued;
+    struct _ns_thread_obj_t *batch_next;
 } ns_thread_obj_t;
 
-typedef struct _ns_thread_obj_all_t {
-    ns_thread_obj_t thread[THREAD_OBJ_ALL_NUM];
-    uint8_t remain;
-} ns_thread_obj_all_t;
-
 typedef struct _ns_process_base_obj_t {
     mp_obj_base_t base;
 } ns_process_base_obj_t;
 
+int ns_thread_flush(void);
+
 #endif // NS_LIB_PY_OBJ_PROCESS_H_
@@ -93,6 +93,12 @@
 #define COAP_MAX_HEADER_SIZE           (4 + COAP_TOKEN_LEN + 3 + 1 + COAP_ETAG_LEN + 4 + 4 + 30)  /* 65 */
 #endif /* COAP_MAX_HEADER_SIZE */
 
+/* Number of slots of the hash table that dispatches requests to
+   resources, a power of two. 0 walks the resource list instead. */
+#ifndef COAP_RESOURCE_HASH_SIZE
+#define COAP_RESOURCE_HASH_SIZE        0
+#endif /* COAP_RESOURCE_HASH_SIZE */
+
 /* Number of observer slots (each takes abot xxx bytes) */
 #ifndef COAP_MAX_OBSERVERS
 #define COAP_MAX_OBSERVERS    COAP_MAX_OPEN_TRANSACTIONS - 1
@@ -71,6 +71,32 @@ static int invoke_coap_resource_service(coap_message_t *request,
 LIST(coap_handlers);
 LIST(coap_resource_services);
 static uint8_t is_initialized = 0;
+static coap_resource_t *current_resource;
+
+#if COAP_RESOURCE_HASH_SIZE
+/*
+ * Resources hashed on their full URL, with linear probing. A request
+ * is looked up under its full path and under each prefix that ends
+ * before a '/', for the parent resources. The activation order breaks
+ * ties the same way the walk over the resource list does.
+ */
+#define RESOURCE_HASH_MASK (COAP_RESOURCE_HASH_SIZE - 1)
+/* Deepest path the hashed lookup handles, longer ones walk the list */
+#define RESOURCE_HASH_MAX_SEGMENTS 16
+
+typedef struct {
+  coap_resource_t *resource;
+  uint32_t hash;
+  uint32_t order;
+  uint16_t url_len;
+} resource_slot_t;
+
+static resource_slot_t resource_hash[COAP_RESOURCE_HASH_SIZE];
+static uint16_t resource_hash_count;
+static uint32_t resource_order;
+/* Set when a resource did not fit, the list walk is used from then on */
+static uint8_t resource_hash_full;
+#endif /* COAP_RESOURCE_HASH_SIZE */
 
 /*---------------------------------------------------------------------------*/
 /*- CoAP service handlers---------------------------------------------------*/
@@ -379,12 +405,105 @@ coap_engine_init(void)
 
   list_init(coap_handlers);
   list_init(coap_resource_services);
+#if COAP_RESOURCE_HASH_SIZE
+  memset(resource_hash, 0, sizeof(resource_hash));
+  resource_hash_count = 0;
+  resource_hash_full = 0;
+#endif /* COAP_RESOURCE_HASH_SIZE */
 
   coap_activate_resource(&res_well_known_core, ".well-known/core");
 
   coap_transport_init();
   coap_init_connection();
 }
+#if COAP_RESOURCE_HASH_SIZE
+/*---------------------------------------------------------------------------*/
+static uint32_t
+url_hash_step(uint32_t hash, char c)
+{
+  /* FNV-1a, one byte at a time so that prefixes come for free */
+  return (hash ^ (uint8_t)c) * 16777619UL;
+}
+#define URL_HASH_INIT 2166136261UL
+/*---------------------------------------------------------------------------*/
+static void
+resource_hash_remove(coap_resource_t *resource)
+{
+  unsigned i, j, home;
+
+  for(i = 0; i < COAP_RESOURCE_HASH_SIZE; i++) {
+    if(resource_hash[i].resource == resource) {
+      break;
+    }
+  }
+  if(i == COAP_RESOURCE_HASH_SIZE) {
+    return;
+  }
+
+  /* Backward shift deletion keeps the probe sequences intact */
+  resource_hash[i].resource = NULL;
+  resource_hash_count--;
+  for(j = (i + 1) & RESOURCE_HASH_MASK; resource_hash[j].resource != NULL;
+      j = (j + 1) & RESOURCE_HASH_MASK) {
+    home = resource_hash[j].hash & RESOURCE_HASH_MASK;
+    if(((j - home) & RESOURCE_HASH_MASK) >= ((j - i) & RESOURCE_HASH_MASK)) {
+      resource_hash[i] = resource_hash[j];
+      resource_hash[j].resource = NULL;
+      i = j;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+resource_hash_add(coap_resource_t *resource)
+{
+  uint32_t hash = URL_HASH_INIT;
+  size_t len;
+  unsigned i;
+
+  resource_hash_remove(resource);
+
+  len = strlen(resource->url);
+  /* Keep one slot free so that probing always ends */
+  if(resource_hash_count >= COAP_RESOURCE_HASH_SIZE - 1 || len > UINT16_MAX) {
+    LOG_WARN("resource hash full, dispatching with the resource list\r\n");
+    resource_hash_full = 1;
+    return;
+  }
+
+  for(i = 0; i < len; i++) {
+    hash = url_hash_step(hash, resource->url[i]);
+  }
+  for(i = hash & RESOURCE_HASH_MASK; resource_hash[i].resource != NULL;
+      i = (i + 1) & RESOURCE_HASH_MASK);
+  resource_hash[i].resource = resource;
+  resource_hash[i].hash = hash;
+  resource_hash[i].order = resource_order++;
+  resource_hash[i].url_len = len;
+  resource_hash_count++;
+}
+/*---------------------------------------------------------------------------*/
+/* The first activated resource with the URL url[0..len) */
+static resource_slot_t *
+resource_hash_find(uint32_t hash, const char *url, int len, int sub,
+                   resource_slot_t *best)
+{
+  unsigned i;
+  resource_slot_t *s;
+
+  for(i = hash & RESOURCE_HASH_MASK; resource_hash[i].resource != NULL;
+      i = (i + 1) & RESOURCE_HASH_MASK) {
+    s = &resource_hash[i];
+    if(s->hash == hash && s->url_len == len
+       && (!sub || (s->resource->flags & HAS_SUB_RESOURCES))
+       && (best == NULL || s->order < best->order)
+       && memcmp(s->resource->url, url, len) == 0) {
+      best = s;
+    }
+  }
+  return best;
+}
+#endif /* COAP_RESOURCE_HASH_SIZE */
 /*---------------------------------------------------------------------------*/
 /**
  * \brief Makes a resource available under the given URI path
@@ -401,6 +520,9 @@ coap_activate_resource(coap_resource_t *resource, const char *path)
   coap_periodic_resource_t *periodic;
   resource->url = path;
   list_add(coap_resource_services, resource);
+#if COAP_RESOURCE_HASH_SIZE
+  resource_hash_add(resource);
+#endif /* COAP_RESOURCE_HASH_SIZE */
 
   LOG_INFO("Activating: %s\r\n", resource->url);
 
@@ -432,19 +554,55 @@ coap_get_next_resource(coap_resource_t *resource)
   return list_item_next(resource);
 }
 /*---------------------------------------------------------------------------*/
-static int
-invoke_coap_resource_service(coap_message_t *request, coap_message_t *response,
-                             uint8_t *buffer, uint16_t buffer_size,
-                             int32_t *offset)
+coap_resource_t *
+coap_get_current_resource(void)
 {
-  uint8_t found = 0;
-  uint8_t allowed = 1;
+  return current_resource;
+}
+/*---------------------------------------------------------------------------*/
+void
+coap_set_current_resource(coap_resource_t *resource)
+{
+  current_resource = resource;
+}
+/*---------------------------------------------------------------------------*/
+static coap_resource_t *
+find_resource(const char *url, int url_len)
+{
+  coap_resource_t *resource;
+  int res_url_len;
+
+#if COAP_RESOURCE_HASH_SIZE
+  if(!resource_hash_full) {
+    uint32_t hash = URL_HASH_INIT;
+    uint32_t prefix_hash[RESOURCE_HASH_MAX_SEGMENTS];
+    int prefix_len[RESOURCE_HASH_MAX_SEGMENTS];
+    int nprefix = 0;
+    resource_slot_t *best;
+    int i;
+
+    /* Hash the full path and every prefix a parent resource may have */
+    for(i = 0; i < url_len; i++) {
+      if(url[i] == '/') {
+        if(nprefix == RESOURCE_HASH_MAX_SEGMENTS) {
+          break;
+        }
+        prefix_hash[nprefix] = hash;
+        prefix_len[nprefix++] = i;
+      }
+      hash = url_hash_step(hash, url[i]);
+    }
 
-  coap_resource_t *resource = NULL;
-  const char *url = NULL;
-  int url_len, res_url_len;
+    if(i == url_len) {
+      best = resource_hash_find(hash, url, url_len, 0, NULL);
+      for(i = 0; i < nprefix; i++) {
+        best = resource_hash_find(prefix_hash[i], url, prefix_len[i], 1, best);
+      }
+      return best != NULL ? best->resource : NULL;
+    }
+  }
+#endif /* COAP_RESOURCE_HASH_SIZE */
 
-  url_len = coap_get_header_uri_path(request, &url);
   for(resource = list_head(coap_resource_services);
       resource; resource = resource->next) {
 
@@ -455,32 +613,53 @@ invoke_coap_resource_service(coap_message_t *request, coap_message_t *response,
             && (resource->flags & HAS_SUB_RESOURCES)
             && url[res_url_len] == '/'))
        && strncmp(resource->url, url, res_url_len) == 0) {
-      coap_resource_flags_t method = coap_get_method_type(request);
-      found = 1;
-
-      LOG_INFO("/%s, method %u, resource->flags %u\r\n", resource->url,
-               (uint16_t)method, resource->flags);
-
-      if((method & METHOD_GET) && resource->get_handler != NULL) {
-        /* call handler function */
-        resource->get_handler(request, response, buffer, buffer_size, offset);
-      } else if((method & METHOD_POST) && resource->post_handler != NULL) {
-        /* call handler function */
-        resource->post_handler(request, response, buffer, buffer_size,
+      return resource;
+    }
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+static int
+invoke_coap_resource_service(coap_message_t *request, coap_message_t *response,
+                             uint8_t *buffer, uint16_t buffer_size,
+                             int32_t *offset)
+{
+  uint8_t found = 0;
+  uint8_t allowed = 1;
+
+  coap_resource_t *resource = NULL;
+  const char *url = NULL;
+  int url_len;
+
+  url_len = coap_get_header_uri_path(request, &url);
+  resource = find_resource(url, url_len);
+  if(resource != NULL) {
+    coap_resource_flags_t method = coap_get_method_type(request);
+    found = 1;
+
+    LOG_INFO("/%s, method %u, resource->flags %u\r\n", resource->url,
+             (uint16_t)method, resource->flags);
+    current_resource = resource;
+
+    if((method & METHOD_GET) && resource->get_handler != NULL) {
+      /* call handler function */
+      resource->get_handler(request, response, buffer, buffer_size, offset);
+    } else if((method & METHOD_POST) && resource->post_handler != NULL) {
+      /* call handler function */
+      resource->post_handler(request, response, buffer, buffer_size,
+                             offset);
+    } else if((method & METHOD_PUT) && resource->put_handler != NULL) {
+      /* call handler function */
+      resource->put_handler(request, response, buffer, buffer_size, offset);
+    } else if((method & METHOD_DELETE) && resource->delete_handler != NULL) {
+      /* call handler function */
+      resource->delete_handler(request, response, buffer, buffer_size,
                                offset);
-      } else if((method & METHOD_PUT) && resource->put_handler != NULL) {
-        /* call handler function */
-        resource->put_handler(request, response, buffer, buffer_size, offset);
-      } else if((method & METHOD_DELETE) && resource->delete_handler != NULL) {
-        /* call handler function */
-        resource->delete_handler(request, response, buffer, buffer_size,
-                                 offset);
-      } else {
-        allowed = 0;
-        coap_set_status_code(response, METHOD_NOT_ALLOWED_4_05);
-      }
-      break;
+    } else {
+      allowed = 0;
+      coap_set_status_code(response, METHOD_NOT_ALLOWED_4_05);
     }
+    current_resource = NULL;
   }
   if(!found) {
     coap_set_status_code(response, NOT_FOUND_4_04);
@@ -508,7 +687,9 @@ process_callback(coap_timer_t *t)
       /* CoAP has not yet been initialized. */
     } else if(resource->periodic->periodic_handler) {
       /* Call the periodic_handler function. */
+      current_resource = resource;
       resource->periodic->periodic_handler();
+      current_resource = NULL;
     }
 
     coap_timer_set(t, resource->periodic->period);
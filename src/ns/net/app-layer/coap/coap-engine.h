@@ -167,6 +167,25 @@ coap_resource_t *coap_get_first_resource(void);
  */
 coap_resource_t *coap_get_next_resource(coap_resource_t *resource);
 /*---------------------------------------------------------------------------*/
+/**
+ * \brief      Returns the resource whose handler is being called.
+ * \return     The resource served by the running request or periodic
+ *             handler, NULL outside of a resource handler.
+ *
+ *             Lets a single handler function serve several resources.
+ */
+coap_resource_t *coap_get_current_resource(void);
+/*---------------------------------------------------------------------------*/
+/**
+ * \brief      Sets the resource returned by coap_get_current_resource()
+ * \param resource The resource whose handler is called next, or NULL
+ *
+ *             For code that calls a resource handler outside of the
+ *             engine, like observe notifications. The caller restores
+ *             the previous resource afterwards.
+ */
+void coap_set_current_resource(coap_resource_t *resource);
+/*---------------------------------------------------------------------------*/
 
 #include "coap-transactions.h"
 #include "coap-observe.h"
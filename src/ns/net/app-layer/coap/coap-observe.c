@@ -268,9 +268,14 @@ coap_notify_observers_sub(coap_resource_t *resource, const char *subpath)
           LOG_DBG("Notification on new handlers\r\n");
         } else {
           if(resource != NULL) {
+            /* The handler may serve several resources, and we may be called
+               from another resource's handler or from outside of any */
+            coap_resource_t *previous = coap_get_current_resource();
+            coap_set_current_resource(resource);
             resource->get_handler(request, notification,
                                   transaction->message + COAP_MAX_HEADER_SIZE,
                                   COAP_MAX_CHUNK_SIZE, &new_offset);
+            coap_set_current_resource(previous);
           } else {
             /* What to do here? */
             notification->code = BAD_REQUEST_4_00;
@@ -154,6 +154,16 @@ dtls_session_equals(const session_t *a, const session_t *b)
   return coap_endpoint_cmp(e1, e2);
 }
 /*---------------------------------------------------------------------------*/
+uint32_t
+dtls_session_hash(const session_t *a)
+{
+  const coap_endpoint_t *e = (const coap_endpoint_t *)a;
+  uint32_t h;
+
+  h = dtls_session_hash_update(DTLS_SESSION_HASH_INIT, &e->port, sizeof(e->port));
+  return dtls_session_hash_update(h, &e->ipaddr, sizeof(e->ipaddr));
+}
+/*---------------------------------------------------------------------------*/
 void *
 dtls_session_get_address(const session_t *a)
 {
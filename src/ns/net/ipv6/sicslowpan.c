@@ -224,20 +224,9 @@ static int last_rssi;
 #if SICSLOWPAN_CONF_FRAG
 static uint16_t my_tag;
 
-/** The total length of the IPv6 packet in the sicslowpan_buf. */
-
-/* This needs to be defined in NBR / Nodes depending on available RAM   */
-/*   and expected reassembly requirements                               */
-#ifdef SICSLOWPAN_CONF_FRAGMENT_BUFFERS
-#define SICSLOWPAN_FRAGMENT_BUFFERS SICSLOWPAN_CONF_FRAGMENT_BUFFERS
-#else
-#define SICSLOWPAN_FRAGMENT_BUFFERS 12
-#endif
-
 /* REASS_CONTEXTS corresponds to the number of simultaneous
- * reassemblies that can be made. NOTE: the first buffer for each
- * reassembly is stored in the context since it can be larger than the
- * rest of the fragments due to header compression.
+ * reassemblies that can be made. Each context holds a buffer for the
+ * whole datagram, and the fragments are placed in it at their offset.
  **/
 #ifdef SICSLOWPAN_CONF_REASS_CONTEXTS
 #define SICSLOWPAN_REASS_CONTEXTS SICSLOWPAN_CONF_REASS_CONTEXTS
@@ -245,196 +234,290 @@ static uint16_t my_tag;
 #define SICSLOWPAN_REASS_CONTEXTS 2
 #endif
 
-/* The size of each fragment (IP payload) for the 6lowpan fragmentation */
-#ifdef SICSLOWPAN_CONF_FRAGMENT_SIZE
-#define SICSLOWPAN_FRAGMENT_SIZE SICSLOWPAN_CONF_FRAGMENT_SIZE
+/* The largest datagram that can be reassembled */
+#ifdef SICSLOWPAN_CONF_REASS_BUF_SIZE
+#define SICSLOWPAN_REASS_BUF_SIZE SICSLOWPAN_CONF_REASS_BUF_SIZE
+#else
+#define SICSLOWPAN_REASS_BUF_SIZE (UIP_BUFSIZE - UIP_LLH_LEN)
+#endif
+
+/* Number of buckets of the (sender, tag) hash, a power of two */
+#ifdef SICSLOWPAN_CONF_REASS_HASH_SIZE
+#define SICSLOWPAN_REASS_HASH_SIZE SICSLOWPAN_CONF_REASS_HASH_SIZE
 #else
-/* The default fragment size (110 bytes for 127-2 bytes frames) */
-#define SICSLOWPAN_FRAGMENT_SIZE (MAC_MAX_PAYLOAD - 15)
+#define SICSLOWPAN_REASS_HASH_SIZE 8
 #endif
 
-/* Assuming that the worst growth for uncompression is 38 bytes */
-#define SICSLOWPAN_FIRST_FRAGMENT_SIZE (SICSLOWPAN_FRAGMENT_SIZE + 38)
+/* Fragment offsets are in units of 8 bytes */
+#define SICSLOWPAN_REASS_UNITS ((SICSLOWPAN_REASS_BUF_SIZE + 7) / 8)
 
 /* all information needed for reassembly */
 struct sicslowpan_frag_info {
+  /** Next context in the same hash bucket, -1 ends the chain */
+  int8_t next;
   /** When reassembling, the source address of the fragments being merged */
   linkaddr_t sender;
-  /** The destination address of the fragments being merged */
-  linkaddr_t receiver;
   /** When reassembling, the tag in the fragments being merged. */
   uint16_t tag;
-  /** Total length of the fragmented packet */
+  /** Total length of the fragmented packet, 0 if the context is free */
   uint16_t len;
-  /** Current length of reassembled fragments */
-  uint16_t reassembled_len;
+  /** Number of 8 byte units of the packet received so far */
+  uint16_t received_units;
   /** Reassembly %process %timer. */
   struct timer reass_timer;
-
-  /** Fragment size of first fragment */
-  uint16_t first_frag_len;
-  /** First fragment - needs a larger buffer since the size is uncompressed size
-   and we need to know total size to know when we have received last fragment. */
-  uint8_t first_frag[SICSLOWPAN_FIRST_FRAGMENT_SIZE];
+  /** One bit per 8 byte unit received, fragments may come in any order */
+  uint8_t received[(SICSLOWPAN_REASS_UNITS + 7) / 8];
+  /** The packet being reassembled, with the uncompressed headers */
+  uint8_t buf[SICSLOWPAN_REASS_BUF_SIZE];
 };
 
 static struct sicslowpan_frag_info frag_info[SICSLOWPAN_REASS_CONTEXTS];
+/* First context of each hash bucket, -1 if empty */
+static int8_t frag_hash[SICSLOWPAN_REASS_HASH_SIZE];
+
+struct sicslowpan_reass_stats sicslowpan_reass_stats;
+
+/* A router may forward the fragments of a packet that is not for it as
+ * they come, once the first fragment has been routed, instead of
+ * reassembling the whole packet first. Only the IPHC header of the first
+ * fragment is rewritten, the others are sent on with a new tag.
+ **/
+#ifdef SICSLOWPAN_CONF_FRAG_FORWARDING
+#define SICSLOWPAN_FRAG_FORWARDING SICSLOWPAN_CONF_FRAG_FORWARDING
+#else
+#define SICSLOWPAN_FRAG_FORWARDING 0
+#endif
+
+#if SICSLOWPAN_FRAG_FORWARDING && \
+    (!UIP_CONF_ROUTER || SICSLOWPAN_COMPRESSION != SICSLOWPAN_COMPRESSION_IPHC)
+#undef SICSLOWPAN_FRAG_FORWARDING
+#define SICSLOWPAN_FRAG_FORWARDING 0
+#endif
+
+#if SICSLOWPAN_FRAG_FORWARDING
+/* Number of packets that can be forwarded at the same time */
+#ifdef SICSLOWPAN_CONF_VRB_ENTRIES
+#define SICSLOWPAN_VRB_ENTRIES SICSLOWPAN_CONF_VRB_ENTRIES
+#else
+#define SICSLOWPAN_VRB_ENTRIES 4
+#endif
 
-struct sicslowpan_frag_buf {
-  /* the index of the frag_info */
-  uint8_t index;
-  /* Fragment offset */
-  uint8_t offset;
-  /* Length of this fragment (if zero this buffer is not allocated) */
-  uint8_t len;
-  uint8_t data[SICSLOWPAN_FRAGMENT_SIZE];
+/* A virtual reassembly buffer, what is left of a packet being forwarded */
+struct sicslowpan_vrb {
+  /** Source address of the fragments received */
+  linkaddr_t sender;
+  /** Next hop the fragments are sent to */
+  linkaddr_t nexthop;
+  /** Tag of the fragments received */
+  uint16_t tag;
+  /** Tag of the fragments sent */
+  uint16_t out_tag;
+  /** Total length of the packet, 0 if the entry is free */
+  uint16_t len;
+  /** Number of 8 byte units of the packet received so far */
+  uint16_t received_units;
+  /** The packet was dropped, its other fragments are dropped too */
+  uint8_t discard;
+  /** Dropped after SICSLOWPAN_REASS_MAXAGE like a reassembly */
+  struct timer timer;
+  /** One bit per 8 byte unit received, to forward a fragment once */
+  uint8_t received[((UIP_LINK_MTU + 7) / 8 + 7) / 8];
 };
 
-static struct sicslowpan_frag_buf frag_buf[SICSLOWPAN_FRAGMENT_BUFFERS];
+static struct sicslowpan_vrb vrb[SICSLOWPAN_VRB_ENTRIES];
+/* The fragment being forwarded, while packetbuf is cleared for it */
+static uint8_t vrb_frame[PACKETBUF_SIZE];
+#endif /* SICSLOWPAN_FRAG_FORWARDING */
 
 /*---------------------------------------------------------------------------*/
-static int
+static uint8_t
+frag_hash_index(const linkaddr_t *sender, uint16_t tag)
+{
+  unsigned h = tag;
+  int i;
+
+  for(i = 0; i < LINKADDR_SIZE; i++) {
+    h = h * 31 + sender->u8[i];
+  }
+  return h & (SICSLOWPAN_REASS_HASH_SIZE - 1);
+}
+/*---------------------------------------------------------------------------*/
+static void
 clear_fragments(uint8_t frag_info_index)
 {
-  int i, clear_count;
-  clear_count = 0;
-  frag_info[frag_info_index].len = 0;
-  for(i = 0; i < SICSLOWPAN_FRAGMENT_BUFFERS; i++) {
-    if(frag_buf[i].len > 0 && frag_buf[i].index == frag_info_index) {
-      /* deallocate the buffer */
-      frag_buf[i].len = 0;
-      clear_count++;
+  struct sicslowpan_frag_info *info = &frag_info[frag_info_index];
+  int8_t *p;
+
+  /* Unlink the context from its hash bucket */
+  for(p = &frag_hash[frag_hash_index(&info->sender, info->tag)];
+      *p >= 0; p = &frag_info[*p].next) {
+    if(*p == frag_info_index) {
+      *p = info->next;
+      break;
     }
   }
-  return clear_count;
+  info->len = 0;
 }
 /*---------------------------------------------------------------------------*/
-static int
-timeout_fragments(int not_context)
+static void
+timeout_fragments(void)
 {
   int i;
-  int count = 0;
   for(i = 0; i < SICSLOWPAN_REASS_CONTEXTS; i++) {
-    if(frag_info[i].len > 0 && i != not_context &&
-       timer_expired(&frag_info[i].reass_timer)) {
+    if(frag_info[i].len > 0 && timer_expired(&frag_info[i].reass_timer)) {
       /* This context can be freed */
-      count += clear_fragments(i);
+      LOG_WARN("reassembly: timeout, dropping tag %d\n", frag_info[i].tag);
+      clear_fragments(i);
+      sicslowpan_reass_stats.timeouts++;
     }
   }
-  return count;
 }
 /*---------------------------------------------------------------------------*/
-static int
-store_fragment(uint8_t index, uint8_t offset)
+static int8_t
+find_context(uint16_t tag, const linkaddr_t *sender)
 {
-  int i;
-  for(i = 0; i < SICSLOWPAN_FRAGMENT_BUFFERS; i++) {
-    if(frag_buf[i].len == 0) {
-      /* copy over the data from packetbuf into the fragment buffer and store offset and len */
-      frag_buf[i].offset = offset; /* frag offset */
-      frag_buf[i].len = packetbuf_datalen() - packetbuf_hdr_len;
-      frag_buf[i].index = index;
-      memcpy(frag_buf[i].data, packetbuf_ptr + packetbuf_hdr_len,
-             packetbuf_datalen() - packetbuf_hdr_len);
-      /* return the length of the stored fragment */
-      return frag_buf[i].len;
+  int8_t i;
+
+  for(i = frag_hash[frag_hash_index(sender, tag)]; i >= 0;
+      i = frag_info[i].next) {
+    if(frag_info[i].tag == tag && linkaddr_cmp(&frag_info[i].sender, sender)) {
+      return i;
     }
   }
-  /* failed */
   return -1;
 }
 /*---------------------------------------------------------------------------*/
+/* Mark the bytes [offset, offset + len) of a packet of size bytes in
+   the bitmap of its 8 byte units, returns the number of units that
+   were new */
+static int
+mark_units(uint8_t *bitmap, uint16_t size, uint16_t offset, uint16_t len)
+{
+  uint16_t unit, last;
+  int count = 0;
+
+  /* Only the last fragment may end in the middle of a unit */
+  if(offset + len >= size) {
+    last = (size + 7) / 8;
+  } else {
+    last = (offset + len) / 8;
+  }
+  for(unit = offset / 8; unit < last; unit++) {
+    if(!(bitmap[unit / 8] & (1 << (unit % 8)))) {
+      bitmap[unit / 8] |= 1 << (unit % 8);
+      count++;
+    }
+  }
+  return count;
+}
+/*---------------------------------------------------------------------------*/
+/* Mark the bytes [offset, offset + len) of the packet as received,
+   returns the number of 8 byte units that were new */
+static int
+mark_received(uint8_t context, uint16_t offset, uint16_t len)
+{
+  struct sicslowpan_frag_info *info = &frag_info[context];
+  int count;
+
+  count = mark_units(info->received, info->len, offset, len);
+  info->received_units += count;
+  return count;
+}
+/*---------------------------------------------------------------------------*/
+static int
+reass_complete(uint8_t context)
+{
+  return frag_info[context].received_units == (frag_info[context].len + 7) / 8;
+}
+/*---------------------------------------------------------------------------*/
 /* add a new fragment to the buffer */
 static int8_t
 add_fragment(uint16_t tag, uint16_t frag_size, uint8_t offset)
 {
+  const linkaddr_t *sender = packetbuf_addr(PACKETBUF_ADDR_SENDER);
+  struct sicslowpan_frag_info *info;
+  uint16_t start, len;
+  int8_t found;
   int i;
-  int len;
-  int8_t found = -1;
 
-  if(offset == 0) {
-    /* This is a first fragment - check if we can add this */
-    for(i = 0; i < SICSLOWPAN_REASS_CONTEXTS; i++) {
-      /* clear all fragment info with expired timer to free all fragment buffers */
-      if(frag_info[i].len > 0 && timer_expired(&frag_info[i].reass_timer)) {
-        clear_fragments(i);
-      }
+  found = find_context(tag, sender);
+  if(found >= 0 && frag_info[found].len != frag_size) {
+    /* The sender reused the tag for another packet */
+    LOG_WARN("reassembly: size changed for tag %d, restarting\n", tag);
+    clear_fragments(found);
+    found = -1;
+  }
+
+  if(found < 0) {
+    /* The first fragment we see of this packet, whatever its offset */
+    if(frag_size == 0 || frag_size > SICSLOWPAN_REASS_BUF_SIZE) {
+      LOG_WARN("reassembly: packet too large - tag: %d size: %d\n", tag, frag_size);
+      sicslowpan_reass_stats.invalid++;
+      return -1;
+    }
 
+    /* clear all fragment info with expired timer to free contexts */
+    timeout_fragments();
+    for(i = 0; i < SICSLOWPAN_REASS_CONTEXTS; i++) {
       /* We use len as indication on used or not used */
-      if(found < 0 && frag_info[i].len == 0) {
-        /* We remember the first free fragment info but must continue
-           the loop to free any other expired fragment buffers. */
+      if(frag_info[i].len == 0) {
         found = i;
+        break;
       }
     }
-
     if(found < 0) {
       LOG_WARN("reassembly: failed to store new fragment session - tag: %d\n", tag);
+      sicslowpan_reass_stats.no_context++;
       return -1;
     }
 
     /* Found a free fragment info to store data in */
-    frag_info[found].len = frag_size;
-    frag_info[found].tag = tag;
-    linkaddr_copy(&frag_info[found].sender,
-                  packetbuf_addr(PACKETBUF_ADDR_SENDER));
-    timer_set(&frag_info[found].reass_timer, SICSLOWPAN_REASS_MAXAGE * CLOCK_SECOND / 16);
+    info = &frag_info[found];
+    info->len = frag_size;
+    info->tag = tag;
+    info->received_units = 0;
+    memset(info->received, 0, sizeof(info->received));
+    linkaddr_copy(&info->sender, sender);
+    timer_set(&info->reass_timer, SICSLOWPAN_REASS_MAXAGE * CLOCK_SECOND / 16);
+    i = frag_hash_index(sender, tag);
+    info->next = frag_hash[i];
+    frag_hash[i] = found;
+  }
+
+  if(offset == 0) {
     /* first fragment can not be stored immediately but is moved into
        the buffer while uncompressing */
     return found;
   }
 
-  /* This is a N-fragment - should find the info */
-  for(i = 0; i < SICSLOWPAN_REASS_CONTEXTS; i++) {
-    if(frag_info[i].tag == tag && frag_info[i].len > 0 &&
-       linkaddr_cmp(&frag_info[i].sender, packetbuf_addr(PACKETBUF_ADDR_SENDER))) {
-      /* Tag and Sender match - this must be the correct info to store in */
-      found = i;
-      break;
-    }
-  }
-
-  if(found < 0) {
-    /* no entry found for storing the new fragment */
-    LOG_WARN("reassembly: failed to store N-fragment - could not find session - tag: %d offset: %d\n", tag, offset);
+  /* This is a N-fragment, place its payload in the packet */
+  info = &frag_info[found];
+  start = (uint16_t)offset << 3;
+  if(packetbuf_datalen() < packetbuf_hdr_len || start >= info->len) {
+    LOG_WARN("reassembly: bad N-fragment - tag: %d offset: %d\n", tag, offset);
+    sicslowpan_reass_stats.invalid++;
     return -1;
   }
-
-  /* i is the index of the reassembly context */
-  len = store_fragment(i, offset);
-  if(len < 0 && timeout_fragments(i) > 0) {
-    len = store_fragment(i, offset);
+  len = packetbuf_datalen() - packetbuf_hdr_len;
+  if(start + len > info->len) {
+    /* extraneous bytes at the end of the last fragment */
+    len = info->len - start;
   }
-  if(len > 0) {
-    frag_info[i].reassembled_len += len;
-    return i;
-  } else {
-    /* should we also clear all fragments since we failed to store
-       this fragment? */
-    LOG_WARN("reassembly: failed to store fragment - packet reassembly will fail tag:%d l\n", frag_info[i].tag);
-    return -1;
+  memcpy(info->buf + start, packetbuf_ptr + packetbuf_hdr_len, len);
+  if(mark_received(found, start, len) == 0) {
+    sicslowpan_reass_stats.duplicates++;
   }
+  return found;
 }
 /*---------------------------------------------------------------------------*/
-/* Copy all the fragments that are associated with a specific context
-   into uip */
+/* Copy the reassembled packet of a specific context into uip */
 static void
 copy_frags2uip(int context)
 {
-  int i;
-
-  /* Copy from the fragment context info buffer first */
-  memcpy((uint8_t *)UIP_IP_BUF, (uint8_t *)frag_info[context].first_frag,
-         frag_info[context].first_frag_len);
-  for(i = 0; i < SICSLOWPAN_FRAGMENT_BUFFERS; i++) {
-    /* And also copy all matching fragments */
-    if(frag_buf[i].len > 0 && frag_buf[i].index == context) {
-      memcpy((uint8_t *)UIP_IP_BUF + (uint16_t)(frag_buf[i].offset << 3),
-             (uint8_t *)frag_buf[i].data, frag_buf[i].len);
-    }
-  }
-  /* deallocate all the fragments for this context */
+  memcpy((uint8_t *)UIP_IP_BUF, frag_info[context].buf, frag_info[context].len);
+  /* deallocate the context */
   clear_fragments(context);
+  sicslowpan_reass_stats.reassembled++;
 }
 #endif /* SICSLOWPAN_CONF_FRAG */
 
@@ -1534,6 +1617,282 @@ fragment_copy_payload_and_send(uint16_t uip_offset, linkaddr_t *dest) {
   }
   return 1;
 }
+#if SICSLOWPAN_FRAG_FORWARDING
+/*--------------------------------------------------------------------*/
+/* Find the entry forwarding the fragments of a packet */
+static struct sicslowpan_vrb *
+vrb_lookup(uint16_t tag, const linkaddr_t *sender)
+{
+  int i;
+
+  for(i = 0; i < SICSLOWPAN_VRB_ENTRIES; i++) {
+    if(vrb[i].len > 0 && timer_expired(&vrb[i].timer)) {
+      LOG_WARN("forwarding: timeout, dropping tag %d\n", vrb[i].tag);
+      vrb[i].len = 0;
+    }
+    if(vrb[i].len > 0 && vrb[i].tag == tag &&
+       linkaddr_cmp(&vrb[i].sender, sender)) {
+      return &vrb[i];
+    }
+  }
+  return NULL;
+}
+/*--------------------------------------------------------------------*/
+static struct sicslowpan_vrb *
+vrb_alloc(uint16_t tag, const linkaddr_t *sender)
+{
+  struct sicslowpan_vrb *v;
+  int i;
+
+  /* A packet that reuses the tag replaces the old one */
+  v = vrb_lookup(tag, sender);
+  for(i = 0; v == NULL && i < SICSLOWPAN_VRB_ENTRIES; i++) {
+    if(vrb[i].len == 0) {
+      v = &vrb[i];
+    }
+  }
+  if(v != NULL) {
+    linkaddr_copy(&v->sender, sender);
+    v->tag = tag;
+    v->discard = 0;
+    timer_set(&v->timer, SICSLOWPAN_REASS_MAXAGE * CLOCK_SECOND / 16);
+  }
+  return v;
+}
+/*--------------------------------------------------------------------*/
+/* The link layer address of the next hop of the packet in uip, as
+   tcpip_ipv6_output() would pick it, or NULL if it is not known yet */
+static const linkaddr_t *
+vrb_nexthop(void)
+{
+  const uip_ipaddr_t *nexthop;
+  uip_ds6_route_t *route;
+  uip_ds6_nbr_t *nbr;
+
+  if(uip_ds6_is_addr_onlink(&UIP_IP_BUF->destipaddr)) {
+    nexthop = &UIP_IP_BUF->destipaddr;
+  } else if((route = uip_ds6_route_lookup(&UIP_IP_BUF->destipaddr)) != NULL) {
+    nexthop = uip_ds6_route_nexthop(route);
+  } else {
+    nexthop = uip_ds6_defrt_choose();
+  }
+  if(nexthop == NULL || (nbr = uip_ds6_nbr_lookup(nexthop)) == NULL) {
+    return NULL;
+  }
+#if UIP_ND6_SEND_NS
+  if(nbr->state != NBR_REACHABLE) {
+    return NULL;
+  }
+#endif /* UIP_ND6_SEND_NS */
+  return (const linkaddr_t *)uip_ds6_nbr_get_ll(nbr);
+}
+/*--------------------------------------------------------------------*/
+/**
+ * \brief Forward the first fragment of a packet without reassembling it.
+ * The uncompressed headers and the payload of the fragment are in uip.
+ * \param tag the tag of the fragment
+ * \param frag_size the size of the whole packet
+ * \return 1 if the fragment was forwarded or dropped, 0 if the packet
+ * has to be reassembled, for us or because uip6 would handle it
+ */
+static int
+vrb_forward_first(uint16_t tag, uint16_t frag_size)
+{
+  struct sicslowpan_vrb *v;
+  const linkaddr_t *nexthop;
+  struct uip_ext_hdr *hbh;
+  uint16_t first_len;
+  uint16_t offset;
+  uint8_t next_hdr;
+  int framer_hdrlen;
+  int payload_len;
+
+  first_len = uncomp_hdr_len + packetbuf_payload_len;
+
+  /* The first fragment again, it was forwarded or dropped already */
+  v = vrb_lookup(tag, packetbuf_addr(PACKETBUF_ADDR_SENDER));
+  if(v != NULL && v->len == frag_size) {
+    uip_clear_buf();
+    sicslowpan_reass_stats.duplicates++;
+    return 1;
+  }
+
+  /* Plain unicast forwarding only, uip6 answers or rewrites the rest */
+  if(curr_page != 0 || frag_size > UIP_LINK_MTU || UIP_IP_BUF->ttl <= 1 ||
+     uip_is_addr_mcast(&UIP_IP_BUF->destipaddr) ||
+     uip_is_addr_linklocal(&UIP_IP_BUF->destipaddr) ||
+     uip_is_addr_loopback(&UIP_IP_BUF->destipaddr) ||
+     uip_is_addr_mcast(&UIP_IP_BUF->srcipaddr) ||
+     uip_is_addr_linklocal(&UIP_IP_BUF->srcipaddr) ||
+     uip_is_addr_unspecified(&UIP_IP_BUF->srcipaddr) ||
+     uip_ds6_is_my_addr(&UIP_IP_BUF->destipaddr) ||
+     uip_ds6_is_my_addr(&UIP_IP_BUF->srcipaddr) ||
+     NETSTACK_ROUTING.node_is_root()) {
+    return 0;
+  }
+
+  /* The RPL option is updated in place, a routing header is left to uip6 */
+  next_hdr = UIP_IP_BUF->proto;
+  if(next_hdr == UIP_PROTO_HBHO) {
+    hbh = (struct uip_ext_hdr *)((uint8_t *)UIP_IP_BUF + UIP_IPH_LEN);
+    if(first_len < UIP_IPH_LEN + 8 ||
+       first_len < UIP_IPH_LEN + (hbh->len << 3) + 8 ||
+       ((struct uip_ext_hdr_opt *)(hbh + 1))->type != UIP_EXT_HDR_OPT_RPL) {
+      return 0;
+    }
+    next_hdr = hbh->next;
+  }
+  if(next_hdr == UIP_PROTO_ROUTING || vrb_nexthop() == NULL) {
+    return 0;
+  }
+
+  v = vrb_alloc(tag, packetbuf_addr(PACKETBUF_ADDR_SENDER));
+  if(v == NULL) {
+    LOG_WARN("forwarding: no free entry, reassembling tag %d\n", tag);
+    return 0;
+  }
+  v->len = frag_size;
+  memset(v->received, 0, sizeof(v->received));
+  v->received_units = mark_units(v->received, frag_size, 0, first_len);
+
+  /* From here on the packet is ours to forward or drop, as uip6 and
+     tcpip_ipv6_output() would do */
+  uip_len = frag_size;
+  uip_ext_len = 0;
+  if(UIP_IP_BUF->proto == UIP_PROTO_HBHO &&
+     !NETSTACK_ROUTING.ext_header_hbh_update(2)) {
+    goto discard;
+  }
+  UIP_IP_BUF->ttl = UIP_IP_BUF->ttl - 1;
+  if(!NETSTACK_ROUTING.ext_header_update() || uip_len != frag_size ||
+     (nexthop = vrb_nexthop()) == NULL) {
+    goto discard;
+  }
+  linkaddr_copy(&v->nexthop, nexthop);
+
+  /* Compress the headers again for the next hop */
+  uncomp_hdr_len = 0;
+  packetbuf_hdr_len = 0;
+  packetbuf_clear();
+  packetbuf_ptr = packetbuf_dataptr();
+  packetbuf_set_addr(PACKETBUF_ADDR_RECEIVER, &v->nexthop);
+  framer_hdrlen = NETSTACK_FRAMER.length();
+  if(framer_hdrlen < 0) {
+    framer_hdrlen = MAC_MAX_HEADER;
+  }
+  if(compress_hdr_iphc(&v->nexthop) == 0 || uncomp_hdr_len > first_len) {
+    goto discard;
+  }
+  /* The headers may compress less for this hop than for the last one,
+     what does not fit in the first fragment goes in an extra FRAGN */
+  payload_len = (MAC_MAX_PAYLOAD - framer_hdrlen - packetbuf_hdr_len -
+                 SICSLOWPAN_FRAG1_HDR_LEN) & 0xfffffff8;
+  if(payload_len <= 0) {
+    LOG_WARN("forwarding: compressed header does not fit first fragment\n");
+    goto discard;
+  }
+  if(payload_len > first_len - uncomp_hdr_len) {
+    payload_len = first_len - uncomp_hdr_len;
+  }
+
+  v->out_tag = my_tag++;
+  memmove(packetbuf_ptr + SICSLOWPAN_FRAG1_HDR_LEN, packetbuf_ptr, packetbuf_hdr_len);
+  packetbuf_hdr_len += SICSLOWPAN_FRAG1_HDR_LEN;
+  SET16(PACKETBUF_FRAG_PTR, PACKETBUF_FRAG_DISPATCH_SIZE,
+        ((SICSLOWPAN_DISPATCH_FRAG1 << 8) | frag_size));
+  SET16(PACKETBUF_FRAG_PTR, PACKETBUF_FRAG_TAG, v->out_tag);
+  memcpy(packetbuf_ptr + packetbuf_hdr_len,
+         (uint8_t *)UIP_IP_BUF + uncomp_hdr_len, payload_len);
+  packetbuf_set_datalen(packetbuf_hdr_len + payload_len);
+  send_packet(&v->nexthop);
+  sicslowpan_reass_stats.forwarded_fragments++;
+
+  /* Offsets are in 8 byte units, and so are the uncompressed headers */
+  offset = uncomp_hdr_len + payload_len;
+  if(offset < first_len) {
+    packetbuf_clear();
+    packetbuf_ptr = packetbuf_dataptr();
+    packetbuf_hdr_len = SICSLOWPAN_FRAGN_HDR_LEN;
+    SET16(PACKETBUF_FRAG_PTR, PACKETBUF_FRAG_DISPATCH_SIZE,
+          ((SICSLOWPAN_DISPATCH_FRAGN << 8) | frag_size));
+    SET16(PACKETBUF_FRAG_PTR, PACKETBUF_FRAG_TAG, v->out_tag);
+    PACKETBUF_FRAG_PTR[PACKETBUF_FRAG_OFFSET] = offset >> 3;
+    memcpy(packetbuf_ptr + packetbuf_hdr_len,
+           (uint8_t *)UIP_IP_BUF + offset, first_len - offset);
+    packetbuf_set_datalen(packetbuf_hdr_len + first_len - offset);
+    send_packet(&v->nexthop);
+    sicslowpan_reass_stats.forwarded_fragments++;
+  }
+
+  LOG_INFO("forwarding: tag %d -> %d, len %d, to ", tag, v->out_tag, frag_size);
+  LOG_INFO_LLADDR(&v->nexthop);
+  LOG_INFO_("\n");
+  uip_clear_buf();
+  UIP_STAT(++uip_stat.ip.forwarded);
+  sicslowpan_reass_stats.forwarded++;
+  return 1;
+
+discard:
+  uip_clear_buf();
+  v->discard = 1;
+  sicslowpan_reass_stats.forward_dropped++;
+  return 1;
+}
+/*--------------------------------------------------------------------*/
+/**
+ * \brief Forward a fragment of a packet whose first fragment was
+ * forwarded. The fragment is in packetbuf, after its FRAGN header.
+ * \param offset the offset of the fragment, in 8 byte units
+ * \return 1 if the fragment was forwarded or dropped, 0 if the packet
+ * is not being forwarded
+ */
+static int
+vrb_forward_next(uint16_t tag, uint16_t frag_size, uint8_t offset)
+{
+  struct sicslowpan_vrb *v;
+  uint16_t start, len;
+
+  v = vrb_lookup(tag, packetbuf_addr(PACKETBUF_ADDR_SENDER));
+  if(v == NULL) {
+    return 0;
+  }
+  if(v->len != frag_size) {
+    /* The sender reused the tag for another packet */
+    v->len = 0;
+    return 0;
+  }
+  start = (uint16_t)offset << 3;
+  if(packetbuf_datalen() < packetbuf_hdr_len || start >= v->len) {
+    sicslowpan_reass_stats.invalid++;
+    return 1;
+  }
+
+  /* A fragment seen already, e.g. retransmitted upstream, is not sent
+     again and does not count towards the end of the packet */
+  len = mark_units(v->received, v->len, start,
+                   packetbuf_datalen() - packetbuf_hdr_len);
+  if(len == 0) {
+    sicslowpan_reass_stats.duplicates++;
+    return 1;
+  }
+  v->received_units += len;
+
+  if(!v->discard) {
+    /* Only the tag changes, the offset is the same along the path */
+    SET16(PACKETBUF_FRAG_PTR, PACKETBUF_FRAG_TAG, v->out_tag);
+    len = packetbuf_datalen();
+    memcpy(vrb_frame, packetbuf_dataptr_const(), len);
+    packetbuf_clear();
+    packetbuf_copyfrom(vrb_frame, len);
+    send_packet(&v->nexthop);
+    sicslowpan_reass_stats.forwarded_fragments++;
+  }
+  if(v->received_units == (v->len + 7) / 8) {
+    v->len = 0;
+  }
+  return 1;
+}
+#endif /* SICSLOWPAN_FRAG_FORWARDING */
 #endif /* SICSLOWPAN_CONF_FRAG */
 /*--------------------------------------------------------------------*/
 /** \brief Take an IP packet and format it to be sent on an 802.15.4
@@ -1831,6 +2190,15 @@ input(void)
       LOG_INFO("input: received first element of a fragmented packet (tag %d, len %d)\n",
              frag_tag, frag_size);
 
+#if SICSLOWPAN_FRAG_FORWARDING
+      if(find_context(frag_tag, packetbuf_addr(PACKETBUF_ADDR_SENDER)) < 0) {
+        /* Uncompress in uip first, the packet may be forwarded as it
+           comes instead of being reassembled */
+        frag_context = -1;
+        break;
+      }
+#endif /* SICSLOWPAN_FRAG_FORWARDING */
+
       /* Add the fragment to the fragmentation context */
       frag_context = add_fragment(frag_tag, frag_size, frag_offset);
 
@@ -1839,7 +2207,7 @@ input(void)
         return;
       }
 
-      buffer = frag_info[frag_context].first_frag;
+      buffer = frag_info[frag_context].buf;
 
       break;
     case SICSLOWPAN_DISPATCH_FRAGN:
@@ -1852,8 +2220,14 @@ input(void)
       frag_size = GET16(PACKETBUF_FRAG_PTR, PACKETBUF_FRAG_DISPATCH_SIZE) & 0x07ff;
       packetbuf_hdr_len += SICSLOWPAN_FRAGN_HDR_LEN;
 
+#if SICSLOWPAN_FRAG_FORWARDING
+      if(vrb_forward_next(frag_tag, frag_size, frag_offset)) {
+        return;
+      }
+#endif /* SICSLOWPAN_FRAG_FORWARDING */
+
       /* Add the fragment to the fragmentation context (this will also
-         copy the payload) */
+         place the payload in the reassembly buffer) */
       frag_context = add_fragment(frag_tag, frag_size, frag_offset);
 
       if(frag_context == -1) {
@@ -1865,7 +2239,7 @@ input(void)
          we should not store more */
       buffer = NULL;
 
-      if(frag_info[frag_context].reassembled_len >= frag_size) {
+      if(reass_complete(frag_context)) {
         last_fragment = 1;
       }
       is_fragment = 1;
@@ -1932,6 +2306,23 @@ input(void)
     LOG_INFO("input: fragment (tag %d, payload %d, offset %d) -- %u %u\n",
          frag_tag, packetbuf_payload_len, frag_offset << 3, packetbuf_datalen(), packetbuf_hdr_len);
   }
+
+  /* The first fragment goes to the start of the reassembly buffer,
+     whose context only accepts frag_size up to
+     SICSLOWPAN_REASS_BUF_SIZE, so it must not run past frag_size. */
+  if(first_fragment != 0 && uncomp_hdr_len + packetbuf_payload_len > frag_size) {
+    if(uncomp_hdr_len > frag_size) {
+      LOG_ERR("input: first fragment headers larger than the packet (tag %d, len %d)\n",
+              frag_tag, frag_size);
+      sicslowpan_reass_stats.invalid++;
+      if(frag_context >= 0 && frag_info[frag_context].received_units == 0) {
+        clear_fragments(frag_context);
+      }
+      return;
+    }
+    /* extraneous bytes at the end, as for the last N-fragment */
+    packetbuf_payload_len = frag_size - uncomp_hdr_len;
+  }
 #endif /*SICSLOWPAN_CONF_FRAG*/
 
   /* Sanity-check size of incoming packet to avoid buffer overflow */
@@ -1953,19 +2344,36 @@ input(void)
     memcpy((uint8_t *)buffer + uncomp_hdr_len, packetbuf_ptr + packetbuf_hdr_len, packetbuf_payload_len);
   }
 
+#if SICSLOWPAN_FRAG_FORWARDING
+  if(first_fragment != 0 && frag_context == -1) {
+    if(vrb_forward_first(frag_tag, frag_size)) {
+      return;
+    }
+    /* Not forwarded, reassemble it as usual */
+    frag_context = add_fragment(frag_tag, frag_size, 0);
+    if(frag_context == -1) {
+      LOG_ERR("input: failed to allocate new reassembly context\n");
+      return;
+    }
+    /* frag_size, which bounds the copy, fits in the buffer now */
+    memcpy(frag_info[frag_context].buf, (uint8_t *)UIP_IP_BUF,
+           uncomp_hdr_len + packetbuf_payload_len);
+  }
+#endif /* SICSLOWPAN_FRAG_FORWARDING */
+
   /* update processed_ip_in_len if fragment, sicslowpan_len otherwise */
 
 #if SICSLOWPAN_CONF_FRAG
   if(frag_size > 0) {
-    /* Add the size of the header only for the first fragment. */
+    /* The first fragment covers the uncompressed headers, it may
+       also be the last one to arrive. */
     if(first_fragment != 0) {
-      frag_info[frag_context].reassembled_len = uncomp_hdr_len + packetbuf_payload_len;
-      frag_info[frag_context].first_frag_len = uncomp_hdr_len + packetbuf_payload_len;
+      if(mark_received(frag_context, 0, uncomp_hdr_len + packetbuf_payload_len) == 0) {
+        sicslowpan_reass_stats.duplicates++;
+      }
+      last_fragment = reass_complete(frag_context);
     }
-    /* For the last fragment, we are OK if there is extrenous bytes at
-       the end of the packet. */
     if(last_fragment != 0) {
-      frag_info[frag_context].reassembled_len = frag_size;
       /* copy to uip */
       copy_frags2uip(frag_context);
     }
@@ -2065,6 +2473,7 @@ sicslowpan_init(void)
   /* We use the queuebuf module if fragmentation is enabled */
 #if SICSLOWPAN_CONF_FRAG
   queuebuf_init();
+  memset(frag_hash, -1, sizeof(frag_hash));
 #endif
 }
 /*--------------------------------------------------------------------*/
@@ -336,6 +336,32 @@ struct sicslowpan_nh_compressor {
 
 int sicslowpan_get_last_rssi(void);
 
+#if SICSLOWPAN_CONF_FRAG
+/**
+ * Counters of the fragment reassembly
+ */
+struct sicslowpan_reass_stats {
+  /** Packets reassembled and delivered */
+  uint32_t reassembled;
+  /** Packets dropped after SICSLOWPAN_REASS_MAXAGE */
+  uint32_t timeouts;
+  /** Fragments of a new packet dropped, all contexts in use */
+  uint32_t no_context;
+  /** Fragments dropped for a bad size or offset */
+  uint32_t invalid;
+  /** Fragments that brought no new bytes */
+  uint32_t duplicates;
+  /** Packets forwarded fragment by fragment, without reassembly */
+  uint32_t forwarded;
+  /** Fragments of those packets sent on */
+  uint32_t forwarded_fragments;
+  /** Packets dropped while forwarding them */
+  uint32_t forward_dropped;
+};
+
+extern struct sicslowpan_reass_stats sicslowpan_reass_stats;
+#endif /* SICSLOWPAN_CONF_FRAG */
+
 extern const struct network_driver sicslowpan_driver;
 
 #endif /* SICSLOWPAN_H_ */
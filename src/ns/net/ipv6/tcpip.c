@@ -815,6 +815,9 @@ PROCESS_THREAD(tcpip_process, ev, data)
 {
   PROCESS_BEGIN();
 
+  /* Packet events are handled before the application ones */
+  process_set_priority(PROCESS_CURRENT(), PROCESS_PRIORITY_NETWORK);
+
 #if UIP_TCP
   memset(s.listenports, 0, UIP_LISTENPORTS*sizeof(*(s.listenports)));
   s.p = PROCESS_CURRENT();
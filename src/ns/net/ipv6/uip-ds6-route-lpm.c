@@ -0,0 +1,232 @@
+/**
+ * \addtogroup uip
+ * @{
+ */
+
+/**
+ * \file
+ *    Longest prefix match index of the routing table
+ */
+#include "net/ipv6/uip-ds6-route-lpm.h"
+#include "lib/memb.h"
+
+#include <string.h>
+
+#if UIP_DS6_ROUTE_LPM
+
+/* A trie node covers the first length bits of prefix, the remaining
+   bits are zero. Nodes without a route always have two children. */
+struct lpm_node {
+  struct lpm_node *child[2];
+  uip_ds6_route_t *route;
+  uip_ipaddr_t prefix;
+  uint8_t length;
+};
+
+/* Each route adds at most one leaf and one branching node */
+MEMB(lpm_nodes, struct lpm_node, 2 * UIP_DS6_ROUTE_NB);
+
+static struct lpm_node *root;
+
+/*---------------------------------------------------------------------------*/
+static int
+bit_at(const uip_ipaddr_t *addr, uint8_t index)
+{
+  return (addr->u8[index >> 3] >> (7 - (index & 7))) & 1;
+}
+/*---------------------------------------------------------------------------*/
+/* Check if the first length bits of addr and prefix are equal */
+static int
+prefix_match(const uip_ipaddr_t *addr, const uip_ipaddr_t *prefix,
+             uint8_t length)
+{
+  uint8_t bytes = length >> 3;
+  uint8_t bits = length & 7;
+
+  if(memcmp(addr, prefix, bytes) != 0) {
+    return 0;
+  }
+  return bits == 0 ||
+    ((addr->u8[bytes] ^ prefix->u8[bytes]) & (0xff00 >> bits)) == 0;
+}
+/*---------------------------------------------------------------------------*/
+/* Number of leading bits a and b have in common, at most max */
+static uint8_t
+common_length(const uip_ipaddr_t *a, const uip_ipaddr_t *b, uint8_t max)
+{
+  uint8_t length = 0;
+  uint8_t diff;
+  unsigned i;
+
+  for(i = 0; i < sizeof(uip_ipaddr_t) && length < max; i++) {
+    diff = a->u8[i] ^ b->u8[i];
+    if(diff != 0) {
+      while((diff & 0x80) == 0) {
+        diff <<= 1;
+        length++;
+      }
+      break;
+    }
+    length += 8;
+  }
+  return length < max ? length : max;
+}
+/*---------------------------------------------------------------------------*/
+static struct lpm_node *
+node_alloc(const uip_ipaddr_t *prefix, uint8_t length,
+           uip_ds6_route_t *route)
+{
+  struct lpm_node *n = memb_alloc(&lpm_nodes);
+  uint8_t bytes = length >> 3;
+
+  if(n != NULL) {
+    memset(n, 0, sizeof(*n));
+    memcpy(&n->prefix, prefix, bytes);
+    if(length & 7) {
+      n->prefix.u8[bytes] = prefix->u8[bytes] & (0xff00 >> (length & 7));
+    }
+    n->length = length;
+    n->route = route;
+  }
+  return n;
+}
+/*---------------------------------------------------------------------------*/
+void
+uip_ds6_route_lpm_init(void)
+{
+  memb_init(&lpm_nodes);
+  root = NULL;
+}
+/*---------------------------------------------------------------------------*/
+int
+uip_ds6_route_lpm_add(uip_ds6_route_t *route)
+{
+  const uip_ipaddr_t *prefix = &route->ipaddr;
+  uint8_t length = route->length < 128 ? route->length : 128;
+  struct lpm_node **link = &root;
+  struct lpm_node *n, *m, *b;
+  uint8_t common;
+
+  while((n = *link) != NULL) {
+    common = common_length(prefix, &n->prefix,
+                           length < n->length ? length : n->length);
+    if(common == n->length) {
+      if(length == n->length) {
+        n->route = route;
+        return 1;
+      }
+      /* n covers the prefix, continue below it */
+      link = &n->child[bit_at(prefix, n->length)];
+      continue;
+    }
+
+    /* The prefix diverges from n, or ends, within the bits n skips */
+    if(common == length) {
+      m = node_alloc(prefix, length, route);
+      if(m == NULL) {
+        return 0;
+      }
+      m->child[bit_at(&n->prefix, length)] = n;
+      *link = m;
+      return 1;
+    }
+
+    b = node_alloc(prefix, common, NULL);
+    m = node_alloc(prefix, length, route);
+    if(b == NULL || m == NULL) {
+      if(b != NULL) {
+        memb_free(&lpm_nodes, b);
+      }
+      if(m != NULL) {
+        memb_free(&lpm_nodes, m);
+      }
+      return 0;
+    }
+    b->child[bit_at(prefix, common)] = m;
+    b->child[bit_at(&n->prefix, common)] = n;
+    *link = b;
+    return 1;
+  }
+
+  *link = node_alloc(prefix, length, route);
+  return *link != NULL;
+}
+/*---------------------------------------------------------------------------*/
+void
+uip_ds6_route_lpm_rm(uip_ds6_route_t *route)
+{
+  const uip_ipaddr_t *prefix = &route->ipaddr;
+  uint8_t length = route->length < 128 ? route->length : 128;
+  struct lpm_node **link = &root;
+  struct lpm_node **parent_link = NULL;
+  struct lpm_node *n, *p;
+
+  while((n = *link) != NULL && n->length < length) {
+    if(!prefix_match(prefix, &n->prefix, n->length)) {
+      return;
+    }
+    parent_link = link;
+    link = &n->child[bit_at(prefix, n->length)];
+  }
+
+  if(n == NULL || n->route != route) {
+    return;
+  }
+
+  n->route = NULL;
+  if(n->child[0] != NULL && n->child[1] != NULL) {
+    /* Still needed to branch */
+    return;
+  }
+
+  *link = n->child[0] != NULL ? n->child[0] : n->child[1];
+  memb_free(&lpm_nodes, n);
+
+  if(*link == NULL && parent_link != NULL) {
+    /* The parent lost a child, a routeless parent no longer branches */
+    p = *parent_link;
+    if(p->route == NULL) {
+      *parent_link = p->child[0] != NULL ? p->child[0] : p->child[1];
+      memb_free(&lpm_nodes, p);
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+uip_ds6_route_t *
+uip_ds6_route_lpm_lookup(const uip_ipaddr_t *addr)
+{
+  struct lpm_node *n = root;
+  uip_ds6_route_t *found = NULL;
+
+  while(n != NULL && prefix_match(addr, &n->prefix, n->length)) {
+    if(n->route != NULL) {
+      found = n->route;
+    }
+    if(n->length == 128) {
+      break;
+    }
+    n = n->child[bit_at(addr, n->length)];
+  }
+  return found;
+}
+/*---------------------------------------------------------------------------*/
+uip_ds6_route_t *
+uip_ds6_route_lpm_find(const uip_ipaddr_t *prefix, uint8_t length)
+{
+  struct lpm_node *n = root;
+
+  if(length > 128) {
+    length = 128;
+  }
+  while(n != NULL && n->length <= length &&
+        prefix_match(prefix, &n->prefix, n->length)) {
+    if(n->length == length) {
+      return n->route;
+    }
+    n = n->child[bit_at(prefix, n->length)];
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+#endif /* UIP_DS6_ROUTE_LPM */
+/** @} */
@@ -0,0 +1,40 @@
+/**
+ * \addtogroup uip
+ * @{
+ */
+
+/**
+ * \file
+ *    Longest prefix match index of the routing table
+ *
+ *    Routes are kept in a path-compressed binary trie keyed on their
+ *    prefix. Every node skips the bits its children share, so a lookup
+ *    visits at most one node per distinct prefix length on the path and
+ *    the trie never holds more than two nodes per route.
+ */
+
+#ifndef UIP_DS6_ROUTE_LPM_H
+#define UIP_DS6_ROUTE_LPM_H
+
+#include "net/ipv6/uip-ds6-route.h"
+
+/** \brief Remove every route from the index */
+void uip_ds6_route_lpm_init(void);
+
+/** \brief Index a route by its ipaddr and length. An already indexed
+    route with the same prefix is replaced.
+    \return 1 on success, 0 if the index is full */
+int uip_ds6_route_lpm_add(uip_ds6_route_t *route);
+
+/** \brief Remove a route from the index */
+void uip_ds6_route_lpm_rm(uip_ds6_route_t *route);
+
+/** \brief The route with the longest prefix matching addr, or NULL */
+uip_ds6_route_t *uip_ds6_route_lpm_lookup(const uip_ipaddr_t *addr);
+
+/** \brief The route with exactly this prefix, or NULL */
+uip_ds6_route_t *uip_ds6_route_lpm_find(const uip_ipaddr_t *prefix,
+                                        uint8_t length);
+
+#endif /* UIP_DS6_ROUTE_LPM_H */
+/** @} */
@@ -40,6 +40,7 @@
  */
 #include "net/ipv6/uip-ds6.h"
 #include "net/ipv6/uip-ds6-route.h"
+#include "net/ipv6/uip-ds6-route-lpm.h"
 #include "net/ipv6/uip.h"
 
 #include "lib/list.h"
@@ -174,6 +175,9 @@ uip_ds6_route_init(void)
 #if (UIP_MAX_ROUTES != 0)
   memb_init(&routememb);
   list_init(routelist);
+#if UIP_DS6_ROUTE_LPM
+  uip_ds6_route_lpm_init();
+#endif /* UIP_DS6_ROUTE_LPM */
   nbr_table_register(nbr_routes,
                      (nbr_table_callback *)rm_routelist_callback);
 #endif /* (UIP_MAX_ROUTES != 0) */
@@ -266,9 +270,11 @@ uip_ds6_route_t *
 uip_ds6_route_lookup(const uip_ipaddr_t *addr)
 {
 #if (UIP_MAX_ROUTES != 0)
-  uip_ds6_route_t *r;
   uip_ds6_route_t *found_route;
+#if !UIP_DS6_ROUTE_LPM
+  uip_ds6_route_t *r;
   uint8_t longestmatch;
+#endif /* !UIP_DS6_ROUTE_LPM */
 
   LOG_INFO("Looking up route for ");
   LOG_INFO_6ADDR(addr);
@@ -278,6 +284,9 @@ uip_ds6_route_lookup(const uip_ipaddr_t *addr)
     return NULL;
   }
 
+#if UIP_DS6_ROUTE_LPM
+  found_route = uip_ds6_route_lpm_lookup(addr);
+#else /* UIP_DS6_ROUTE_LPM */
   found_route = NULL;
   longestmatch = 0;
   for(r = uip_ds6_route_head();
@@ -293,6 +302,7 @@ uip_ds6_route_lookup(const uip_ipaddr_t *addr)
       }
     }
   }
+#endif /* UIP_DS6_ROUTE_LPM */
 
   if(found_route != NULL) {
     LOG_INFO("Found route: ");
@@ -362,6 +372,13 @@ uip_ds6_route_add(const uip_ipaddr_t *ipaddr, uint8_t length,
 
     uip_ds6_route_rm(r);
   }
+#if UIP_DS6_ROUTE_LPM
+  /* The index holds a single route per prefix, replace the old one */
+  r = uip_ds6_route_lpm_find(ipaddr, length);
+  if(r != NULL) {
+    uip_ds6_route_rm(r);
+  }
+#endif /* UIP_DS6_ROUTE_LPM */
   {
     struct uip_ds6_route_neighbor_routes *routes;
     /* If there is no routing entry, create one. We first need to
@@ -455,6 +472,11 @@ uip_ds6_route_add(const uip_ipaddr_t *ipaddr, uint8_t length,
 
   uip_ipaddr_copy(&(r->ipaddr), ipaddr);
   r->length = length;
+#if UIP_DS6_ROUTE_LPM
+  if(!uip_ds6_route_lpm_add(r)) {
+    LOG_ERR("Add: could not index route\n");
+  }
+#endif /* UIP_DS6_ROUTE_LPM */
 
 #ifdef UIP_DS6_ROUTE_STATE_TYPE
   memset(&r->state, 0, sizeof(UIP_DS6_ROUTE_STATE_TYPE));
@@ -500,6 +522,9 @@ uip_ds6_route_rm(uip_ds6_route_t *route)
 
     /* Remove the route from the route list */
     list_remove(routelist, route);
+#if UIP_DS6_ROUTE_LPM
+    uip_ds6_route_lpm_rm(route);
+#endif /* UIP_DS6_ROUTE_LPM */
 
     /* Find the corresponding neighbor_route and remove it. */
     for(neighbor_route = list_head(route->neighbor_routes->route_list);
@@ -111,6 +111,14 @@ void uip_ds6_notification_rm(struct uip_ds6_notification *n);
 #define UIP_DS6_ROUTE_NB 4
 #endif /* UIP_MAX_ROUTES */
 
+/* Index the routing table with a longest prefix match trie, see
+   uip-ds6-route-lpm.h. Lookups then no longer scan every route. */
+#ifdef UIP_DS6_ROUTE_CONF_LPM
+#define UIP_DS6_ROUTE_LPM UIP_DS6_ROUTE_CONF_LPM
+#else /* UIP_DS6_ROUTE_CONF_LPM */
+#define UIP_DS6_ROUTE_LPM 0
+#endif /* UIP_DS6_ROUTE_CONF_LPM */
+
 /** \brief define some additional RPL related route state and
  *  neighbor callback for RPL - if not a DS6_ROUTE_STATE is already set */
 #ifndef UIP_DS6_ROUTE_STATE_TYPE
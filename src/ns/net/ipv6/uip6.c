@@ -81,6 +81,8 @@
 #include "net/ipv6/multicast/uip-mcast6.h"
 #include "net/routing/routing.h"
 
+#include <string.h>
+
 #if UIP_ND6_SEND_NS
 #include "net/ipv6/uip-ds6-nbr.h"
 #endif /* UIP_ND6_SEND_NS */
@@ -297,6 +299,117 @@ uip_add32(uint8_t *op32, uint16_t op16)
 #endif /* UIP_TCP */
 
 #if ! UIP_ARCH_CHKSUM
+#if UIP_CHKSUM_WIDE
+#if UIP_CHKSUM_SIMD && defined(__AVX2__)
+#include <immintrin.h>
+#elif UIP_CHKSUM_SIMD && defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+/*---------------------------------------------------------------------------*/
+/* Sum the data as native byte order 16-bit words. The ones' complement
+   sum doesn't depend on the byte order (RFC 1071), it only needs the
+   result swapped on little endian CPUs. */
+static uint64_t
+chksum_native(const uint8_t *data, uint16_t len)
+{
+  uint64_t acc = 0;
+  uint32_t w32;
+  uint16_t w16;
+
+#if UIP_CHKSUM_SIMD && defined(__AVX2__)
+  if(len >= 32) {
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i sum32 = zero;
+    uint32_t lanes[8];
+    int i;
+
+    /* Widen the 16-bit words to 32-bit lanes, at most 65535 bytes can't
+       overflow them */
+    while(len >= 32) {
+      __m256i v = _mm256_loadu_si256((const __m256i *)data);
+      sum32 = _mm256_add_epi32(sum32, _mm256_unpacklo_epi16(v, zero));
+      sum32 = _mm256_add_epi32(sum32, _mm256_unpackhi_epi16(v, zero));
+      data += 32;
+      len -= 32;
+    }
+    _mm256_storeu_si256((__m256i *)lanes, sum32);
+    for(i = 0; i < 8; i++) {
+      acc += lanes[i];
+    }
+  }
+#elif UIP_CHKSUM_SIMD && defined(__SSE2__)
+  if(len >= 16) {
+    const __m128i zero = _mm_setzero_si128();
+    __m128i sum32 = zero;
+    uint32_t lanes[4];
+    int i;
+
+    while(len >= 16) {
+      __m128i v = _mm_loadu_si128((const __m128i *)data);
+      sum32 = _mm_add_epi32(sum32, _mm_unpacklo_epi16(v, zero));
+      sum32 = _mm_add_epi32(sum32, _mm_unpackhi_epi16(v, zero));
+      data += 16;
+      len -= 16;
+    }
+    _mm_storeu_si128((__m128i *)lanes, sum32);
+    for(i = 0; i < 4; i++) {
+      acc += lanes[i];
+    }
+  }
+#endif /* UIP_CHKSUM_SIMD */
+
+  /* Carries collect in the upper 32 bits, folded at the end */
+  while(len >= 16) {
+    memcpy(&w32, data, 4);
+    acc += w32;
+    memcpy(&w32, data + 4, 4);
+    acc += w32;
+    memcpy(&w32, data + 8, 4);
+    acc += w32;
+    memcpy(&w32, data + 12, 4);
+    acc += w32;
+    data += 16;
+    len -= 16;
+  }
+  while(len >= 4) {
+    memcpy(&w32, data, 4);
+    acc += w32;
+    data += 4;
+    len -= 4;
+  }
+  if(len >= 2) {
+    memcpy(&w16, data, 2);
+    acc += w16;
+    data += 2;
+    len -= 2;
+  }
+  if(len == 1) {
+    /* The odd byte is padded with a zero byte */
+    w16 = 0;
+    memcpy(&w16, data, 1);
+    acc += w16;
+  }
+  return acc;
+}
+/*---------------------------------------------------------------------------*/
+static uint16_t
+chksum(uint16_t sum, const uint8_t *data, uint16_t len)
+{
+  uint64_t acc = chksum_native(data, len);
+
+  acc = (acc >> 32) + (acc & 0xffffffff);
+  acc = (acc >> 16) + (acc & 0xffff);
+  acc = (acc >> 16) + (acc & 0xffff);
+  acc = (acc >> 16) + (acc & 0xffff);
+#if UIP_BYTE_ORDER == UIP_LITTLE_ENDIAN
+  acc = ((acc & 0xff) << 8) | (acc >> 8);
+#endif /* UIP_BYTE_ORDER == UIP_LITTLE_ENDIAN */
+
+  /* Return sum in host byte order. */
+  acc += sum;
+  return (uint16_t)((acc >> 16) + (acc & 0xffff));
+}
+#else /* UIP_CHKSUM_WIDE */
 /*---------------------------------------------------------------------------*/
 static uint16_t
 chksum(uint16_t sum, const uint8_t *data, uint16_t len)
@@ -328,6 +441,7 @@ chksum(uint16_t sum, const uint8_t *data, uint16_t len)
   /* Return sum in host byte order. */
   return sum;
 }
+#endif /* UIP_CHKSUM_WIDE */
 /*---------------------------------------------------------------------------*/
 uint16_t
 uip_chksum(uint16_t *data, uint16_t len)
@@ -613,6 +613,31 @@ void uip_log(char *msg);
 #define UIP_BYTE_ORDER     (UIP_LITTLE_ENDIAN)
 #endif /* UIP_CONF_BYTE_ORDER */
 
+/**
+ * Compute the Internet checksum over 32-bit loads summed into a 64-bit
+ * accumulator instead of one 16-bit word at a time. Meant for hosted
+ * builds with 64-bit CPUs, it needs no alignment of the data.
+ *
+ * \hideinitializer
+ */
+#ifdef UIP_CONF_CHKSUM_WIDE
+#define UIP_CHKSUM_WIDE (UIP_CONF_CHKSUM_WIDE)
+#else /* UIP_CONF_CHKSUM_WIDE */
+#define UIP_CHKSUM_WIDE 0
+#endif /* UIP_CONF_CHKSUM_WIDE */
+
+/**
+ * With UIP_CHKSUM_WIDE, also sum 16 or 32 bytes at a time with SSE2 or
+ * AVX2 when the compiler targets them (-msse2, -mavx2 or -march).
+ *
+ * \hideinitializer
+ */
+#ifdef UIP_CONF_CHKSUM_SIMD
+#define UIP_CHKSUM_SIMD (UIP_CONF_CHKSUM_SIMD)
+#else /* UIP_CONF_CHKSUM_SIMD */
+#define UIP_CHKSUM_SIMD 0
+#endif /* UIP_CONF_CHKSUM_SIMD */
+
 /** @} */
 /*------------------------------------------------------------------------------*/
 
@@ -49,6 +49,9 @@
 #include "net/netstack.h"
 #include "lib/list.h"
 #include "lib/memb.h"
+#include "net/nbr-table.h"
+#include "net/mac/csma/csma-output.h"
+#include <string.h>
 
 #if CONTIKI_TARGET_COOJA
 #include "lib/simEnvChange.h"
@@ -90,30 +93,46 @@
 #define CSMA_MAX_FRAME_RETRIES 7
 #endif
 
-/* Packet metadata */
-struct qbuf_metadata {
+/* Frames sent back to back to the same neighbor once one is acked,
+   without backoff. The frame pending bit tells the neighbor more are
+   coming. 0 disables bursts. */
+#ifdef CSMA_CONF_BURST_MAX
+#define CSMA_BURST_MAX CSMA_CONF_BURST_MAX
+#else
+#define CSMA_BURST_MAX 0
+#endif
+
+#define FRAME_PENDING_BIT 0x10
+
+/* Neighbor packet queue, with the packet metadata */
+struct packet_queue {
+  struct packet_queue *next;
+  struct queuebuf *buf;
   mac_callback_t sent;
   void *cptr;
   uint8_t max_transmissions;
 };
 
-/* Every neighbor has its own packet queue */
+/* Every neighbor with packets queued has its own packet queue. A
+   neighbor the neighbor table knows already has it there, locked while
+   packets are queued and removed once the queue is empty. Others, e.g.
+   the broadcast address, get it from a small pool of their own: adding
+   them to the table could evict a neighbor of another table. */
 struct neighbor_queue {
+  /* Only used in the list of queues from the pool */
   struct neighbor_queue *next;
-  linkaddr_t addr;
   struct ctimer transmit_timer;
   uint8_t transmissions;
   uint8_t collisions;
+  /* Frames sent in the current burst */
+  uint8_t burst;
+  /* Packets queued */
+  uint8_t queue_len;
   LIST_STRUCT(packet_queue);
+  /* Where the neighbor's statistics are counted */
+  struct csma_neighbor_stats *stats;
 };
 
-/* The maximum number of co-existing neighbor queues */
-#ifdef CSMA_CONF_MAX_NEIGHBOR_QUEUES
-#define CSMA_MAX_NEIGHBOR_QUEUES CSMA_CONF_MAX_NEIGHBOR_QUEUES
-#else
-#define CSMA_MAX_NEIGHBOR_QUEUES 2
-#endif /* CSMA_CONF_MAX_NEIGHBOR_QUEUES */
-
 /* The maximum number of pending packet per neighbor */
 #ifdef CSMA_CONF_MAX_PACKET_PER_NEIGHBOR
 #define CSMA_MAX_PACKET_PER_NEIGHBOR CSMA_CONF_MAX_PACKET_PER_NEIGHBOR
@@ -121,19 +140,44 @@ struct neighbor_queue {
 #define CSMA_MAX_PACKET_PER_NEIGHBOR MAX_QUEUED_PACKETS
 #endif /* CSMA_CONF_MAX_PACKET_PER_NEIGHBOR */
 
-#define MAX_QUEUED_PACKETS QUEUEBUF_NUM
+/* The number of neighbor queues outside the neighbor table */
+#ifdef CSMA_CONF_MAX_NEIGHBOR_QUEUES
+#define CSMA_MAX_NEIGHBOR_QUEUES CSMA_CONF_MAX_NEIGHBOR_QUEUES
+#else
+#define CSMA_MAX_NEIGHBOR_QUEUES 2
+#endif /* CSMA_CONF_MAX_NEIGHBOR_QUEUES */
 
-/* Neighbor packet queue */
-struct packet_queue {
-  struct packet_queue *next;
-  struct queuebuf *buf;
-  void *ptr;
+/* A neighbor queue from the pool, which has to keep its address */
+struct pool_queue {
+  /* First, so that a pointer to either is a pointer to both */
+  struct neighbor_queue n;
+  linkaddr_t addr;
 };
 
-MEMB(neighbor_memb, struct neighbor_queue, CSMA_MAX_NEIGHBOR_QUEUES);
+#define MAX_QUEUED_PACKETS QUEUEBUF_NUM
+
 MEMB(packet_memb, struct packet_queue, MAX_QUEUED_PACKETS);
-MEMB(metadata_memb, struct qbuf_metadata, MAX_QUEUED_PACKETS);
-LIST(neighbor_list);
+NBR_TABLE(struct neighbor_queue, neighbor_queues);
+MEMB(pool_memb, struct pool_queue, CSMA_MAX_NEIGHBOR_QUEUES);
+LIST(pool_list);
+
+/* The statistics of the neighbors in the neighbor table, kept after
+   their queue is gone for as long as the neighbor is there. The table
+   is not locked, it never keeps a neighbor in. The neighbors outside
+   of it are counted together. */
+NBR_TABLE(struct csma_neighbor_stats, neighbor_stats);
+static struct csma_neighbor_stats other_stats;
+static uint8_t other_stats_used;
+
+/* Packets of removed neighbor table entries, reported as dropped from
+   a timer rather than from within the neighbor table */
+LIST(dropped_list);
+static struct ctimer dropped_timer;
+
+/* The frame of the last transmission, still framed in packetbuf as long
+   as packetbuf_version() has not changed */
+static struct packet_queue *last_frame;
+static uint32_t last_frame_version;
 
 void packet_sent(void *ptr, int status, int num_transmissions);
 static void transmit_from_queue(void *ptr);
@@ -141,14 +185,84 @@ static void transmit_from_queue(void *ptr);
 static struct neighbor_queue *
 neighbor_queue_from_addr(const linkaddr_t *addr)
 {
-  struct neighbor_queue *n = list_head(neighbor_list);
-  while(n != NULL) {
-    if(linkaddr_cmp(&n->addr, addr)) {
-      return n;
+  struct neighbor_queue *n;
+
+  n = nbr_table_get_from_lladdr(neighbor_queues, addr);
+  if(n == NULL) {
+    for(n = list_head(pool_list); n != NULL; n = list_item_next(n)) {
+      if(linkaddr_cmp(&((struct pool_queue *)n)->addr, addr)) {
+        break;
+      }
     }
-    n = list_item_next(n);
   }
-  return NULL;
+  return n;
+}
+/*---------------------------------------------------------------------------*/
+static const linkaddr_t *
+neighbor_queue_addr(struct neighbor_queue *n)
+{
+  if(memb_inmemb(&pool_memb, n)) {
+    return &((struct pool_queue *)n)->addr;
+  }
+  return nbr_table_get_lladdr(neighbor_queues, n);
+}
+/*---------------------------------------------------------------------------*/
+static struct csma_neighbor_stats *
+neighbor_stats_get(const linkaddr_t *addr)
+{
+  struct csma_neighbor_stats *s;
+
+  s = nbr_table_get_from_lladdr(neighbor_stats, addr);
+  if(s == NULL && nbr_table_has_lladdr(addr)) {
+    /* Zeroed by the neighbor table */
+    s = nbr_table_add_lladdr(neighbor_stats, addr, NBR_TABLE_REASON_MAC, NULL);
+  }
+  if(s == NULL) {
+    s = &other_stats;
+    other_stats_used = 1;
+  }
+  return s;
+}
+/*---------------------------------------------------------------------------*/
+/* Allocate an empty queue, in the neighbor table if the neighbor is
+   there already or else from the pool */
+static struct neighbor_queue *
+neighbor_queue_add(const linkaddr_t *addr)
+{
+  struct neighbor_queue *n = NULL;
+
+  if(nbr_table_has_lladdr(addr)) {
+    /* Zeroed by the neighbor table, and locked while packets are queued */
+    n = nbr_table_add_lladdr(neighbor_queues, addr, NBR_TABLE_REASON_MAC, NULL);
+  }
+  if(n != NULL) {
+    nbr_table_lock(neighbor_queues, n);
+  } else {
+    struct pool_queue *p = memb_alloc(&pool_memb);
+    if(p == NULL) {
+      return NULL;
+    }
+    memset(p, 0, sizeof(*p));
+    linkaddr_copy(&p->addr, addr);
+    n = &p->n;
+    list_add(pool_list, n);
+  }
+  LIST_STRUCT_INIT(n, packet_queue);
+  n->stats = neighbor_stats_get(addr);
+  return n;
+}
+/*---------------------------------------------------------------------------*/
+/* Give back the entry of a queue that has become empty */
+static void
+neighbor_queue_remove(struct neighbor_queue *n)
+{
+  ctimer_stop(&n->transmit_timer);
+  if(memb_inmemb(&pool_memb, n)) {
+    list_remove(pool_list, n);
+    memb_free(&pool_memb, n);
+  } else {
+    nbr_table_remove(neighbor_queues, n);
+  }
 }
 /*---------------------------------------------------------------------------*/
 static clock_time_t
@@ -165,98 +279,117 @@ backoff_period(void)
 #endif /* CONTIKI_TARGET_COOJA */
 }
 /*---------------------------------------------------------------------------*/
-static void
-send_one_packet(void *ptr)
+static int
+create_frame(int pending)
 {
-  int ret;
-
   packetbuf_set_addr(PACKETBUF_ADDR_SENDER, &linkaddr_node_addr);
   packetbuf_set_attr(PACKETBUF_ATTR_MAC_ACK, 1);
 
   if(NETSTACK_FRAMER.create() < 0) {
     /* Failed to allocate space for headers */
     LOG_ERR("failed to create packet\r\n");
-    ret = MAC_TX_ERR_FATAL;
-  } else {
-    int is_broadcast;
-    uint8_t dsn;
-    dsn = ((uint8_t *)packetbuf_hdrptr())[2] & 0xff;
+    return 0;
+  }
+  if(pending) {
+    /* More frames follow for the same neighbor */
+    ((uint8_t *)packetbuf_hdrptr())[0] |= FRAME_PENDING_BIT;
+  }
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+/* Transmit the frame in packetbuf, framed already */
+static void
+send_one_packet(struct neighbor_queue *n)
+{
+  int ret;
+  int is_broadcast;
+  uint8_t dsn;
 
-    NETSTACK_RADIO.prepare(packetbuf_hdrptr(), packetbuf_totlen());
+  dsn = ((const uint8_t *)packetbuf_hdrptr_const())[2] & 0xff;
 
-    is_broadcast = packetbuf_holds_broadcast();
+  NETSTACK_RADIO.prepare(packetbuf_hdrptr_const(), packetbuf_totlen());
 
-    if(NETSTACK_RADIO.receiving_packet() ||
-       (!is_broadcast && NETSTACK_RADIO.pending_packet())) {
+  is_broadcast = packetbuf_holds_broadcast();
 
-      /* Currently receiving a packet over air or the radio has
-         already received a packet that needs to be read before
-         sending with auto ack. */
-      ret = MAC_TX_COLLISION;
-    } else {
+  if(NETSTACK_RADIO.receiving_packet() ||
+     (!is_broadcast && NETSTACK_RADIO.pending_packet())) {
 
-      switch(NETSTACK_RADIO.transmit(packetbuf_totlen())) {
-      case RADIO_TX_OK:
-        if(is_broadcast) {
-          ret = MAC_TX_OK;
-        } else {
-          rtimer_clock_t wt;
-
-          /* Check for ack */
-          wt = RTIMER_NOW();
-          watchdog_periodic();
-          while(RTIMER_CLOCK_LT(RTIMER_NOW(), wt + CSMA_ACK_WAIT_TIME)) {
+    /* Currently receiving a packet over air or the radio has
+       already received a packet that needs to be read before
+       sending with auto ack. */
+    ret = MAC_TX_COLLISION;
+  } else {
+
+    switch(NETSTACK_RADIO.transmit(packetbuf_totlen())) {
+    case RADIO_TX_OK:
+      if(is_broadcast) {
+        ret = MAC_TX_OK;
+      } else {
+        rtimer_clock_t wt;
+
+        /* Check for ack */
+        wt = RTIMER_NOW();
+        watchdog_periodic();
+        while(RTIMER_CLOCK_LT(RTIMER_NOW(), wt + CSMA_ACK_WAIT_TIME)) {
 #if CONTIKI_TARGET_COOJA
-            simProcessRunValue = 1;
-            cooja_mt_yield();
+          simProcessRunValue = 1;
+          cooja_mt_yield();
 #endif /* CONTIKI_TARGET_COOJA */
-          }
+        }
 
-          ret = MAC_TX_NOACK;
-          if(NETSTACK_RADIO.receiving_packet() ||
-             NETSTACK_RADIO.pending_packet() ||
-             NETSTACK_RADIO.channel_clear() == 0) {
-            int len;
-            uint8_t ackbuf[CSMA_ACK_LEN];
-
-            if(CSMA_AFTER_ACK_DETECTED_WAIT_TIME > 0) {
-              wt = RTIMER_NOW();
-              watchdog_periodic();
-              while(RTIMER_CLOCK_LT(RTIMER_NOW(),
-                                    wt + CSMA_AFTER_ACK_DETECTED_WAIT_TIME)) {
+        ret = MAC_TX_NOACK;
+        if(NETSTACK_RADIO.receiving_packet() ||
+           NETSTACK_RADIO.pending_packet() ||
+           NETSTACK_RADIO.channel_clear() == 0) {
+          int len;
+          uint8_t ackbuf[CSMA_ACK_LEN];
+
+          if(CSMA_AFTER_ACK_DETECTED_WAIT_TIME > 0) {
+            wt = RTIMER_NOW();
+            watchdog_periodic();
+            while(RTIMER_CLOCK_LT(RTIMER_NOW(),
+                                  wt + CSMA_AFTER_ACK_DETECTED_WAIT_TIME)) {
 #if CONTIKI_TARGET_COOJA
-                simProcessRunValue = 1;
-                cooja_mt_yield();
+              simProcessRunValue = 1;
+              cooja_mt_yield();
 #endif /* CONTIKI_TARGET_COOJA */
-              }
             }
+          }
 
-            if(NETSTACK_RADIO.pending_packet()) {
-              len = NETSTACK_RADIO.read(ackbuf, CSMA_ACK_LEN);
-              if(len == CSMA_ACK_LEN && ackbuf[2] == dsn) {
-                /* Ack received */
-                ret = MAC_TX_OK;
-              } else {
-                /* Not an ack or ack not for us: collision */
-                ret = MAC_TX_COLLISION;
-              }
+          if(NETSTACK_RADIO.pending_packet()) {
+            len = NETSTACK_RADIO.read(ackbuf, CSMA_ACK_LEN);
+            if(len == CSMA_ACK_LEN && ackbuf[2] == dsn) {
+              /* Ack received */
+              ret = MAC_TX_OK;
+            } else {
+              /* Not an ack or ack not for us: collision */
+              ret = MAC_TX_COLLISION;
             }
           }
         }
-        break;
-      case RADIO_TX_COLLISION:
-        ret = MAC_TX_COLLISION;
-        break;
-      default:
-        ret = MAC_TX_ERR;
-        break;
       }
+      break;
+    case RADIO_TX_COLLISION:
+      ret = MAC_TX_COLLISION;
+      break;
+    default:
+      ret = MAC_TX_ERR;
+      break;
     }
   }
 
-  packet_sent(ptr, ret, 1);
+  n->stats->tx++;
+  packet_sent(n, ret, 1);
 }
 
+/*---------------------------------------------------------------------------*/
+/* Unicast frames can go back to back once the neighbor acked one */
+static int
+burst_allowed(struct neighbor_queue *n)
+{
+  return CSMA_BURST_MAX > 0 && n->burst < CSMA_BURST_MAX &&
+    !linkaddr_cmp(neighbor_queue_addr(n), &linkaddr_null);
+}
 /*---------------------------------------------------------------------------*/
 static void
 transmit_from_queue(void *ptr)
@@ -266,12 +399,24 @@ transmit_from_queue(void *ptr)
     struct packet_queue *q = list_head(n->packet_queue);
     if(q != NULL) {
       LOG_INFO("preparing packet for ");
-      LOG_INFO_LLADDR(&n->addr);
-      LOG_INFO_(", seqno %u, tx %u, queue %d\r\n",
+      LOG_INFO_LLADDR(neighbor_queue_addr(n));
+      LOG_INFO_(", seqno %u, tx %u, queue %u\r\n",
         queuebuf_attr(q->buf, PACKETBUF_ATTR_MAC_SEQNO),
-        n->transmissions, list_length(n->packet_queue));
+        n->transmissions, n->queue_len);
+      if(q == last_frame && packetbuf_version() == last_frame_version) {
+        /* A retransmission, the frame is still in packetbuf */
+        send_one_packet(n);
+        return;
+      }
       /* Send first packet in the neighbor queue */
       queuebuf_to_packetbuf(q->buf);
+      if(!create_frame(list_item_next(q) != NULL && burst_allowed(n))) {
+        last_frame = NULL;
+        packet_sent(n, MAC_TX_ERR_FATAL, 1);
+        return;
+      }
+      last_frame = q;
+      last_frame_version = packetbuf_version();
       send_one_packet(n);
     }
   }
@@ -291,6 +436,7 @@ schedule_transmission(struct neighbor_queue *n)
     /* Pick a time for next transmission */
     delay = random_rand() % delay;
   }
+  n->stats->backoffs++;
 
   LOG_DBG("scheduling transmission in %u ticks, NB=%u, BE=%u\r\n",
       (unsigned)delay, n->collisions, backoff_exponent);
@@ -303,23 +449,33 @@ free_packet(struct neighbor_queue *n, struct packet_queue *p, int status)
   if(p != NULL) {
     /* Remove packet from queue and deallocate */
     list_remove(n->packet_queue, p);
+    n->queue_len--;
+    n->stats->queue_len--;
+    if(p == last_frame) {
+      last_frame = NULL;
+    }
 
     queuebuf_free(p->buf);
-    memb_free(&metadata_memb, p->ptr);
     memb_free(&packet_memb, p);
-    LOG_DBG("free_queued_packet, queue length %d, free packets %d\r\n",
-           list_length(n->packet_queue), memb_numfree(&packet_memb));
+    LOG_DBG("free_queued_packet, queue length %u, free packets %d\r\n",
+           n->queue_len, memb_numfree(&packet_memb));
     if(list_head(n->packet_queue) != NULL) {
       /* There is a next packet. We reset current tx information */
       n->transmissions = 0;
       n->collisions = 0;
-      /* Schedule next transmissions */
-      schedule_transmission(n);
+      if(status == MAC_TX_OK && burst_allowed(n)) {
+        /* The neighbor is listening, send the next one without backoff */
+        n->burst++;
+        n->stats->bursts++;
+        ctimer_set(&n->transmit_timer, 0, transmit_from_queue, n);
+      } else {
+        /* Schedule next transmissions */
+        n->burst = 0;
+        schedule_transmission(n);
+      }
     } else {
-      /* This was the last packet in the queue, we free the neighbor */
-      ctimer_stop(&n->transmit_timer);
-      list_remove(neighbor_list, n);
-      memb_free(&neighbor_memb, n);
+      /* This was the last packet in the queue */
+      neighbor_queue_remove(n);
     }
   }
 }
@@ -328,21 +484,22 @@ static void
 tx_done(int status, struct packet_queue *q, struct neighbor_queue *n)
 {
   mac_callback_t sent;
-  struct qbuf_metadata *metadata;
   void *cptr;
   uint8_t ntx;
 
-  metadata = (struct qbuf_metadata *)q->ptr;
-  sent = metadata->sent;
-  cptr = metadata->cptr;
+  sent = q->sent;
+  cptr = q->cptr;
   ntx = n->transmissions;
 
   LOG_INFO("packet sent to ");
-  LOG_INFO_LLADDR(&n->addr);
+  LOG_INFO_LLADDR(neighbor_queue_addr(n));
   LOG_INFO_(", seqno %u, status %u, tx %u, coll %u\r\n",
               packetbuf_attr(PACKETBUF_ATTR_MAC_SEQNO),
               status, n->transmissions, n->collisions);
 
+  if(status != MAC_TX_OK) {
+    n->stats->failed++;
+  }
   free_packet(n, q, status);
   mac_call_sent_callback(sent, cptr, status, ntx);
 }
@@ -350,6 +507,7 @@ tx_done(int status, struct packet_queue *q, struct neighbor_queue *n)
 static void
 rexmit(struct packet_queue *q, struct neighbor_queue *n)
 {
+  n->burst = 0;
   schedule_transmission(n);
   /* This is needed to correctly attribute energy that we spent
      transmitting this packet. */
@@ -360,11 +518,8 @@ static void
 collision(struct packet_queue *q, struct neighbor_queue *n,
           int num_transmissions)
 {
-  struct qbuf_metadata *metadata;
-
-  metadata = (struct qbuf_metadata *)q->ptr;
-
   n->collisions += num_transmissions;
+  n->stats->collisions += num_transmissions;
 
   if(n->collisions > CSMA_MAX_BACKOFF) {
     n->collisions = 0;
@@ -372,7 +527,7 @@ collision(struct packet_queue *q, struct neighbor_queue *n,
     n->transmissions++;
   }
 
-  if(n->transmissions >= metadata->max_transmissions) {
+  if(n->transmissions >= q->max_transmissions) {
     tx_done(MAC_TX_COLLISION, q, n);
   } else {
     rexmit(q, n);
@@ -382,14 +537,10 @@ collision(struct packet_queue *q, struct neighbor_queue *n,
 static void
 noack(struct packet_queue *q, struct neighbor_queue *n, int num_transmissions)
 {
-  struct qbuf_metadata *metadata;
-
-  metadata = (struct qbuf_metadata *)q->ptr;
-
   n->collisions = 0;
   n->transmissions += num_transmissions;
 
-  if(n->transmissions >= metadata->max_transmissions) {
+  if(n->transmissions >= q->max_transmissions) {
     tx_done(MAC_TX_NOACK, q, n);
   } else {
     rexmit(q, n);
@@ -428,13 +579,10 @@ packet_sent(void *ptr, int status, int num_transmissions)
     LOG_WARN("packet sent: seqno %u not found\r\n",
            packetbuf_attr(PACKETBUF_ATTR_MAC_SEQNO));
     return;
-  } else if(q->ptr == NULL) {
-    LOG_WARN("packet sent: no metadata\r\n");
-    return;
   }
 
   LOG_INFO("tx to ");
-  LOG_INFO_LLADDR(&n->addr);
+  LOG_INFO_LLADDR(neighbor_queue_addr(n));
   LOG_INFO_(", seqno %u, status %u, tx %u, coll %u\r\n",
             packetbuf_attr(PACKETBUF_ATTR_MAC_SEQNO),
             status, n->transmissions, n->collisions);
@@ -483,78 +631,130 @@ csma_output_packet(mac_callback_t sent, void *ptr)
   /* Look for the neighbor entry */
   n = neighbor_queue_from_addr(addr);
   if(n == NULL) {
-    /* Allocate a new neighbor entry */
-    n = memb_alloc(&neighbor_memb);
-    if(n != NULL) {
-      /* Init neighbor entry */
-      linkaddr_copy(&n->addr, addr);
-      n->transmissions = 0;
-      n->collisions = 0;
-      /* Init packet queue for this neighbor */
-      LIST_STRUCT_INIT(n, packet_queue);
-      /* Add neighbor to the neighbor list */
-      list_add(neighbor_list, n);
-    }
+    n = neighbor_queue_add(addr);
   }
 
   if(n != NULL) {
     /* Add packet to the neighbor's queue */
-    if(list_length(n->packet_queue) < CSMA_MAX_PACKET_PER_NEIGHBOR) {
+    if(n->queue_len < CSMA_MAX_PACKET_PER_NEIGHBOR) {
       q = memb_alloc(&packet_memb);
       if(q != NULL) {
-        q->ptr = memb_alloc(&metadata_memb);
-        if(q->ptr != NULL) {
-          q->buf = queuebuf_new_from_packetbuf();
-          if(q->buf != NULL) {
-            struct qbuf_metadata *metadata = (struct qbuf_metadata *)q->ptr;
-            /* Neighbor and packet successfully allocated */
-            metadata->max_transmissions = packetbuf_attr(PACKETBUF_ATTR_MAX_MAC_TRANSMISSIONS);
-            if(metadata->max_transmissions == 0) {
-              /* If not set by the application, use the default CSMA value */
-              metadata->max_transmissions = CSMA_MAX_FRAME_RETRIES + 1;
-            }
-            metadata->sent = sent;
-            metadata->cptr = ptr;
-            list_add(n->packet_queue, q);
-
-            LOG_INFO("sending to ");
-            LOG_INFO_LLADDR(addr);
-            LOG_INFO_(", len %u, seqno %u, queue length %d, free packets %d\r\n",
-                    packetbuf_datalen(),
-                    packetbuf_attr(PACKETBUF_ATTR_MAC_SEQNO),
-                    list_length(n->packet_queue), memb_numfree(&packet_memb));
-            /* If q is the first packet in the neighbor's queue, send asap */
-            if(list_head(n->packet_queue) == q) {
-              schedule_transmission(n);
-            }
-            return;
+        q->buf = queuebuf_new_from_packetbuf();
+        if(q->buf != NULL) {
+          /* Neighbor and packet successfully allocated */
+          q->max_transmissions = packetbuf_attr(PACKETBUF_ATTR_MAX_MAC_TRANSMISSIONS);
+          if(q->max_transmissions == 0) {
+            /* If not set by the application, use the default CSMA value */
+            q->max_transmissions = CSMA_MAX_FRAME_RETRIES + 1;
+          }
+          q->sent = sent;
+          q->cptr = ptr;
+          list_add(n->packet_queue, q);
+          n->queue_len++;
+          if(++n->stats->queue_len > n->stats->max_queue_len) {
+            n->stats->max_queue_len = n->stats->queue_len;
+          }
+
+          LOG_INFO("sending to ");
+          LOG_INFO_LLADDR(addr);
+          LOG_INFO_(", len %u, seqno %u, queue length %u, free packets %d\r\n",
+                  packetbuf_datalen(),
+                  packetbuf_attr(PACKETBUF_ATTR_MAC_SEQNO),
+                  n->queue_len, memb_numfree(&packet_memb));
+          /* If q is the first packet in the neighbor's queue, send asap */
+          if(list_head(n->packet_queue) == q) {
+            schedule_transmission(n);
           }
-          memb_free(&metadata_memb, q->ptr);
-          LOG_WARN("could not allocate queuebuf, dropping packet\r\n");
+          return;
         }
         memb_free(&packet_memb, q);
         LOG_WARN("could not allocate queuebuf, dropping packet\r\n");
       }
-      /* The packet allocation failed. Remove and free neighbor entry if empty. */
-      if(list_length(n->packet_queue) == 0) {
-        list_remove(neighbor_list, n);
-        memb_free(&neighbor_memb, n);
-      }
     } else {
       LOG_WARN("Neighbor queue full\r\n");
     }
+    n->stats->drops++;
     LOG_WARN("could not allocate packet, dropping packet\r\n");
+    if(list_head(n->packet_queue) == NULL) {
+      neighbor_queue_remove(n);
+    }
   } else {
     LOG_WARN("could not allocate neighbor, dropping packet\r\n");
   }
   mac_call_sent_callback(sent, ptr, MAC_TX_ERR, 1);
 }
 /*---------------------------------------------------------------------------*/
+static void
+report_dropped(void *ptr)
+{
+  struct packet_queue *q;
+
+  while((q = list_pop(dropped_list)) != NULL) {
+    mac_callback_t sent = q->sent;
+    void *cptr = q->cptr;
+
+    queuebuf_free(q->buf);
+    memb_free(&packet_memb, q);
+    mac_call_sent_callback(sent, cptr, MAC_TX_ERR, 1);
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* The neighbor table reuses an entry, drop what is still queued */
+static void
+neighbor_removed(void *item)
+{
+  struct neighbor_queue *n = item;
+  struct packet_queue *q;
+
+  ctimer_stop(&n->transmit_timer);
+  n->stats->queue_len -= n->queue_len;
+  while((q = list_pop(n->packet_queue)) != NULL) {
+    if(q == last_frame) {
+      last_frame = NULL;
+    }
+    list_add(dropped_list, q);
+  }
+  if(list_head(dropped_list) != NULL) {
+    ctimer_set(&dropped_timer, 0, report_dropped, NULL);
+  }
+}
+/*---------------------------------------------------------------------------*/
+int
+csma_output_stats(int index, linkaddr_t *addr, struct csma_neighbor_stats *stats)
+{
+  struct csma_neighbor_stats *s;
+
+  for(s = nbr_table_head(neighbor_stats); s != NULL;
+      s = nbr_table_next(neighbor_stats, s)) {
+    if(index-- == 0) {
+      linkaddr_copy(addr, nbr_table_get_lladdr(neighbor_stats, s));
+      *stats = *s;
+      return 1;
+    }
+  }
+  /* The other neighbors, once they had a packet to send */
+  if(index == 0 && other_stats_used) {
+    linkaddr_copy(addr, &linkaddr_null);
+    *stats = other_stats;
+    return 1;
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
 void
 csma_output_init(void)
 {
   memb_init(&packet_memb);
-  memb_init(&metadata_memb);
-  memb_init(&neighbor_memb);
+  memb_init(&pool_memb);
+  list_init(pool_list);
+  list_init(dropped_list);
+  if(!nbr_table_register(neighbor_queues, neighbor_removed)) {
+    LOG_ERR("could not register the neighbor queue table\r\n");
+  }
+  if(!nbr_table_register(neighbor_stats, NULL)) {
+    LOG_ERR("could not register the neighbor statistics table\r\n");
+  }
+  memset(&other_stats, 0, sizeof(other_stats));
+  other_stats_used = 0;
   queuebuf_init();
 }
@@ -44,8 +44,40 @@
 
 #include "contiki.h"
 #include "net/mac/mac.h"
+#include "net/linkaddr.h"
+
+/* Per neighbor queue statistics, kept for as long as the neighbor is in
+   the neighbor table. The neighbors that are not, the broadcast address
+   among them, are counted together. */
+struct csma_neighbor_stats {
+  /* Packets queued now, and at most */
+  uint8_t queue_len;
+  uint8_t max_queue_len;
+  /* Frames transmitted, retransmissions included */
+  uint32_t tx;
+  /* Packets dropped because they could not be queued */
+  uint32_t drops;
+  /* Packets given up after too many collisions or missing acks */
+  uint32_t failed;
+  /* Random backoffs before a transmission */
+  uint32_t backoffs;
+  /* Collisions, channel busy or frame on air */
+  uint32_t collisions;
+  /* Frames sent right after the previous one, without backoff */
+  uint32_t bursts;
+};
 
 void csma_output_packet(mac_callback_t sent, void *ptr);
 void csma_output_init(void);
 
+/**
+ * \brief Get the queue statistics of a neighbor
+ * \param index index of the neighbor, from 0
+ * \param addr filled with the link-layer address of the neighbor, the
+ *        null address for the neighbors outside the neighbor table
+ * \param stats filled with its statistics
+ * \return 1 if there is such a neighbor, 0 otherwise
+ */
+int csma_output_stats(int index, linkaddr_t *addr, struct csma_neighbor_stats *stats);
+
 #endif /* CSMA_OUTPUT_H_ */
@@ -87,6 +87,7 @@ tsch_schedule_add_slotframe(uint16_t handle, uint16_t size)
       sf->handle = handle;
       TSCH_ASN_DIVISOR_INIT(sf->size, size);
       LIST_STRUCT_INIT(sf, links_list);
+      sf->cursor_valid = 0;
       /* Add the slotframe to the global list */
       list_add(slotframe_list, sf);
     }
@@ -242,8 +243,16 @@ tsch_schedule_add_link(struct tsch_slotframe *slotframe,
       } else {
         static int current_link_handle = 0;
         struct tsch_neighbor *n;
-        /* Add the link to the slotframe */
-        list_add(slotframe->links_list, l);
+        struct tsch_link *prev = NULL;
+        struct tsch_link *next;
+        /* Add the link to the slotframe, keeping the list sorted by timeslot */
+        for(next = list_head(slotframe->links_list);
+            next != NULL && next->timeslot < timeslot;
+            next = list_item_next(next)) {
+          prev = next;
+        }
+        list_insert(slotframe->links_list, prev, l);
+        slotframe->cursor_valid = 0;
         /* Initialize link */
         l->handle = current_link_handle++;
         l->link_options = link_options;
@@ -309,6 +318,7 @@ tsch_schedule_remove_link(struct tsch_slotframe *slotframe, struct tsch_link *l)
       LOG_INFO_("\n");
 
       list_remove(slotframe->links_list, l);
+      slotframe->cursor_valid = 0;
       memb_free(&link_memb, l);
 
       /* Release the lock before we update the neighbor (will take the lock) */
@@ -348,19 +358,46 @@ tsch_schedule_get_link_by_timeslot(struct tsch_slotframe *slotframe, uint16_t ti
   if(!tsch_is_locked()) {
     if(slotframe != NULL) {
       struct tsch_link *l = list_head(slotframe->links_list);
-      /* Loop over all items. Assume there is max one link per timeslot */
-      while(l != NULL) {
+      /* Loop over the sorted items. Assume there is max one link per timeslot */
+      while(l != NULL && l->timeslot <= timeslot) {
         if(l->timeslot == timeslot) {
           return l;
         }
         l = list_item_next(l);
       }
-      return l;
+      return NULL;
     }
   }
   return NULL;
 }
 /*---------------------------------------------------------------------------*/
+/* Returns the first link of a slotframe after a given timeslot, wrapping
+ * around to the first link of the next slotframe cycle */
+static struct tsch_link *
+slotframe_next_link(struct tsch_slotframe *sf, uint16_t timeslot)
+{
+  struct tsch_link *l;
+
+  /* The cursor follows the ASN forward, start over from the head when
+   * the timeslot went back (new slotframe cycle) or the links changed */
+  if(sf->cursor_valid && timeslot >= sf->cursor_timeslot) {
+    l = sf->cursor;
+  } else {
+    l = list_head(sf->links_list);
+  }
+  while(l != NULL && l->timeslot <= timeslot) {
+    l = list_item_next(l);
+  }
+  sf->cursor = l;
+  sf->cursor_timeslot = timeslot;
+  sf->cursor_valid = 1;
+
+  if(l == NULL) {
+    l = list_head(sf->links_list);
+  }
+  return l;
+}
+/*---------------------------------------------------------------------------*/
 /* Returns the next active link after a given ASN, and a backup link (for the same ASN, with Rx flag) */
 struct tsch_link *
 tsch_schedule_get_next_active_link(struct tsch_asn_t *asn, uint16_t *time_offset,
@@ -374,12 +411,14 @@ tsch_schedule_get_next_active_link(struct tsch_asn_t *asn, uint16_t *time_offset
   must have Rx flag set. */
   if(!tsch_is_locked()) {
     struct tsch_slotframe *sf = list_head(slotframe_list);
-    /* For each slotframe, look for the earliest occurring link */
+    /* For each slotframe, look for the earliest occurring link. There is
+     * at most one link per timeslot in a slotframe, so only the first link
+     * of each slotframe can be the best or tie with it */
     while(sf != NULL) {
       /* Get timeslot from ASN, given the slotframe length */
       uint16_t timeslot = TSCH_ASN_MOD(*asn, sf->size);
-      struct tsch_link *l = list_head(sf->links_list);
-      while(l != NULL) {
+      struct tsch_link *l = slotframe_next_link(sf, timeslot);
+      if(l != NULL) {
         uint16_t time_to_timeslot =
           l->timeslot > timeslot ?
           l->timeslot - timeslot :
@@ -421,8 +460,6 @@ tsch_schedule_get_next_active_link(struct tsch_asn_t *asn, uint16_t *time_offset
             curr_best = new_best;
           }
         }
-
-        l = list_item_next(l);
       }
       sf = list_item_next(sf);
     }
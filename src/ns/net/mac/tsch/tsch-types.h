@@ -89,8 +89,14 @@ struct tsch_slotframe {
   /* Number of timeslots in the slotframe.
    * Stored as struct asn_divisor_t because we often need ASN%size */
   struct tsch_asn_divisor_t size;
-  /* List of links belonging to this slotframe */
+  /* List of links belonging to this slotframe, sorted by timeslot */
   LIST_STRUCT(links_list);
+  /* First link after cursor_timeslot, NULL if there is none before the
+   * end of the slotframe. Only moves forward while the ASN does, so
+   * that finding the next link is O(1) amortized */
+  struct tsch_link *cursor;
+  uint16_t cursor_timeslot;
+  uint8_t cursor_valid;
 };
 
 /** \brief TSCH packet information */
@@ -83,6 +83,19 @@ static unsigned num_tables;
 MEMB(neighbor_addr_mem, nbr_table_key_t, NBR_TABLE_MAX_NEIGHBORS);
 LIST(nbr_table_keys);
 
+#if NBR_TABLE_HASH_SIZE
+#if NBR_TABLE_HASH_SIZE <= NBR_TABLE_MAX_NEIGHBORS
+#error NBR_TABLE_HASH_SIZE must be larger than NBR_TABLE_MAX_NEIGHBORS
+#endif
+#if (NBR_TABLE_HASH_SIZE & (NBR_TABLE_HASH_SIZE - 1)) != 0
+#error NBR_TABLE_HASH_SIZE must be a power of two
+#endif
+#define HASH_MASK (NBR_TABLE_HASH_SIZE - 1)
+/* Open addressing index from link-layer address to neighbor, with linear
+ * probing. A slot holds the neighbor index plus one, 0 is an empty slot. */
+static uint16_t hash_slots[NBR_TABLE_HASH_SIZE];
+#endif /* NBR_TABLE_HASH_SIZE */
+
 /*---------------------------------------------------------------------------*/
 /* Get a key from a neighbor index */
 static nbr_table_key_t *
@@ -126,6 +139,64 @@ key_from_item(nbr_table_t *table, const nbr_table_item_t *item)
   return key_from_index(index_from_item(table, item));
 }
 /*---------------------------------------------------------------------------*/
+#if NBR_TABLE_HASH_SIZE
+/* Home slot of a link-layer address (FNV-1a) */
+static unsigned
+hash_home(const linkaddr_t *lladdr)
+{
+  uint32_t h = 2166136261UL;
+  int i;
+
+  for(i = 0; i < LINKADDR_SIZE; i++) {
+    h = (h ^ lladdr->u8[i]) * 16777619UL;
+  }
+  return (h ^ (h >> 16)) & HASH_MASK;
+}
+/*---------------------------------------------------------------------------*/
+static void
+hash_insert(nbr_table_key_t *key)
+{
+  unsigned i = hash_home(&key->lladdr);
+
+  while(hash_slots[i] != 0) {
+    i = (i + 1) & HASH_MASK;
+  }
+  hash_slots[i] = index_from_key(key) + 1;
+}
+/*---------------------------------------------------------------------------*/
+static void
+hash_remove(nbr_table_key_t *key)
+{
+  unsigned i = hash_home(&key->lladdr);
+  unsigned j, home;
+  uint16_t slot = index_from_key(key) + 1;
+
+  while(hash_slots[i] != slot) {
+    if(hash_slots[i] == 0) {
+      return;
+    }
+    i = (i + 1) & HASH_MASK;
+  }
+
+  /* Shift back the following entries of the probe sequence so that no
+   * lookup stops early on the emptied slot */
+  j = i;
+  while(1) {
+    j = (j + 1) & HASH_MASK;
+    if(hash_slots[j] == 0) {
+      break;
+    }
+    home = hash_home(&key_from_index(hash_slots[j] - 1)->lladdr);
+    /* Move the entry unless its home lies cyclically in (i, j] */
+    if(((j - home) & HASH_MASK) >= ((j - i) & HASH_MASK)) {
+      hash_slots[i] = hash_slots[j];
+      i = j;
+    }
+  }
+  hash_slots[i] = 0;
+}
+#endif /* NBR_TABLE_HASH_SIZE */
+/*---------------------------------------------------------------------------*/
 /* Get the index of a neighbor from its link-layer address */
 static int
 index_from_lladdr(const linkaddr_t *lladdr)
@@ -136,6 +207,19 @@ index_from_lladdr(const linkaddr_t *lladdr)
   if(lladdr == NULL) {
     lladdr = &linkaddr_null;
   }
+#if NBR_TABLE_HASH_SIZE
+  {
+    unsigned i = hash_home(lladdr);
+    while(hash_slots[i] != 0) {
+      key = key_from_index(hash_slots[i] - 1);
+      if(linkaddr_cmp(lladdr, &key->lladdr)) {
+        return hash_slots[i] - 1;
+      }
+      i = (i + 1) & HASH_MASK;
+    }
+    return -1;
+  }
+#endif /* NBR_TABLE_HASH_SIZE */
   key = list_head(nbr_table_keys);
   while(key != NULL) {
     if(lladdr && linkaddr_cmp(lladdr, &key->lladdr)) {
@@ -195,6 +279,9 @@ remove_key(nbr_table_key_t *least_used_key)
   used_map[index_from_key(least_used_key)] = 0;
   /* Remove neighbor from list */
   list_remove(nbr_table_keys, least_used_key);
+#if NBR_TABLE_HASH_SIZE
+  hash_remove(least_used_key);
+#endif /* NBR_TABLE_HASH_SIZE */
 }
 /*---------------------------------------------------------------------------*/
 static nbr_table_key_t *
@@ -377,6 +464,9 @@ nbr_table_add_lladdr(nbr_table_t *table, const linkaddr_t *lladdr, nbr_table_rea
 
     /* Set link-layer address */
     linkaddr_copy(&key->lladdr, lladdr);
+#if NBR_TABLE_HASH_SIZE
+    hash_insert(key);
+#endif /* NBR_TABLE_HASH_SIZE */
   }
 
   /* Get item in the current table */
@@ -392,6 +482,13 @@ nbr_table_add_lladdr(nbr_table_t *table, const linkaddr_t *lladdr, nbr_table_rea
   return item;
 }
 /*---------------------------------------------------------------------------*/
+/* Check whether a link-layer address has an entry, in any table */
+int
+nbr_table_has_lladdr(const linkaddr_t *lladdr)
+{
+  return index_from_lladdr(lladdr) != -1;
+}
+/*---------------------------------------------------------------------------*/
 /* Get an item from its link-layer address */
 void *
 nbr_table_get_from_lladdr(nbr_table_t *table, const linkaddr_t *lladdr)
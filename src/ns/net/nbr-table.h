@@ -46,6 +46,22 @@
 #define NBR_TABLE_MAX_NEIGHBORS 8
 #endif /* NBR_TABLE_CONF_MAX_NEIGHBORS */
 
+/* Number of slots of the hash index from link-layer address to neighbor,
+ * a power of two larger than NBR_TABLE_MAX_NEIGHBORS. With the index,
+ * looking up a neighbor doesn't scan the whole table. 0 disables it.
+ * Defaults to the smallest power of two that is at least twice
+ * NBR_TABLE_MAX_NEIGHBORS, so it follows the table size. */
+#ifdef NBR_TABLE_CONF_HASH_SIZE
+#define NBR_TABLE_HASH_SIZE NBR_TABLE_CONF_HASH_SIZE
+#else /* NBR_TABLE_CONF_HASH_SIZE */
+#define NBR_TABLE_HASH_BITS1 (2 * NBR_TABLE_MAX_NEIGHBORS - 1)
+#define NBR_TABLE_HASH_BITS2 (NBR_TABLE_HASH_BITS1 | (NBR_TABLE_HASH_BITS1 >> 1))
+#define NBR_TABLE_HASH_BITS4 (NBR_TABLE_HASH_BITS2 | (NBR_TABLE_HASH_BITS2 >> 2))
+#define NBR_TABLE_HASH_BITS8 (NBR_TABLE_HASH_BITS4 | (NBR_TABLE_HASH_BITS4 >> 4))
+#define NBR_TABLE_HASH_BITS16 (NBR_TABLE_HASH_BITS8 | (NBR_TABLE_HASH_BITS8 >> 8))
+#define NBR_TABLE_HASH_SIZE (NBR_TABLE_HASH_BITS16 + 1)
+#endif /* NBR_TABLE_CONF_HASH_SIZE */
+
 /* An item in a neighbor table */
 typedef void nbr_table_item_t;
 
@@ -101,6 +117,7 @@ nbr_table_item_t *nbr_table_next(nbr_table_t *table, nbr_table_item_t *item);
 /** @{ */
 nbr_table_item_t *nbr_table_add_lladdr(nbr_table_t *table, const linkaddr_t *lladdr, nbr_table_reason_t reason, void *data);
 nbr_table_item_t *nbr_table_get_from_lladdr(nbr_table_t *table, const linkaddr_t *lladdr);
+int nbr_table_has_lladdr(const linkaddr_t *lladdr);
 /** @} */
 
 /** \name Neighbor tables: set flags (unused, locked, unlocked) */
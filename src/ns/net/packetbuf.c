@@ -54,6 +54,7 @@ struct packetbuf_addr packetbuf_addrs[PACKETBUF_NUM_ADDRS];
 
 static uint16_t buflen, bufptr;
 static uint8_t hdrlen;
+static uint32_t version;
 
 /* The declarations below ensure that the packet buffer is aligned on
    an even 32-bit boundary. On some platforms (most notably the
@@ -76,6 +77,7 @@ packetbuf_clear(void)
 {
   buflen = bufptr = 0;
   hdrlen = 0;
+  version++;
 
   packetbuf_attr_clear();
 }
@@ -98,8 +100,7 @@ packetbuf_copyto(void *to)
   if(hdrlen + buflen > PACKETBUF_SIZE) {
     return 0;
   }
-  memcpy(to, packetbuf_hdrptr(), hdrlen);
-  memcpy((uint8_t *)to + hdrlen, packetbuf_dataptr(), buflen);
+  memcpy(to, packetbuf, hdrlen + buflen);
   return hdrlen + buflen;
 }
 /*---------------------------------------------------------------------------*/
@@ -117,6 +118,7 @@ packetbuf_hdralloc(int size)
     packetbuf[i + size] = packetbuf[i];
   }
   hdrlen += size;
+  version++;
   return 1;
 }
 /*---------------------------------------------------------------------------*/
@@ -129,6 +131,7 @@ packetbuf_hdrreduce(int size)
 
   bufptr += size;
   buflen -= size;
+  version++;
   return 1;
 }
 /*---------------------------------------------------------------------------*/
@@ -137,16 +140,38 @@ packetbuf_set_datalen(uint16_t len)
 {
   PRINTF("packetbuf_set_len: len %d\n", len);
   buflen = len;
+  version++;
+}
+/*---------------------------------------------------------------------------*/
+uint32_t
+packetbuf_version(void)
+{
+  return version;
 }
 /*---------------------------------------------------------------------------*/
 void *
 packetbuf_dataptr(void)
 {
+  /* The caller may write through it */
+  version++;
   return packetbuf + packetbuf_hdrlen();
 }
 /*---------------------------------------------------------------------------*/
 void *
 packetbuf_hdrptr(void)
+{
+  version++;
+  return packetbuf;
+}
+/*---------------------------------------------------------------------------*/
+const void *
+packetbuf_dataptr_const(void)
+{
+  return packetbuf + packetbuf_hdrlen();
+}
+/*---------------------------------------------------------------------------*/
+const void *
+packetbuf_hdrptr_const(void)
 {
   return packetbuf;
 }
@@ -85,6 +85,10 @@ void packetbuf_clear(void);
  *             the packetbuf. The data is either stored in the packetbuf,
  *             or referenced to an external location.
  *
+ *             The pointer may be written through, so getting it bumps
+ *             packetbuf_version(). Code that only reads the data uses
+ *             packetbuf_dataptr_const().
+ *
  */
 void *packetbuf_dataptr(void);
 
@@ -92,9 +96,31 @@ void *packetbuf_dataptr(void);
  * \brief      Get a pointer to the header in the packetbuf, for outbound packets
  * \return     Pointer to the packetbuf header
  *
+ *             The pointer may be written through, so getting it bumps
+ *             packetbuf_version(). Code that only reads the header uses
+ *             packetbuf_hdrptr_const().
+ *
  */
 void *packetbuf_hdrptr(void);
 
+/**
+ * \brief      Get a read-only pointer to the data in the packetbuf
+ * \return     Pointer to the packetbuf data
+ *
+ *             Unlike packetbuf_dataptr(), this leaves
+ *             packetbuf_version() as it is.
+ */
+const void *packetbuf_dataptr_const(void);
+
+/**
+ * \brief      Get a read-only pointer to the header in the packetbuf
+ * \return     Pointer to the packetbuf header
+ *
+ *             Unlike packetbuf_hdrptr(), this leaves
+ *             packetbuf_version() as it is.
+ */
+const void *packetbuf_hdrptr_const(void);
+
 /**
  * \brief      Get the length of the header in the packetbuf
  * \return     Length of the header in the packetbuf
@@ -191,6 +217,22 @@ int packetbuf_hdralloc(int size);
  */
 int packetbuf_hdrreduce(int size);
 
+/**
+ * \brief      Get the version of the packetbuf contents
+ * \return     A number that changes when the packetbuf is cleared or
+ *             filled, when its header or data length changes, or when
+ *             a writable pointer to it is handed out
+ *
+ *             The queuebuf module uses this to tell that the packetbuf
+ *             still holds the bytes of a queued packet, and skips
+ *             copying them again.
+ *
+ *             packetbuf_dataptr() and packetbuf_hdrptr() bump the
+ *             version, as their caller may write through the pointer.
+ *             The _const variants do not.
+ */
+uint32_t packetbuf_version(void);
+
 /* Packet attributes stuff below: */
 
 typedef uint16_t packetbuf_attr_t;
@@ -69,16 +69,33 @@ struct queuebuf {
     int swap_id;
   };
 #endif
+#if QUEUEBUF_SHARED
+  /* Attributes are per queuebuf, the data may be shared */
+  struct packetbuf_attr attrs[PACKETBUF_NUM_ATTRS];
+  struct packetbuf_addr addrs[PACKETBUF_NUM_ADDRS];
+#endif /* QUEUEBUF_SHARED */
 };
 
 /* The actual queuebuf data */
 struct queuebuf_data {
   uint8_t data[PACKETBUF_SIZE];
   uint16_t len;
+#if QUEUEBUF_SHARED
+  uint8_t refcount;
+#else /* QUEUEBUF_SHARED */
   struct packetbuf_attr attrs[PACKETBUF_NUM_ATTRS];
   struct packetbuf_addr addrs[PACKETBUF_NUM_ADDRS];
+#endif /* QUEUEBUF_SHARED */
 };
 
+#if QUEUEBUF_SHARED
+#define QUEUEBUF_ATTRS(b, d) ((void)(d), (b)->attrs)
+#define QUEUEBUF_ADDRS(b, d) ((void)(d), (b)->addrs)
+#else /* QUEUEBUF_SHARED */
+#define QUEUEBUF_ATTRS(b, d) ((d)->attrs)
+#define QUEUEBUF_ADDRS(b, d) ((d)->addrs)
+#endif /* QUEUEBUF_SHARED */
+
 MEMB(bufmem, struct queuebuf, QUEUEBUF_NUM);
 MEMB(buframmem, struct queuebuf_data, QUEUEBUFRAM_NUM);
 
@@ -125,16 +142,23 @@ LIST(queuebuf_list);
 #define PRINTF(...)
 #endif
 
-#ifdef QUEUEBUF_CONF_STATS
-#define QUEUEBUF_STATS QUEUEBUF_CONF_STATS
-#else
-#define QUEUEBUF_STATS 0
-#endif /* QUEUEBUF_CONF_STATS */
-
 #if QUEUEBUF_STATS
 uint8_t queuebuf_len, queuebuf_max_len;
+unsigned long queuebuf_bytes_copied;
+unsigned long queuebuf_bytes_shared;
+unsigned long queuebuf_num_freed;
+#define STATS_ADD(var, n) ((var) += (n))
+#else /* QUEUEBUF_STATS */
+#define STATS_ADD(var, n)
 #endif /* QUEUEBUF_STATS */
 
+#if QUEUEBUF_SHARED
+/* The queuebuf data that the packetbuf holds a copy of, valid as long
+   as the packetbuf version did not change */
+static struct queuebuf_data *shadow;
+static uint32_t shadow_version;
+#endif /* QUEUEBUF_SHARED */
+
 #if WITH_SWAP
 /*---------------------------------------------------------------------------*/
 static void
@@ -276,6 +300,53 @@ queuebuf_load_to_ram(struct queuebuf *b)
   return b->ram_ptr;
 }
 #endif /* WITH_SWAP */
+#if QUEUEBUF_SHARED
+/*---------------------------------------------------------------------------*/
+/* Remember that the packetbuf now holds the bytes of d */
+static void
+shadow_set(struct queuebuf_data *d)
+{
+  if(packetbuf_hdrlen() == 0) {
+    shadow = d;
+    shadow_version = packetbuf_version();
+  } else {
+    shadow = NULL;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static int
+shadow_valid(void)
+{
+  return shadow != NULL && shadow_version == packetbuf_version();
+}
+/*---------------------------------------------------------------------------*/
+/* Give b its own copy of the data before it is written to */
+static struct queuebuf_data *
+queuebuf_unshare(struct queuebuf *b)
+{
+  struct queuebuf_data *d = b->ram_ptr;
+  struct queuebuf_data *copy;
+
+  if(shadow == d) {
+    shadow = NULL;
+  }
+  if(d->refcount == 1) {
+    return d;
+  }
+  copy = memb_alloc(&buframmem);
+  if(copy == NULL) {
+    PRINTF("queuebuf_unshare: could not allocate queuebuf data\n");
+    return NULL;
+  }
+  memcpy(copy->data, d->data, d->len);
+  copy->len = d->len;
+  copy->refcount = 1;
+  STATS_ADD(queuebuf_bytes_copied, d->len);
+  d->refcount--;
+  b->ram_ptr = copy;
+  return copy;
+}
+#endif /* QUEUEBUF_SHARED */
 /*---------------------------------------------------------------------------*/
 void
 queuebuf_init(void)
@@ -292,6 +363,9 @@ queuebuf_init(void)
 #if QUEUEBUF_STATS
   queuebuf_max_len = 0;
 #endif /* QUEUEBUF_STATS */
+#if QUEUEBUF_SHARED
+  shadow = NULL;
+#endif /* QUEUEBUF_SHARED */
 }
 /*---------------------------------------------------------------------------*/
 int
@@ -319,6 +393,17 @@ queuebuf_new_from_packetbuf(void)
     buf->line = line;
     buf->time = clock_time();
 #endif /* QUEUEBUF_DEBUG */
+#if QUEUEBUF_SHARED
+    if(shadow_valid()) {
+      /* The packetbuf was not touched since it was copied to or from
+         another queuebuf, share its bytes */
+      buf->ram_ptr = shadow;
+      shadow->refcount++;
+      STATS_ADD(queuebuf_bytes_shared, shadow->len);
+      packetbuf_attr_copyto(buf->attrs, buf->addrs);
+      goto allocated;
+    }
+#endif /* QUEUEBUF_SHARED */
     buf->ram_ptr = memb_alloc(&buframmem);
 #if WITH_SWAP
     /* If the allocation failed, store the qbuf in swap files */
@@ -341,7 +426,13 @@ queuebuf_new_from_packetbuf(void)
 #endif
 
     buframptr->len = packetbuf_copyto(buframptr->data);
-    packetbuf_attr_copyto(buframptr->attrs, buframptr->addrs);
+    packetbuf_attr_copyto(QUEUEBUF_ATTRS(buf, buframptr),
+                          QUEUEBUF_ADDRS(buf, buframptr));
+    STATS_ADD(queuebuf_bytes_copied, buframptr->len);
+#if QUEUEBUF_SHARED
+    buframptr->refcount = 1;
+    shadow_set(buframptr);
+#endif /* QUEUEBUF_SHARED */
 
 #if WITH_SWAP
     if(buf->location == IN_CFS) {
@@ -353,6 +444,9 @@ queuebuf_new_from_packetbuf(void)
     }
 #endif
 
+#if QUEUEBUF_SHARED
+  allocated:
+#endif /* QUEUEBUF_SHARED */
 #if QUEUEBUF_STATS
     ++queuebuf_len;
     PRINTF("#A q=%d\n", queuebuf_len);
@@ -371,7 +465,8 @@ void
 queuebuf_update_attr_from_packetbuf(struct queuebuf *buf)
 {
   struct queuebuf_data *buframptr = queuebuf_load_to_ram(buf);
-  packetbuf_attr_copyto(buframptr->attrs, buframptr->addrs);
+  packetbuf_attr_copyto(QUEUEBUF_ATTRS(buf, buframptr),
+                        QUEUEBUF_ADDRS(buf, buframptr));
 #if WITH_SWAP
   if(buf->location == IN_CFS) {
     queuebuf_flush_tmpdata();
@@ -382,9 +477,21 @@ queuebuf_update_attr_from_packetbuf(struct queuebuf *buf)
 void
 queuebuf_update_from_packetbuf(struct queuebuf *buf)
 {
+#if QUEUEBUF_SHARED
+  struct queuebuf_data *buframptr = queuebuf_unshare(buf);
+  if(buframptr == NULL) {
+    return;
+  }
+#else /* QUEUEBUF_SHARED */
   struct queuebuf_data *buframptr = queuebuf_load_to_ram(buf);
-  packetbuf_attr_copyto(buframptr->attrs, buframptr->addrs);
+#endif /* QUEUEBUF_SHARED */
+  packetbuf_attr_copyto(QUEUEBUF_ATTRS(buf, buframptr),
+                        QUEUEBUF_ADDRS(buf, buframptr));
   buframptr->len = packetbuf_copyto(buframptr->data);
+  STATS_ADD(queuebuf_bytes_copied, buframptr->len);
+#if QUEUEBUF_SHARED
+  shadow_set(buframptr);
+#endif /* QUEUEBUF_SHARED */
 #if WITH_SWAP
   if(buf->location == IN_CFS) {
     queuebuf_flush_tmpdata();
@@ -402,11 +509,19 @@ queuebuf_free(struct queuebuf *buf)
     } else {
       queuebuf_remove_from_file(buf->swap_id);
     }
+#elif QUEUEBUF_SHARED
+    if(--buf->ram_ptr->refcount == 0) {
+      if(shadow == buf->ram_ptr) {
+        shadow = NULL;
+      }
+      memb_free(&buframmem, buf->ram_ptr);
+    }
 #else
     memb_free(&buframmem, buf->ram_ptr);
 #endif
     memb_free(&bufmem, buf);
 #if QUEUEBUF_STATS
+    ++queuebuf_num_freed;
     --queuebuf_len;
     PRINTF("#A q=%d\n", queuebuf_len);
 #endif /* QUEUEBUF_STATS */
@@ -421,8 +536,21 @@ queuebuf_to_packetbuf(struct queuebuf *b)
 {
   if(memb_inmemb(&bufmem, b)) {
     struct queuebuf_data *buframptr = queuebuf_load_to_ram(b);
+#if QUEUEBUF_SHARED
+    if(shadow == buframptr && shadow_valid()) {
+      /* The packetbuf still holds these bytes */
+      STATS_ADD(queuebuf_bytes_shared, buframptr->len);
+    } else {
+      packetbuf_copyfrom(buframptr->data, buframptr->len);
+      STATS_ADD(queuebuf_bytes_copied, buframptr->len);
+      shadow_set(buframptr);
+    }
+#else /* QUEUEBUF_SHARED */
     packetbuf_copyfrom(buframptr->data, buframptr->len);
-    packetbuf_attr_copyfrom(buframptr->attrs, buframptr->addrs);
+    STATS_ADD(queuebuf_bytes_copied, buframptr->len);
+#endif /* QUEUEBUF_SHARED */
+    packetbuf_attr_copyfrom(QUEUEBUF_ATTRS(b, buframptr),
+                            QUEUEBUF_ADDRS(b, buframptr));
   }
 }
 /*---------------------------------------------------------------------------*/
@@ -430,8 +558,14 @@ void *
 queuebuf_dataptr(struct queuebuf *b)
 {
   if(memb_inmemb(&bufmem, b)) {
+#if QUEUEBUF_SHARED
+    /* The caller may write to the data */
+    struct queuebuf_data *buframptr = queuebuf_unshare(b);
+    return buframptr != NULL ? buframptr->data : NULL;
+#else /* QUEUEBUF_SHARED */
     struct queuebuf_data *buframptr = queuebuf_load_to_ram(b);
     return buframptr->data;
+#endif /* QUEUEBUF_SHARED */
   }
   return NULL;
 }
@@ -447,14 +581,14 @@ linkaddr_t *
 queuebuf_addr(struct queuebuf *b, uint8_t type)
 {
   struct queuebuf_data *buframptr = queuebuf_load_to_ram(b);
-  return &buframptr->addrs[type - PACKETBUF_ADDR_FIRST].addr;
+  return &QUEUEBUF_ADDRS(b, buframptr)[type - PACKETBUF_ADDR_FIRST].addr;
 }
 /*---------------------------------------------------------------------------*/
 packetbuf_attr_t
 queuebuf_attr(struct queuebuf *b, uint8_t type)
 {
   struct queuebuf_data *buframptr = queuebuf_load_to_ram(b);
-  return buframptr->attrs[type].val;
+  return QUEUEBUF_ATTRS(b, buframptr)[type].val;
 }
 /*---------------------------------------------------------------------------*/
 void
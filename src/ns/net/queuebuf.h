@@ -85,6 +85,30 @@
 #define QUEUEBUF_DEBUG 0
 #endif /* QUEUEBUF_CONF_DEBUG */
 
+/* QUEUEBUF_CONF_SHARED lets queuebufs share the packet bytes with each
+   other and with the packetbuf. The bytes are reference counted and
+   copied when a holder writes to them. Not available with swapping. */
+#if defined(QUEUEBUF_CONF_SHARED) && !WITH_SWAP
+#define QUEUEBUF_SHARED QUEUEBUF_CONF_SHARED
+#else
+#define QUEUEBUF_SHARED 0
+#endif
+
+#ifdef QUEUEBUF_CONF_STATS
+#define QUEUEBUF_STATS QUEUEBUF_CONF_STATS
+#else
+#define QUEUEBUF_STATS 0
+#endif /* QUEUEBUF_CONF_STATS */
+
+#if QUEUEBUF_STATS
+/* Packet bytes copied between the packetbuf and queuebufs */
+extern unsigned long queuebuf_bytes_copied;
+/* Packet bytes that were shared instead of copied */
+extern unsigned long queuebuf_bytes_shared;
+/* Number of queuebufs freed, i.e. of packets done with */
+extern unsigned long queuebuf_num_freed;
+#endif /* QUEUEBUF_STATS */
+
 struct queuebuf;
 
 void queuebuf_init(void);
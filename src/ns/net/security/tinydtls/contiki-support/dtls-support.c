@@ -55,6 +55,15 @@ dtls_session_equals(const session_t *a, const session_t *b)
     && uip_ipaddr_cmp(&((a)->addr),&(b->addr));
 }
 /*---------------------------------------------------------------------------*/
+uint32_t
+dtls_session_hash(const session_t *a)
+{
+  uint32_t h;
+
+  h = dtls_session_hash_update(DTLS_SESSION_HASH_INIT, &a->port, sizeof(a->port));
+  return dtls_session_hash_update(h, &a->addr, sizeof(a->addr));
+}
+/*---------------------------------------------------------------------------*/
 void *
 dtls_session_get_address(const session_t *a)
 {
@@ -31,6 +31,31 @@ void dtls_session_init(session_t *sess);
  */
 int dtls_session_equals(const session_t *a, const session_t *b);
 
+/**
+ * Returns a hash of the address and port of the given session, used
+ * to index the peer table. Sessions that dtls_session_equals() finds
+ * equal must return the same hash.
+ */
+uint32_t dtls_session_hash(const session_t *a);
+
+/** Initial value for dtls_session_hash_update(). */
+#define DTLS_SESSION_HASH_INIT 2166136261UL
+
+/**
+ * Feeds @p len bytes from @p data into the FNV-1a hash @p h and
+ * returns the updated hash.
+ */
+static inline uint32_t
+dtls_session_hash_update(uint32_t h, const void *data, size_t len)
+{
+  const uint8_t *p = data;
+
+  while(len--) {
+    h = (h ^ *p++) * 16777619UL;
+  }
+  return h;
+}
+
 /**
  * Get the address information for this session as an opaque (void *)
  */
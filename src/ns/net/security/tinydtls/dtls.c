@@ -83,15 +83,22 @@ add_peer(dtls_peer_t **peers, dtls_peer_t *peer)
   *peers = peer;
 }
 
+/** Returns the bucket of the peer table that holds @p session. */
+#define PEER_BUCKET(Ctx, Session) \
+  ((Ctx)->peers[dtls_session_hash(Session) % DTLS_PEER_HASH_SIZE])
+
 #define DTLS_RH_LENGTH sizeof(dtls_record_header_t)
 #define DTLS_HS_LENGTH sizeof(dtls_handshake_header_t)
 #define DTLS_CH_LENGTH sizeof(dtls_client_hello_t) /* no variable length fields! */
 #define DTLS_COOKIE_LENGTH_MAX 32
-#define DTLS_CH_LENGTH_MAX sizeof(dtls_client_hello_t) + DTLS_COOKIE_LENGTH_MAX + 12 + 26
+#define DTLS_CH_LENGTH_MAX sizeof(dtls_client_hello_t) + DTLS_SESSION_ID_LENGTH + DTLS_COOKIE_LENGTH_MAX + 12 + 26
 #define DTLS_HV_LENGTH sizeof(dtls_hello_verify_t)
 #define DTLS_SH_LENGTH (2 + DTLS_RANDOM_LENGTH + 1 + 2 + 1)
 #define DTLS_CE_LENGTH (3 + 3 + 27 + DTLS_EC_KEY_SIZE + DTLS_EC_KEY_SIZE)
 #define DTLS_SKEXEC_LENGTH (1 + 2 + 1 + 1 + DTLS_EC_KEY_SIZE + DTLS_EC_KEY_SIZE + 1 + 1 + 2 + 70)
+/* signature with DER integers r and s of a single byte each */
+#define DTLS_EC_SIG_LENGTH_MIN (1 + 1 + 2 + 1 + 1 + 1 + 1 + 1 + 1 + 1 + 1)
+#define DTLS_SKEXEC_LENGTH_MIN (1 + 2 + 1 + 1 + DTLS_EC_KEY_SIZE + DTLS_EC_KEY_SIZE + DTLS_EC_SIG_LENGTH_MIN)
 #define DTLS_SKEXECPSK_LENGTH_MIN 2
 #define DTLS_SKEXECPSK_LENGTH_MAX 2 + DTLS_PSK_MAX_CLIENT_IDENTITY_LEN
 #define DTLS_CKXPSK_LENGTH_MIN 2
@@ -202,7 +209,7 @@ dtls_peer_t *
 dtls_get_peer(const dtls_context_t *ctx, const session_t *session) {
   dtls_peer_t *p;
   if(ctx && session) {
-    p = ctx->peers;
+    p = PEER_BUCKET(ctx, session);
     while(p) {
       if (dtls_session_equals(&(p->session), session)) {
         return p;
@@ -221,11 +228,136 @@ dtls_get_peer(const dtls_context_t *ctx, const session_t *session) {
 static int
 dtls_add_peer(dtls_context_t *ctx, dtls_peer_t *peer) {
   if(peer) {
-    add_peer(&ctx->peers, peer);
+    add_peer(&PEER_BUCKET(ctx, &peer->session), peer);
   }
   return 0;
 }
 
+#if DTLS_SESSION_CACHE_MAX > 0
+static int
+session_expired(const dtls_cached_session_t *s, dtls_tick_t now) {
+  return now - s->created >
+    (dtls_tick_t)DTLS_SESSION_CACHE_LIFETIME * DTLS_TICKS_PER_SECOND;
+}
+
+/**
+ * Returns the cached session with the given @p id, or @c NULL when
+ * the session is unknown or has expired.
+ */
+static dtls_cached_session_t *
+dtls_find_session_by_id(dtls_context_t *ctx,
+			const uint8_t *id, size_t id_length) {
+  dtls_cached_session_t *s;
+  dtls_tick_t now;
+
+  if (id_length == 0) {
+    return NULL;
+  }
+
+  dtls_ticks(&now);
+  for (s = ctx->sessions; s < ctx->sessions + DTLS_SESSION_CACHE_MAX; s++) {
+    if (s->id_length == id_length && memcmp(s->id, id, id_length) == 0) {
+      return session_expired(s, now) ? NULL : s;
+    }
+  }
+  return NULL;
+}
+
+/**
+ * Returns the cached session with the remote party @p session, or
+ * @c NULL when there is none or it has expired.
+ */
+static dtls_cached_session_t *
+dtls_find_session_by_peer(dtls_context_t *ctx, const session_t *session) {
+  dtls_cached_session_t *s;
+  dtls_tick_t now;
+
+  dtls_ticks(&now);
+  for (s = ctx->sessions; s < ctx->sessions + DTLS_SESSION_CACHE_MAX; s++) {
+    if (s->id_length && dtls_session_equals(&s->session, session)) {
+      return session_expired(s, now) ? NULL : s;
+    }
+  }
+  return NULL;
+}
+
+/**
+ * Stores the session that has just been negotiated with @p peer. A
+ * previous session with the same remote party or id is replaced,
+ * otherwise the least recently used entry is evicted. A resumed
+ * session keeps its entry and the time of the full handshake that
+ * negotiated it, so that resuming does not extend its lifetime.
+ */
+static void
+dtls_cache_session(dtls_context_t *ctx, dtls_peer_t *peer) {
+  dtls_handshake_parameters_t *handshake = peer->handshake_params;
+  dtls_cached_session_t *s, *slot = NULL;
+  dtls_tick_t now;
+
+  if (handshake->session_id_length == 0) {
+    /* the server does not support resumption */
+    return;
+  }
+
+  dtls_ticks(&now);
+  if (handshake->resumed) {
+    s = dtls_find_session_by_id(ctx, handshake->session_id,
+				handshake->session_id_length);
+    if (s) {
+      memcpy(&s->session, &peer->session, sizeof(session_t));
+      s->last_used = now;
+    }
+    return;
+  }
+
+  for (s = ctx->sessions; s < ctx->sessions + DTLS_SESSION_CACHE_MAX; s++) {
+    if (s->id_length == 0) {
+      if (!slot || slot->id_length) {
+        slot = s;
+      }
+    } else if (dtls_session_equals(&s->session, &peer->session) ||
+	       (s->id_length == handshake->session_id_length &&
+		memcmp(s->id, handshake->session_id, s->id_length) == 0)) {
+      slot = s;
+      break;
+    } else if (!slot || (slot->id_length &&
+			 now - s->last_used > now - slot->last_used)) {
+      slot = s;
+    }
+  }
+
+  memcpy(&slot->session, &peer->session, sizeof(session_t));
+  slot->created = now;
+  slot->last_used = now;
+  slot->cipher = handshake->cipher;
+  slot->compression = handshake->compression;
+  slot->id_length = handshake->session_id_length;
+  memcpy(slot->id, handshake->session_id, handshake->session_id_length);
+  memcpy(slot->master_secret, handshake->tmp.master_secret,
+	 DTLS_MASTER_SECRET_LENGTH);
+}
+
+/**
+ * Removes the session with the remote party @p session from the
+ * cache. Sessions that ended with a fatal alert must not be resumed.
+ */
+static void
+dtls_uncache_session(dtls_context_t *ctx, const session_t *session) {
+  dtls_cached_session_t *s;
+
+  for (s = ctx->sessions; s < ctx->sessions + DTLS_SESSION_CACHE_MAX; s++) {
+    if (s->id_length && dtls_session_equals(&s->session, session)) {
+      memset(s, 0, sizeof(dtls_cached_session_t));
+    }
+  }
+}
+#else /* DTLS_SESSION_CACHE_MAX > 0 */
+#define dtls_find_session_by_id(Ctx, Id, Length) ((dtls_cached_session_t *)NULL)
+#define dtls_find_session_by_peer(Ctx, Session) ((dtls_cached_session_t *)NULL)
+#define dtls_cache_session(Ctx, Peer)
+#define dtls_uncache_session(Ctx, Session)
+#endif /* DTLS_SESSION_CACHE_MAX > 0 */
+
 int
 dtls_write(struct dtls_context_t *ctx, 
 	   session_t *dst, uint8_t *buf, size_t len) {
@@ -554,6 +686,17 @@ hs_attempt_with_existing_peer(uint8_t *msg, size_t msglen,
     }
     return 0;
 }
+/**
+ * Returns true if @p peer sends the second Finished message of the
+ * handshake: the server in a full handshake, the client when a
+ * session is resumed.
+ */
+static inline int
+sends_last_finished(const dtls_peer_t *peer)
+{
+  return (peer->role == DTLS_SERVER) != peer->handshake_params->resumed;
+}
+
 /** Dump out the cipher keys and IVs used for the symetric cipher. */
 static inline void
 dtls_debug_keyblock(dtls_security_parameters_t *config, dtls_peer_t *peer)
@@ -625,6 +768,37 @@ static char *dtls_handshake_type_to_name(int type)
 /**
  * Calculate the pre master secret and after that calculate the master-secret.
  */
+/**
+ * Expands @p master_secret and the random values of @p handshake into
+ * the key block of @p security. The master secret is kept in @p
+ * handshake for the Finished messages and replaces the random values.
+ */
+static void
+derive_key_block(dtls_handshake_parameters_t *handshake,
+		 dtls_security_parameters_t *security,
+		 dtls_peer_t *peer,
+		 const uint8_t *master_secret,
+		 dtls_peer_type role) {
+  /* create key_block from master_secret
+   * key_block = PRF(master_secret,
+                    "key expansion" + tmp.random.server + tmp.random.client) */
+
+  dtls_prf(master_secret,
+	   DTLS_MASTER_SECRET_LENGTH,
+	   PRF_LABEL(key), PRF_LABEL_SIZE(key),
+	   handshake->tmp.random.server, DTLS_RANDOM_LENGTH,
+	   handshake->tmp.random.client, DTLS_RANDOM_LENGTH,
+	   security->key_block,
+	   dtls_kb_size(security, role));
+
+  memcpy(handshake->tmp.master_secret, master_secret, DTLS_MASTER_SECRET_LENGTH);
+  dtls_debug_keyblock(security, peer);
+
+  security->cipher = handshake->cipher;
+  security->compression = handshake->compression;
+  security->rseq = 0;
+}
+
 static int
 calculate_key_block(dtls_context_t *ctx, 
 		    dtls_handshake_parameters_t *handshake,
@@ -709,24 +883,29 @@ calculate_key_block(dtls_context_t *ctx,
 
   dtls_debug_dump("master_secret", master_secret, DTLS_MASTER_SECRET_LENGTH);
 
-  /* create key_block from master_secret
-   * key_block = PRF(master_secret,
-                    "key expansion" + tmp.random.server + tmp.random.client) */
+  derive_key_block(handshake, security, peer, master_secret, role);
 
-  dtls_prf(master_secret,
-	   DTLS_MASTER_SECRET_LENGTH,
-	   PRF_LABEL(key), PRF_LABEL_SIZE(key),
-	   handshake->tmp.random.server, DTLS_RANDOM_LENGTH,
-	   handshake->tmp.random.client, DTLS_RANDOM_LENGTH,
-	   security->key_block,
-	   dtls_kb_size(security, role));
+  return 0;
+}
 
-  memcpy(handshake->tmp.master_secret, master_secret, DTLS_MASTER_SECRET_LENGTH);
-  dtls_debug_keyblock(security, peer);
+/**
+ * Calculates the key block for an abbreviated handshake from the
+ * master secret of the @p cached session.
+ */
+static int
+resume_key_block(dtls_handshake_parameters_t *handshake,
+		 dtls_peer_t *peer,
+		 const dtls_cached_session_t *cached) {
+  dtls_security_parameters_t *security;
 
-  security->cipher = handshake->cipher;
-  security->compression = handshake->compression;
-  security->rseq = 0;
+  security = dtls_security_params_next(peer);
+  if (!security) {
+    return dtls_alert_fatal_create(DTLS_ALERT_INTERNAL_ERROR);
+  }
+
+  handshake->cipher = cached->cipher;
+  handshake->compression = cached->compression;
+  derive_key_block(handshake, security, peer, cached->master_secret, peer->role);
 
   return 0;
 }
@@ -966,8 +1145,16 @@ dtls_update_parameters(dtls_context_t *ctx,
   data += DTLS_RANDOM_LENGTH;
   data_length -= DTLS_RANDOM_LENGTH;
 
+  /* keep the session id that the client wants to resume */
+  i = dtls_uint8_to_int(data);
+  if (i > DTLS_SESSION_ID_LENGTH)
+    goto error;
+
   /* Caution: SKIP_VAR_FIELD may jump to error: */
   SKIP_VAR_FIELD(data, data_length);	/* skip session id */
+  config->session_id_length = i;
+  memcpy(config->session_id, data - i, i);
+
   SKIP_VAR_FIELD(data, data_length);	/* skip cookie */
 
   i = dtls_uint16_to_int(data);
@@ -1570,7 +1757,7 @@ static void dtls_destroy_peer(dtls_context_t *ctx, dtls_peer_t *peer, int unlink
   if (peer->state != DTLS_STATE_CLOSED && peer->state != DTLS_STATE_CLOSING)
     dtls_close(ctx, &peer->session);
   if (unlink) {
-    delete_peer(&ctx->peers, peer);
+    delete_peer(&PEER_BUCKET(ctx, &peer->session), peer);
     dtls_debug_session("removed peer", &peer->session);
   }
   dtls_free_peer(peer);
@@ -1666,10 +1853,30 @@ dtls_verify_peer(dtls_context_t *ctx,
 }
 
 #ifdef DTLS_ECC
+/**
+ * Copies the ASN.1 integer of length \p len at \p data right-aligned
+ * into the DTLS_EC_KEY_SIZE bytes at \p result. DER integers are
+ * minimal, so they may be shorter than the key or carry a leading 0.
+ */
+static int
+dtls_ec_integer_to_key(const uint8_t *data, size_t len, unsigned char *result)
+{
+  while (len > DTLS_EC_KEY_SIZE && *data == 0) {
+    data++;
+    len--;
+  }
+  if (len > DTLS_EC_KEY_SIZE)
+    return dtls_alert_fatal_create(DTLS_ALERT_DECODE_ERROR);
+
+  memset(result, 0, DTLS_EC_KEY_SIZE - len);
+  memcpy(result + DTLS_EC_KEY_SIZE - len, data, len);
+  return 0;
+}
+
 static int
 dtls_check_ecdsa_signature_elem(uint8_t *data, size_t data_length,
-				unsigned char **result_r,
-				unsigned char **result_s)
+				unsigned char *result_r,
+				unsigned char *result_s)
 {
   int i;
   uint8_t *data_orig = data;
@@ -1720,13 +1927,16 @@ dtls_check_ecdsa_signature_elem(uint8_t *data, size_t data_length,
   data += sizeof(uint8_t);
   data_length -= sizeof(uint8_t);
 
-  /* Sometimes these values have a leeding 0 byte */
-  *result_r = data + i - DTLS_EC_KEY_SIZE;
+  if (data_length < (size_t)i ||
+      dtls_ec_integer_to_key(data, i, result_r) < 0) {
+    dtls_alert("signature length wrong\n");
+    return dtls_alert_fatal_create(DTLS_ALERT_DECODE_ERROR);
+  }
 
   data += i;
   data_length -= i;
 
-  if (dtls_uint8_to_int(data) != 0x02) {
+  if (data_length < 2 * sizeof(uint8_t) || dtls_uint8_to_int(data) != 0x02) {
     dtls_alert("wrong ASN.1 struct, expected Integer\n");
     return dtls_alert_fatal_create(DTLS_ALERT_DECODE_ERROR);
   }
@@ -1737,8 +1947,11 @@ dtls_check_ecdsa_signature_elem(uint8_t *data, size_t data_length,
   data += sizeof(uint8_t);
   data_length -= sizeof(uint8_t);
 
-  /* Sometimes these values have a leeding 0 byte */
-  *result_s = data + i - DTLS_EC_KEY_SIZE;
+  if (data_length < (size_t)i ||
+      dtls_ec_integer_to_key(data, i, result_s) < 0) {
+    dtls_alert("signature length wrong\n");
+    return dtls_alert_fatal_create(DTLS_ALERT_DECODE_ERROR);
+  }
 
   data += i;
   data_length -= i;
@@ -1752,8 +1965,8 @@ check_client_certificate_verify(dtls_context_t *ctx,
 				uint8_t *data, size_t data_length)
 {
   int ret;
-  unsigned char *result_r;
-  unsigned char *result_s;
+  unsigned char result_r[DTLS_EC_KEY_SIZE];
+  unsigned char result_s[DTLS_EC_KEY_SIZE];
   dtls_hash_ctx hs_hash;
   unsigned char sha256hash[DTLS_HMAC_DIGEST_SIZE];
   dtls_handshake_parameters_t *config;
@@ -1767,12 +1980,13 @@ check_client_certificate_verify(dtls_context_t *ctx,
 
   data += DTLS_HS_LENGTH;
 
-  if (data_length < DTLS_HS_LENGTH + DTLS_CV_LENGTH) {
+  if (data_length < DTLS_HS_LENGTH + DTLS_EC_SIG_LENGTH_MIN) {
     dtls_alert("the packet length does not match the expected\n");
     return dtls_alert_fatal_create(DTLS_ALERT_DECODE_ERROR);
   }
+  data_length -= DTLS_HS_LENGTH;
 
-  ret = dtls_check_ecdsa_signature_elem(data, data_length, &result_r, &result_s);
+  ret = dtls_check_ecdsa_signature_elem(data, data_length, result_r, result_s);
   if (ret < 0) {
     return ret;
   }
@@ -1802,7 +2016,7 @@ dtls_send_server_hello(dtls_context_t *ctx, dtls_peer_t *peer)
   /* Ensure that the largest message to create fits in our source
    * buffer. (The size of the destination buffer is checked by the
    * encoding function, so we do not need to guess.) */
-  uint8_t buf[DTLS_SH_LENGTH + 2 + 5 + 5 + 8 + 6];
+  uint8_t buf[DTLS_SH_LENGTH + DTLS_SESSION_ID_LENGTH + 2 + 5 + 5 + 8 + 6];
   uint8_t *p;
   int ecdsa;
   uint8_t extension_size;
@@ -1835,7 +2049,10 @@ dtls_send_server_hello(dtls_context_t *ctx, dtls_peer_t *peer)
   memcpy(p, handshake->tmp.random.server, DTLS_RANDOM_LENGTH);
   p += DTLS_RANDOM_LENGTH;
 
-  *p++ = 0;			/* no session id */
+  /* session id, empty when sessions are not cached */
+  *p++ = handshake->session_id_length;
+  memcpy(p, handshake->session_id, handshake->session_id_length);
+  p += handshake->session_id_length;
 
   if (handshake->cipher != TLS_NULL_WITH_NULL_NULL) {
     /* selected cipher suite */
@@ -2144,11 +2361,39 @@ dtls_send_server_hello_done(dtls_context_t *ctx, dtls_peer_t *peer)
 				 NULL, 0);
 }
 
+static inline int dtls_send_ccs(dtls_context_t *ctx, dtls_peer_t *peer);
+static int dtls_send_finished(dtls_context_t *ctx, dtls_peer_t *peer,
+			      const unsigned char *label, size_t labellen);
+
 static int
 dtls_send_server_hello_msgs(dtls_context_t *ctx, dtls_peer_t *peer)
 {
+  dtls_handshake_parameters_t *handshake;
+  dtls_cached_session_t *cached;
   int res;
 
+  if(!peer || !peer->handshake_params) {
+    return dtls_alert_fatal_create(DTLS_ALERT_INTERNAL_ERROR);
+  }
+  handshake = peer->handshake_params;
+
+  /* Resume the session offered by the client when it is still cached
+   * and the client offers its cipher suite again. Otherwise, issue a
+   * new session id for the full handshake. */
+  cached = dtls_find_session_by_id(ctx, handshake->session_id,
+				   handshake->session_id_length);
+  if (cached && cached->cipher == handshake->cipher &&
+      cached->compression == handshake->compression) {
+    dtls_debug("resuming session\n");
+    handshake->resumed = 1;
+  } else {
+    handshake->session_id_length = 0;
+#if DTLS_SESSION_CACHE_MAX > 0
+    if (dtls_fill_random(handshake->session_id, DTLS_SESSION_ID_LENGTH))
+      handshake->session_id_length = DTLS_SESSION_ID_LENGTH;
+#endif /* DTLS_SESSION_CACHE_MAX > 0 */
+  }
+
   res = dtls_send_server_hello(ctx, peer);
 
   if (res < 0) {
@@ -2156,8 +2401,28 @@ dtls_send_server_hello_msgs(dtls_context_t *ctx, dtls_peer_t *peer)
     return res;
   }
 
-  if(!peer || !peer->handshake_params) {
-    return dtls_alert_fatal_create(DTLS_ALERT_INTERNAL_ERROR);
+  if (handshake->resumed) {
+    /* Abbreviated handshake: no key exchange, the keys are derived
+     * from the cached master secret and we finish first. */
+    res = resume_key_block(handshake, peer, cached);
+    if (res < 0) {
+      return res;
+    }
+
+    res = dtls_send_ccs(ctx, peer);
+    if (res < 0) {
+      dtls_debug("dtls_server_hello: cannot send CCS message\n");
+      return res;
+    }
+
+    dtls_security_params_switch(peer);
+
+    res = dtls_send_finished(ctx, peer, PRF_LABEL(server), PRF_LABEL_SIZE(server));
+    if (res < 0) {
+      dtls_debug("dtls_server_hello: cannot prepare Finished record\n");
+      return res;
+    }
+    return 0;
   }
 
 #ifdef DTLS_ECC
@@ -2432,20 +2697,34 @@ dtls_send_client_hello(dtls_context_t *ctx, dtls_peer_t *peer,
   }
 
   if (cookie_length == 0) {
+    dtls_cached_session_t *cached = NULL;
+
     /* Set client random: First 4 bytes are the client's Unix timestamp,
      * followed by 28 bytes of generate random data. */
     dtls_ticks(&now);
     dtls_int_to_uint32(handshake->tmp.random.client, now / DTLS_TICKS_PER_SECOND);
     dtls_fill_random(handshake->tmp.random.client + sizeof(uint32_t),
          DTLS_RANDOM_LENGTH - sizeof(uint32_t));
+
+    /* Offer the last session with this server for resumption, but not
+     * when renegotiating the keys of an established connection. */
+    if (peer->state != DTLS_STATE_CONNECTED) {
+      cached = dtls_find_session_by_peer(ctx, &peer->session);
+    }
+    handshake->session_id_length = cached ? cached->id_length : 0;
+    if (cached) {
+      memcpy(handshake->session_id, cached->id, cached->id_length);
+    }
   }
   /* we must use the same Client Random as for the previous request */
   memcpy(p, handshake->tmp.random.client, DTLS_RANDOM_LENGTH);
   p += DTLS_RANDOM_LENGTH;
 
-  /* session id (length 0) */
-  dtls_int_to_uint8(p, 0);
+  /* session id */
+  dtls_int_to_uint8(p, handshake->session_id_length);
   p += sizeof(uint8_t);
+  memcpy(p, handshake->session_id, handshake->session_id_length);
+  p += handshake->session_id_length;
 
   /* cookie */
   dtls_int_to_uint8(p, cookie_length);
@@ -2559,6 +2838,9 @@ check_server_hello(dtls_context_t *ctx,
 		      uint8_t *data, size_t data_length)
 {
   dtls_handshake_parameters_t *handshake;
+  dtls_cached_session_t *cached;
+  size_t id_length;
+  int err;
 
   /* This function is called when we expect a ServerHello (i.e. we
    * have sent a ClientHello).  We might instead receive a HelloVerify
@@ -2601,7 +2883,18 @@ check_server_hello(dtls_context_t *ctx,
   data += DTLS_RANDOM_LENGTH;
   data_length -= DTLS_RANDOM_LENGTH;
 
+  /* The server resumes the session we have offered by sending back
+   * its id, any other id belongs to a new session. */
+  id_length = dtls_uint8_to_int(data);
+  if (id_length > DTLS_SESSION_ID_LENGTH)
+    goto error;
+
   SKIP_VAR_FIELD(data, data_length); /* skip session id */
+  handshake->resumed = id_length != 0 &&
+    id_length == handshake->session_id_length &&
+    memcmp(handshake->session_id, data - id_length, id_length) == 0;
+  handshake->session_id_length = id_length;
+  memcpy(handshake->session_id, data - id_length, id_length);
     
   /* Check cipher suite. As we offer all we have, it is sufficient
    * to check if the cipher suite selected by the server is in our
@@ -2623,7 +2916,19 @@ check_server_hello(dtls_context_t *ctx,
   data += sizeof(uint8_t);
   data_length -= sizeof(uint8_t);
 
-  return dtls_check_tls_extension(peer, data, data_length, 0);
+  err = dtls_check_tls_extension(peer, data, data_length, 0);
+  if (err < 0 || !handshake->resumed) {
+    return err;
+  }
+
+  /* abbreviated handshake, the server finishes next */
+  cached = dtls_find_session_by_id(ctx, handshake->session_id,
+				   handshake->session_id_length);
+  if (!cached || cached->cipher != handshake->cipher) {
+    dtls_warn("cannot resume session\n");
+    return dtls_alert_fatal_create(DTLS_ALERT_HANDSHAKE_FAILURE);
+  }
+  return resume_key_block(handshake, peer, cached);
 
 error:
   return dtls_alert_fatal_create(DTLS_ALERT_DECODE_ERROR);
@@ -2709,8 +3014,8 @@ check_server_key_exchange_ecdsa(dtls_context_t *ctx,
 				uint8_t *data, size_t data_length)
 {
   int ret;
-  unsigned char *result_r;
-  unsigned char *result_s;
+  unsigned char result_r[DTLS_EC_KEY_SIZE];
+  unsigned char result_s[DTLS_EC_KEY_SIZE];
   unsigned char *key_params;
   dtls_handshake_parameters_t *config;
 
@@ -2725,10 +3030,11 @@ check_server_key_exchange_ecdsa(dtls_context_t *ctx,
 
   data += DTLS_HS_LENGTH;
 
-  if (data_length < DTLS_HS_LENGTH + DTLS_SKEXEC_LENGTH) {
+  if (data_length < DTLS_HS_LENGTH + DTLS_SKEXEC_LENGTH_MIN) {
     dtls_alert("the packet length does not match the expected\n");
     return dtls_alert_fatal_create(DTLS_ALERT_DECODE_ERROR);
   }
+  data_length -= DTLS_HS_LENGTH;
   key_params = data;
 
   if (dtls_uint8_to_int(data) != TLS_EC_CURVE_TYPE_NAMED_CURVE) {
@@ -2767,7 +3073,7 @@ check_server_key_exchange_ecdsa(dtls_context_t *ctx,
   data += sizeof(config->keyx.ecdsa.other_eph_pub_y);
   data_length -= sizeof(config->keyx.ecdsa.other_eph_pub_y);
 
-  ret = dtls_check_ecdsa_signature_elem(data, data_length, &result_r, &result_s);
+  ret = dtls_check_ecdsa_signature_elem(data, data_length, result_r, result_s);
   if (ret < 0) {
     return ret;
   }
@@ -3170,7 +3476,9 @@ handle_handshake_msg(dtls_context_t *ctx, dtls_peer_t *peer, session_t *session,
       dtls_warn("error in check_server_hello err: %i\n", err);
       return err;
     }
-    if (is_tls_ecdhe_ecdsa_with_aes_128_ccm_8(peer->handshake_params->cipher))
+    if (peer->handshake_params->resumed)
+      peer->state = DTLS_STATE_WAIT_CHANGECIPHERSPEC;
+    else if (is_tls_ecdhe_ecdsa_with_aes_128_ccm_8(peer->handshake_params->cipher))
       peer->state = DTLS_STATE_WAIT_SERVERCERTIFICATE;
     else
       peer->state = DTLS_STATE_WAIT_SERVERHELLODONE;
@@ -3287,8 +3595,8 @@ handle_handshake_msg(dtls_context_t *ctx, dtls_peer_t *peer, session_t *session,
       dtls_warn("error in check_finished err: %i\n", err);
       return err;
     }
-    if (role == DTLS_SERVER) {
-      /* send ServerFinished */
+    if (sends_last_finished(peer)) {
+      /* send ServerFinished, or ClientFinished when resuming */
       update_hs_hash(peer, data, data_length);
 
       /* send change cipher spec message and switch to new configuration */
@@ -3300,12 +3608,17 @@ handle_handshake_msg(dtls_context_t *ctx, dtls_peer_t *peer, session_t *session,
 
       dtls_security_params_switch(peer);
 
-      err = dtls_send_finished(ctx, peer, PRF_LABEL(server), PRF_LABEL_SIZE(server));
+      if (role == DTLS_SERVER) {
+        err = dtls_send_finished(ctx, peer, PRF_LABEL(server), PRF_LABEL_SIZE(server));
+      } else {
+        err = dtls_send_finished(ctx, peer, PRF_LABEL(client), PRF_LABEL_SIZE(client));
+      }
       if (err < 0) {
-        dtls_warn("sending server Finished failed\n");
+        dtls_warn("sending Finished failed\n");
         return err;
       }
     }
+    dtls_cache_session(ctx, peer);
     dtls_handshake_free(peer->handshake_params);
     peer->handshake_params = NULL;
     dtls_debug("Handshake complete\n");
@@ -3400,7 +3713,7 @@ handle_handshake_msg(dtls_context_t *ctx, dtls_peer_t *peer, session_t *session,
       * the cookie exchange */
     if (peer && state == DTLS_STATE_WAIT_CLIENTHELLO) {
        dtls_debug("removing the peer\n");
-       delete_peer(&ctx->peers, peer);
+       delete_peer(&PEER_BUCKET(ctx, &peer->session), peer);
 
        dtls_free_peer(peer);
        peer = NULL;
@@ -3463,7 +3776,9 @@ handle_handshake_msg(dtls_context_t *ctx, dtls_peer_t *peer, session_t *session,
     if (err < 0) {
       return err;
     }
-    if (is_tls_ecdhe_ecdsa_with_aes_128_ccm_8(peer->handshake_params->cipher) &&
+    if (peer->handshake_params->resumed)
+      peer->state = DTLS_STATE_WAIT_CHANGECIPHERSPEC;
+    else if (is_tls_ecdhe_ecdsa_with_aes_128_ccm_8(peer->handshake_params->cipher) &&
 	is_ecdsa_client_auth_supported(ctx))
       peer->state = DTLS_STATE_WAIT_CLIENTCERTIFICATE;
     else
@@ -3647,8 +3962,12 @@ handle_ccs(dtls_context_t *ctx, dtls_peer_t *peer,
   if (data_length < 1 || data[0] != 1)
     return dtls_alert_fatal_create(DTLS_ALERT_DECODE_ERROR);
 
-  /* Just change the cipher when we are on the same epoch */
-  if (peer->role == DTLS_SERVER) {
+  if (!peer->handshake_params)
+    return dtls_alert_fatal_create(DTLS_ALERT_INTERNAL_ERROR);
+
+  /* Just change the cipher when we are on the same epoch. A resumed
+   * session already has its keys from the ServerHello. */
+  if (peer->role == DTLS_SERVER && !peer->handshake_params->resumed) {
     err = calculate_key_block(ctx, peer->handshake_params, peer,
 			      &peer->session, peer->role);
     if (err < 0) {
@@ -3689,7 +4008,11 @@ handle_alert(dtls_context_t *ctx, dtls_peer_t *peer,
   if (data[0] == DTLS_ALERT_LEVEL_FATAL || data[1] == DTLS_ALERT_CLOSE_NOTIFY) {
     dtls_alert("%d invalidate peer\n", data[1]);
 
-    delete_peer(&ctx->peers, peer);
+    if (data[1] != DTLS_ALERT_CLOSE_NOTIFY) {
+      dtls_uncache_session(ctx, &peer->session);
+    }
+
+    delete_peer(&PEER_BUCKET(ctx, &peer->session), peer);
 
     dtls_debug_session("removed peer", &peer->session);
 
@@ -3733,6 +4056,9 @@ static int dtls_alert_send_from_err(dtls_context_t *ctx, dtls_peer_t *peer,
     if (!peer) {
       peer = dtls_get_peer(ctx, session);
     }
+    if (level == DTLS_ALERT_LEVEL_FATAL) {
+      dtls_uncache_session(ctx, session);
+    }
     if (peer) {
       peer->state = DTLS_STATE_CLOSING;
       return dtls_send_alert(ctx, peer, level, desc);
@@ -3741,6 +4067,7 @@ static int dtls_alert_send_from_err(dtls_context_t *ctx, dtls_peer_t *peer,
     if (!peer) {
       peer = dtls_get_peer(ctx, session);
     }
+    dtls_uncache_session(ctx, session);
     if (peer) {
       peer->state = DTLS_STATE_CLOSING;
       return dtls_send_alert(ctx, peer, DTLS_ALERT_LEVEL_FATAL, DTLS_ALERT_INTERNAL_ERROR);
@@ -3862,10 +4189,11 @@ dtls_handle_message(dtls_context_t *ctx,
 
 	/* The new security parameters must be used for all messages
 	 * that are sent after the ChangeCipherSpec message. This
-	 * means that the client's Finished message uses epoch + 1
-	 * while the server is still in the old epoch.
+	 * means that the first Finished message uses epoch + 1
+	 * while its receiver is still in the old epoch.
 	 */
-	if (role == DTLS_SERVER && state == DTLS_STATE_WAIT_FINISHED) {
+	if (state == DTLS_STATE_WAIT_FINISHED && peer->handshake_params &&
+	    sends_last_finished(peer)) {
 	  expected_epoch++;
 	}
 
@@ -3954,14 +4282,14 @@ void dtls_reset_peer(dtls_context_t *ctx, dtls_peer_t *peer)
 void
 dtls_free_context(dtls_context_t *ctx) {
   dtls_peer_t *p, *tmp;
+  int i;
 
   if (!ctx) {
     return;
   }
 
-  if (ctx->peers) {
-    //      LL_FOREACH_SAFE(ctx->peers, p, tmp) {
-    p = ctx->peers;
+  for (i = 0; i < DTLS_PEER_HASH_SIZE; i++) {
+    p = ctx->peers[i];
     while(p) {
       tmp = p->next;
       dtls_destroy_peer(ctx, p, 1);
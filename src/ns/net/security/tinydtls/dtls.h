@@ -206,12 +206,32 @@ typedef struct {
 
 struct netq_t;
 
+/**
+ * A completed session that can be resumed with an abbreviated
+ * handshake. Servers look sessions up by id, clients by the address
+ * of the server.
+ */
+typedef struct {
+  session_t session;		/**< remote address of the session */
+  dtls_tick_t created;		/**< time of the full handshake */
+  dtls_tick_t last_used;	/**< time of the last (resumed) handshake */
+  dtls_cipher_t cipher;
+  dtls_compression_t compression;
+  uint8_t id_length;		/**< 0 for an unused entry */
+  uint8_t id[DTLS_SESSION_ID_LENGTH];
+  uint8_t master_secret[DTLS_MASTER_SECRET_LENGTH];
+} dtls_cached_session_t;
+
 /** Holds global information of the DTLS engine. */
 typedef struct dtls_context_t {
   unsigned char cookie_secret[DTLS_COOKIE_SECRET_LENGTH];
   dtls_tick_t cookie_secret_age; /**< the time the secret has been generated */
 
-  dtls_peer_t *peers;		/**< peer hash map */
+  dtls_peer_t *peers[DTLS_PEER_HASH_SIZE]; /**< peer hash map */
+
+#if DTLS_SESSION_CACHE_MAX > 0
+  dtls_cached_session_t sessions[DTLS_SESSION_CACHE_MAX]; /**< resumable sessions */
+#endif /* DTLS_SESSION_CACHE_MAX > 0 */
 
 #ifdef DTLS_SUPPORT_CONF_CONTEXT_STATE
   DTLS_SUPPORT_CONF_CONTEXT_STATE support;
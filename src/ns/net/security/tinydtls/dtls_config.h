@@ -127,6 +127,23 @@
 #define DTLS_PEER_MAX 1
 #endif
 
+#ifndef DTLS_PEER_HASH_SIZE
+/** The number of buckets in the peer table of each context. */
+#define DTLS_PEER_HASH_SIZE DTLS_PEER_MAX
+#endif
+
+#ifndef DTLS_SESSION_CACHE_MAX
+/** The maximum number of sessions kept for an abbreviated handshake,
+ *  0 disables session resumption. */
+#define DTLS_SESSION_CACHE_MAX DTLS_PEER_MAX
+#endif
+
+#ifndef DTLS_SESSION_CACHE_LIFETIME
+/** The number of seconds a cached session can be resumed, counted
+    from the full handshake that negotiated it. */
+#define DTLS_SESSION_CACHE_LIFETIME (24 * 60 * 60)
+#endif
+
 #ifndef DTLS_HANDSHAKE_MAX
 /** The maximum number of concurrent DTLS handshakes. */
 #define DTLS_HANDSHAKE_MAX 1
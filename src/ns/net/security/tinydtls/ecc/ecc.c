@@ -31,15 +31,714 @@
  *
  * [0]: http://cockrum.net/Implementation_of_ECC_on_an_8-bit_microcontroller.pdf
  *
- * This is a efficient ECC implementation on the secp256r1 curve for 32 Bit CPU
- * architectures. It provides basic operations on the secp256r1 curve and support
- * for ECDH and ECDSA.
+ * This is a efficient ECC implementation on the secp256r1 curve for 32 and 64
+ * Bit CPU architectures. It provides basic operations on the secp256r1 curve and
+ * support for ECDH and ECDSA.
+ *
+ * Field and scalar arithmetic use Montgomery multiplication on 64 bit limbs
+ * where the compiler has a 128 bit type and on 32 bit limbs otherwise. Points
+ * are kept in projective coordinates and added with the complete formulas of
+ * Renes, Costello and Batina [1], so scalar multiplication runs without
+ * inversions and without branches or table indexes that depend on the secret.
+ *
+ * [1]: https://eprint.iacr.org/2015/1060.pdf
  */
 
 //big number functions
 #include "ecc.h"
 #include <string.h>
 
+//limb size of the field arithmetic, 64 bit limbs need a 128 bit product
+#ifndef ECC_LIMB_BITS
+#ifdef __SIZEOF_INT128__
+#define ECC_LIMB_BITS 64
+#else
+#define ECC_LIMB_BITS 32
+#endif
+#endif
+
+//window of the multiplication of other points than G: 1, 2, 4 or 8 bit.
+//The window table takes 2^ECC_WINDOW_BITS points on the stack.
+#ifndef ECC_WINDOW_BITS
+#define ECC_WINDOW_BITS 4
+#endif
+//a window must not straddle two words of the scalar
+#if ECC_WINDOW_BITS < 1 || ECC_WINDOW_BITS > 8 || 32 % ECC_WINDOW_BITS != 0
+#error "ECC_WINDOW_BITS has to be 1, 2, 4 or 8"
+#endif
+
+#if ECC_LIMB_BITS == 64
+typedef uint64_t limb_t;
+typedef unsigned __int128 dlimb_t;
+//constants are written as 8 words of 32 bit, least significant first
+#define FE(w0, w1, w2, w3, w4, w5, w6, w7) \
+	{ ((uint64_t)(w1) << 32) | (w0), ((uint64_t)(w3) << 32) | (w2), \
+	  ((uint64_t)(w5) << 32) | (w4), ((uint64_t)(w7) << 32) | (w6) }
+#elif ECC_LIMB_BITS == 32
+typedef uint32_t limb_t;
+typedef uint64_t dlimb_t;
+#define FE(w0, w1, w2, w3, w4, w5, w6, w7) \
+	{ (w0), (w1), (w2), (w3), (w4), (w5), (w6), (w7) }
+#else
+#error "ECC_LIMB_BITS has to be 32 or 64"
+#endif
+
+#define LIMBS (256 / ECC_LIMB_BITS)
+#define WORDS_PER_LIMB (ECC_LIMB_BITS / 32)
+
+typedef struct {
+	limb_t m[LIMBS];
+	limb_t rr[LIMBS];	//R^2 mod m with R = 2^256
+	limb_t one[LIMBS];	//R mod m, 1 in Montgomery form
+	limb_t m0inv;		//-m^-1 mod 2^ECC_LIMB_BITS
+} modulus_t;
+
+/*
+ * A point (X:Y:Z) in homogeneous projective coordinates with x = X/Z and
+ * y = Y/Z, all in Montgomery form. The point at infinity is (0:1:0).
+ */
+typedef struct {
+	limb_t x[LIMBS];
+	limb_t y[LIMBS];
+	limb_t z[LIMBS];
+} point_t;
+
+//FFFFFFFF00000001000000000000000000000000FFFFFFFFFFFFFFFFFFFFFFFF
+static const modulus_t ecc_p = {
+	FE(0xffffffff, 0xffffffff, 0xffffffff, 0x00000000,
+	   0x00000000, 0x00000000, 0x00000001, 0xffffffff),
+	FE(0x00000003, 0x00000000, 0xffffffff, 0xfffffffb,
+	   0xfffffffe, 0xffffffff, 0xfffffffd, 0x00000004),
+	FE(0x00000001, 0x00000000, 0x00000000, 0xffffffff,
+	   0xffffffff, 0xffffffff, 0xfffffffe, 0x00000000),
+	1
+};
+
+// ffffffff00000000ffffffffffffffffbce6faada7179e84f3b9cac2fc632551
+static const modulus_t ecc_n = {
+	FE(0xfc632551, 0xf3b9cac2, 0xa7179e84, 0xbce6faad,
+	   0xffffffff, 0xffffffff, 0x00000000, 0xffffffff),
+	FE(0xbe79eea2, 0x83244c95, 0x49bd6fa6, 0x4699799c,
+	   0x2b6bec59, 0x2845b239, 0xf3d95620, 0x66e12d94),
+	FE(0x039cdaaf, 0x0c46353d, 0x58e8617b, 0x43190552,
+	   0x00000000, 0x00000000, 0xffffffff, 0x00000000),
+	(limb_t)0xccd1c8aaee00bc4fULL
+};
+
+static const limb_t limb_one[LIMBS] = FE(1, 0, 0, 0, 0, 0, 0, 0);
+
+//b of the curve equation in Montgomery form
+static const limb_t ecc_b[LIMBS] =
+	FE(0x29c4bddf, 0xd89cdf62, 0x78843090, 0xacf005cd,
+	   0xf7212ed6, 0xe5a220ab, 0x04874834, 0xdc30061d);
+
+const uint32_t ecc_g_point_x[8] = { 0xD898C296, 0xF4A13945, 0x2DEB33A0, 0x77037D81,
+				    0x63A440F2, 0xF8BCE6E5, 0xE12C4247, 0x6B17D1F2};
+const uint32_t ecc_g_point_y[8] = { 0x37BF51F5, 0xCBB64068, 0x6B315ECE, 0x2BCE3357,
+				    0x7C0F9E16, 0x8EE7EB4A, 0xFE1A7F9B, 0x4FE342E2};
+
+/*
+ * Comb table of the base point G in affine Montgomery form: entry i - 1
+ * is the sum of 2^(64 j) G over the bits j set in i.
+ */
+static const limb_t ecc_g_comb[15][2][LIMBS] = {
+	{ FE(0x18a9143c, 0x79e730d4, 0x5fedb601, 0x75ba95fc,
+	     0x77622510, 0x79fb732b, 0xa53755c6, 0x18905f76),
+	  FE(0xce95560a, 0xddf25357, 0xba19e45c, 0x8b4ab8e4,
+	     0xdd21f325, 0xd2e88688, 0x25885d85, 0x8571ff18) },
+	{ FE(0x16a0d2bb, 0x4f922fc5, 0x1a623499, 0x0d5cc16c,
+	     0x57c62c8b, 0x9241cf3a, 0xfd1b667f, 0x2f5e6961),
+	  FE(0xf5a01797, 0x5c15c70b, 0x60956192, 0x3d20b44d,
+	     0x071fdb52, 0x04911b37, 0x8d6f0f7b, 0xf648f916) },
+	{ FE(0xe137bbbc, 0x9e566847, 0x8a6a0bec, 0xe434469e,
+	     0x79d73463, 0xb1c42761, 0x133d0015, 0x5abe0285),
+	  FE(0xc04c7dab, 0x92aa837c, 0x43260c07, 0x573d9f4c,
+	     0x78e6cc37, 0x0c931562, 0x6b6f7383, 0x94bb725b) },
+	{ FE(0xbfe20925, 0x62a8c244, 0x8fdce867, 0x91c19ac3,
+	     0xdd387063, 0x5a96a5d5, 0x21d324f6, 0x61d587d4),
+	  FE(0xa37173ea, 0xe87673a2, 0x53778b65, 0x23848008,
+	     0x05bab43e, 0x10f8441e, 0x4621efbe, 0xfa11fe12) },
+	{ FE(0x2cb19ffd, 0x1c891f2b, 0xb1923c23, 0x01ba8d5b,
+	     0x8ac5ca8e, 0xb6d03d67, 0x1f13bedc, 0x586eb04c),
+	  FE(0x27e8ed09, 0x0c35c6e5, 0x1819ede2, 0x1e81a33c,
+	     0x56c652fa, 0x278fd6c0, 0x70864f11, 0x19d5ac08) },
+	{ FE(0xd2b533d5, 0x62577734, 0xa1bdddc0, 0x673b8af6,
+	     0xa79ec293, 0x577e7c9a, 0xc3b266b1, 0xbb6de651),
+	  FE(0xb65259b3, 0xe7e9303a, 0xd03a7480, 0xd6a0afd3,
+	     0x9b3cfc27, 0xc5ac83d1, 0x5d18b99b, 0x60b4619a) },
+	{ FE(0x1ae5aa1c, 0xbd6a38e1, 0x49e73658, 0xb8b7652b,
+	     0xee5f87ed, 0x0b130014, 0xaeebffcd, 0x9d0f27b2),
+	  FE(0x7a730a55, 0xca924631, 0xddbbc83a, 0x9c955b2f,
+	     0xac019a71, 0x07c1dfe0, 0x356ec48d, 0x244a566d) },
+	{ FE(0xf4f8b16a, 0x56f8410e, 0xc47b266a, 0x97241afe,
+	     0x6d9c87c1, 0x0a406b8e, 0xcd42ab1b, 0x803f3e02),
+	  FE(0x04dbec69, 0x7f0309a8, 0x3bbad05f, 0xa83b85f7,
+	     0xad8e197f, 0xc6097273, 0x5067adc1, 0xc097440e) },
+	{ FE(0xc379ab34, 0x846a56f2, 0x841df8d1, 0xa8ee068b,
+	     0x176c68ef, 0x20314459, 0x915f1f30, 0xf1af32d5),
+	  FE(0x5d75bd50, 0x99c37531, 0xf72f67bc, 0x837cffba,
+	     0x48d7723f, 0x0613a418, 0xe2d41c8b, 0x23d0f130) },
+	{ FE(0xd5be5a2b, 0xed93e225, 0x5934f3c6, 0x6fe79983,
+	     0x22626ffc, 0x43140926, 0x7990216a, 0x50bbb4d9),
+	  FE(0xe57ec63e, 0x378191c6, 0x181dcdb2, 0x65422c40,
+	     0x0236e0f6, 0x41a8099b, 0x01fe49c3, 0x2b100118) },
+	{ FE(0x9b391593, 0xfc68b5c5, 0x598270fc, 0xc385f5a2,
+	     0xd19adcbb, 0x7144f3aa, 0x83fbae0c, 0xdd558999),
+	  FE(0x74b82ff4, 0x93b88b8e, 0x71e734c9, 0xd2e03c40,
+	     0x43c0322a, 0x9a7a9eaf, 0x149d6041, 0xe6e4c551) },
+	{ FE(0x80ec21fe, 0x5fe14bfe, 0xc255be82, 0xf6ce116a,
+	     0x2f4a5d67, 0x98bc5a07, 0xdb7e63af, 0xfad27148),
+	  FE(0x29ab05b3, 0x90c0b6ac, 0x4e251ae6, 0x37a9a83c,
+	     0xc2aade7d, 0x0a7dc875, 0x9f0e1a84, 0x77387de3) },
+	{ FE(0xa56c0dd7, 0x1e9ecc49, 0x46086c74, 0xa5cffcd8,
+	     0xf505aece, 0x8f7a1408, 0xbef0c47e, 0xb37b85c0),
+	  FE(0xcc0e6a8f, 0x3596b6e4, 0x6b388f23, 0xfd6d4bbf,
+	     0xc39cef4e, 0xaba453fa, 0xf9f628d5, 0x9c135ac8) },
+	{ FE(0x95c8f8be, 0x0a1c7294, 0x3bf362bf, 0x2961c480,
+	     0xdf63d4ac, 0x9e418403, 0x91ece900, 0xc109f9cb),
+	  FE(0x58945705, 0xc2d095d0, 0xddeb85c0, 0xb9083d96,
+	     0x7a40449b, 0x84692b8d, 0x2eee1ee1, 0x9bc3344f) },
+	{ FE(0x42913074, 0x0d5ae356, 0x48a542b1, 0x55491b27,
+	     0xb310732a, 0x469ca665, 0x5f1a4cc1, 0x29591d52),
+	  FE(0xb84f983f, 0xe76f5b6b, 0x9f5f84e1, 0xbe7eef41,
+	     0x80baa189, 0x1200d496, 0x18ef332c, 0x6376551f) }
+};
+
+static void from_words(limb_t *r, const uint32_t *w){
+	int i, j;
+	for (i = 0; i < LIMBS; i++) {
+		r[i] = 0;
+		for (j = 0; j < WORDS_PER_LIMB; j++)
+			r[i] |= (limb_t)w[i * WORDS_PER_LIMB + j] << (32 * j);
+	}
+}
+
+static void to_words(uint32_t *w, const limb_t *a){
+	int i, j;
+	for (i = 0; i < LIMBS; i++)
+		for (j = 0; j < WORDS_PER_LIMB; j++)
+			w[i * WORDS_PER_LIMB + j] = (uint32_t)(a[i] >> (32 * j));
+}
+
+//all bits set if a == b
+static limb_t ct_eq(uint32_t a, uint32_t b){
+	return -(limb_t)((uint32_t)((a ^ b) - 1) >> 31);
+}
+
+//r = a where the mask is set, without a branch
+static void ct_select(limb_t *r, const limb_t *a, limb_t mask){
+	int i;
+	for (i = 0; i < LIMBS; i++)
+		r[i] ^= (r[i] ^ a[i]) & mask;
+}
+
+static int limbs_zero(const limb_t *a){
+	limb_t t = 0;
+	int i;
+	for (i = 0; i < LIMBS; i++)
+		t |= a[i];
+	return t == 0;
+}
+
+static limb_t limbs_add(limb_t *r, const limb_t *a, const limb_t *b){
+	dlimb_t c = 0;
+	int i;
+	for (i = 0; i < LIMBS; i++) {
+		c += (dlimb_t)a[i] + b[i];
+		r[i] = (limb_t)c;
+		c >>= ECC_LIMB_BITS;
+	}
+	return (limb_t)c;
+}
+
+static limb_t limbs_sub(limb_t *r, const limb_t *a, const limb_t *b){
+	dlimb_t c = 0;
+	int i;
+	for (i = 0; i < LIMBS; i++) {
+		c = (dlimb_t)a[i] - b[i] - c;
+		r[i] = (limb_t)c;
+		c = (c >> ECC_LIMB_BITS) & 1;
+	}
+	return (limb_t)c;
+}
+
+//r = a + b mod m for a, b < m
+static void mod_add(limb_t *r, const limb_t *a, const limb_t *b, const modulus_t *mod){
+	limb_t t[LIMBS];
+	limb_t carry, borrow;
+
+	carry = limbs_add(r, a, b);
+	borrow = limbs_sub(t, r, mod->m);
+	ct_select(r, t, -(carry | (borrow ^ 1)));
+}
+
+//r = a - b mod m for a, b < m
+static void mod_sub(limb_t *r, const limb_t *a, const limb_t *b, const modulus_t *mod){
+	limb_t t[LIMBS];
+	limb_t borrow;
+
+	borrow = limbs_sub(r, a, b);
+	limbs_add(t, r, mod->m);
+	ct_select(r, t, -borrow);
+}
+
+/*
+ * Montgomery multiplication r = a b R^-1 mod m for a, b < m, interleaving
+ * the product and the reduction a limb at a time (CIOS).
+ */
+static void mont_mul(limb_t *r, const limb_t *a, const limb_t *b, const modulus_t *mod){
+	limb_t t[LIMBS + 2];
+	limb_t u[LIMBS];
+	limb_t q, borrow;
+	dlimb_t c;
+	int i, j;
+
+	memset(t, 0, sizeof(t));
+	for (i = 0; i < LIMBS; i++) {
+		//t += a b[i]
+		c = 0;
+		for (j = 0; j < LIMBS; j++) {
+			c += (dlimb_t)a[j] * b[i] + t[j];
+			t[j] = (limb_t)c;
+			c >>= ECC_LIMB_BITS;
+		}
+		c += t[LIMBS];
+		t[LIMBS] = (limb_t)c;
+		t[LIMBS + 1] = (limb_t)(c >> ECC_LIMB_BITS);
+
+		//t = (t + q m) / 2^ECC_LIMB_BITS, q clears the lowest limb
+		q = t[0] * mod->m0inv;
+		c = ((dlimb_t)q * mod->m[0] + t[0]) >> ECC_LIMB_BITS;
+		for (j = 1; j < LIMBS; j++) {
+			c += (dlimb_t)q * mod->m[j] + t[j];
+			t[j - 1] = (limb_t)c;
+			c >>= ECC_LIMB_BITS;
+		}
+		c += t[LIMBS];
+		t[LIMBS - 1] = (limb_t)c;
+		t[LIMBS] = t[LIMBS + 1] + (limb_t)(c >> ECC_LIMB_BITS);
+	}
+
+	//t < 2m, take t - m unless that borrows
+	borrow = limbs_sub(u, t, mod->m);
+	ct_select(t, u, -(t[LIMBS] | (borrow ^ 1)));
+	memcpy(r, t, LIMBS * sizeof(limb_t));
+}
+
+//r = a^-1 = a^(m - 2) in Montgomery form, 0 for a = 0
+static void mont_inv(limb_t *r, const limb_t *a, const modulus_t *mod){
+	limb_t e[LIMBS];
+	limb_t t[LIMBS];
+	int i;
+
+	memcpy(e, mod->m, sizeof(e));
+	e[0] -= 2;
+	memcpy(t, mod->one, sizeof(t));
+	//the exponent is public, the branch does not leak a
+	for (i = 256; i--;) {
+		mont_mul(t, t, t, mod);
+		if ((e[i / ECC_LIMB_BITS] >> (i % ECC_LIMB_BITS)) & 1)
+			mont_mul(t, t, a, mod);
+	}
+	memcpy(r, t, sizeof(t));
+}
+
+#define fe_add(r, a, b) mod_add(r, a, b, &ecc_p)
+#define fe_sub(r, a, b) mod_sub(r, a, b, &ecc_p)
+#define fe_mul(r, a, b) mont_mul(r, a, b, &ecc_p)
+
+//r = a mod n for a < 2^256 < 2n
+static void scalar_reduce(limb_t *r, const limb_t *a){
+	limb_t t[LIMBS];
+	limb_t borrow;
+
+	borrow = limbs_sub(t, a, ecc_n.m);
+	memcpy(r, a, sizeof(t));
+	ct_select(r, t, borrow - 1);
+}
+
+//r = a b mod n for a, b < n
+static void scalar_mul(limb_t *r, const limb_t *a, const limb_t *b){
+	mont_mul(r, a, b, &ecc_n);
+	mont_mul(r, r, ecc_n.rr, &ecc_n);
+}
+
+//r = a^-1 mod n for a < n
+static void scalar_inv(limb_t *r, const limb_t *a){
+	mont_mul(r, a, ecc_n.rr, &ecc_n);
+	mont_inv(r, r, &ecc_n);
+	mont_mul(r, r, limb_one, &ecc_n);
+}
+
+static int scalar_valid(const limb_t *a){
+	limb_t t[LIMBS];
+	return !limbs_zero(a) && limbs_sub(t, a, ecc_n.m);
+}
+
+static void point_set_infinity(point_t *r){
+	memset(r->x, 0, sizeof(r->x));
+	memcpy(r->y, ecc_p.one, sizeof(r->y));
+	memset(r->z, 0, sizeof(r->z));
+}
+
+//(0, 0) stands for the point at infinity, as in the results
+static void point_from_affine(point_t *r, const uint32_t *x, const uint32_t *y){
+	from_words(r->x, x);
+	from_words(r->y, y);
+	if (limbs_zero(r->x) && limbs_zero(r->y)) {
+		point_set_infinity(r);
+		return;
+	}
+	fe_mul(r->x, r->x, ecc_p.rr);
+	fe_mul(r->y, r->y, ecc_p.rr);
+	memcpy(r->z, ecc_p.one, sizeof(r->z));
+}
+
+static void point_to_affine(uint32_t *x, uint32_t *y, const point_t *p){
+	limb_t zinv[LIMBS];
+	limb_t t[LIMBS];
+
+	//Z = 0 gives 0 and so (0, 0) for the point at infinity
+	mont_inv(zinv, p->z, &ecc_p);
+	fe_mul(t, p->x, zinv);
+	fe_mul(t, t, limb_one);
+	to_words(x, t);
+	fe_mul(t, p->y, zinv);
+	fe_mul(t, t, limb_one);
+	to_words(y, t);
+}
+
+/*
+ * r = p + q with the complete addition formula for a = -3 (algorithm 4 in
+ * [1]), it holds for p = q and for the point at infinity as well.
+ */
+static void point_add(point_t *r, const point_t *p, const point_t *q){
+	limb_t t0[LIMBS], t1[LIMBS], t2[LIMBS], t3[LIMBS], t4[LIMBS];
+	limb_t x3[LIMBS], y3[LIMBS], z3[LIMBS];
+
+	fe_mul(t0, p->x, q->x);
+	fe_mul(t1, p->y, q->y);
+	fe_mul(t2, p->z, q->z);
+	fe_add(t3, p->x, p->y);
+	fe_add(t4, q->x, q->y);
+	fe_mul(t3, t3, t4);
+	fe_add(t4, t0, t1);
+	fe_sub(t3, t3, t4);
+	fe_add(t4, p->y, p->z);
+	fe_add(x3, q->y, q->z);
+	fe_mul(t4, t4, x3);
+	fe_add(x3, t1, t2);
+	fe_sub(t4, t4, x3);
+	fe_add(x3, p->x, p->z);
+	fe_add(y3, q->x, q->z);
+	fe_mul(x3, x3, y3);
+	fe_add(y3, t0, t2);
+	fe_sub(y3, x3, y3);
+	fe_mul(z3, ecc_b, t2);
+	fe_sub(x3, y3, z3);
+	fe_add(z3, x3, x3);
+	fe_add(x3, x3, z3);
+	fe_sub(z3, t1, x3);
+	fe_add(x3, t1, x3);
+	fe_mul(y3, ecc_b, y3);
+	fe_add(t1, t2, t2);
+	fe_add(t2, t1, t2);
+	fe_sub(y3, y3, t2);
+	fe_sub(y3, y3, t0);
+	fe_add(t1, y3, y3);
+	fe_add(y3, t1, y3);
+	fe_add(t1, t0, t0);
+	fe_add(t0, t1, t0);
+	fe_sub(t0, t0, t2);
+	fe_mul(t1, t4, y3);
+	fe_mul(t2, t0, y3);
+	fe_mul(y3, x3, z3);
+	fe_add(y3, y3, t2);
+	fe_mul(x3, t3, x3);
+	fe_sub(x3, x3, t1);
+	fe_mul(z3, t4, z3);
+	fe_mul(t1, t3, t0);
+	fe_add(z3, z3, t1);
+
+	memcpy(r->x, x3, sizeof(x3));
+	memcpy(r->y, y3, sizeof(y3));
+	memcpy(r->z, z3, sizeof(z3));
+}
+
+//r = 2 p, doubling formula for a = -3 (algorithm 6 in [1])
+static void point_double(point_t *r, const point_t *p){
+	limb_t t0[LIMBS], t1[LIMBS], t2[LIMBS], t3[LIMBS];
+	limb_t x3[LIMBS], y3[LIMBS], z3[LIMBS];
+
+	fe_mul(t0, p->x, p->x);
+	fe_mul(t1, p->y, p->y);
+	fe_mul(t2, p->z, p->z);
+	fe_mul(t3, p->x, p->y);
+	fe_add(t3, t3, t3);
+	fe_mul(z3, p->x, p->z);
+	fe_add(z3, z3, z3);
+	fe_mul(y3, ecc_b, t2);
+	fe_sub(y3, y3, z3);
+	fe_add(x3, y3, y3);
+	fe_add(y3, x3, y3);
+	fe_sub(x3, t1, y3);
+	fe_add(y3, t1, y3);
+	fe_mul(y3, x3, y3);
+	fe_mul(x3, x3, t3);
+	fe_add(t3, t2, t2);
+	fe_add(t2, t2, t3);
+	fe_mul(z3, ecc_b, z3);
+	fe_sub(z3, z3, t2);
+	fe_sub(z3, z3, t0);
+	fe_add(t3, z3, z3);
+	fe_add(z3, z3, t3);
+	fe_add(t3, t0, t0);
+	fe_add(t0, t3, t0);
+	fe_sub(t0, t0, t2);
+	fe_mul(t0, t0, z3);
+	fe_add(y3, y3, t0);
+	fe_mul(t0, p->y, p->z);
+	fe_add(t0, t0, t0);
+	fe_mul(z3, t0, z3);
+	fe_sub(x3, x3, z3);
+	fe_mul(z3, t0, t1);
+	fe_add(z3, z3, z3);
+	fe_add(z3, z3, z3);
+
+	memcpy(r->x, x3, sizeof(x3));
+	memcpy(r->y, y3, sizeof(y3));
+	memcpy(r->z, z3, sizeof(z3));
+}
+
+/*
+ * r = k p with a fixed window: ECC_WINDOW_BITS doublings and one addition
+ * of a table entry per window. Every table entry is read for each window.
+ */
+static void point_mult(point_t *r, const point_t *p, const uint32_t *k){
+	point_t table[1 << ECC_WINDOW_BITS];
+	point_t t;
+	uint32_t idx;
+	limb_t mask;
+	int i, j;
+
+	point_set_infinity(&table[0]);
+	table[1] = *p;
+	for (i = 2; i < (1 << ECC_WINDOW_BITS); i++)
+		point_add(&table[i], &table[i - 1], p);
+
+	point_set_infinity(r);
+	for (i = 256 / ECC_WINDOW_BITS; i--;) {
+		for (j = 0; j < ECC_WINDOW_BITS; j++)
+			point_double(r, r);
+
+		idx = (k[i * ECC_WINDOW_BITS / 32] >> (i * ECC_WINDOW_BITS % 32))
+			& ((1u << ECC_WINDOW_BITS) - 1);
+		memset(&t, 0, sizeof(t));
+		for (j = 0; j < (1 << ECC_WINDOW_BITS); j++) {
+			mask = ct_eq(j, idx);
+			ct_select(t.x, table[j].x, mask);
+			ct_select(t.y, table[j].y, mask);
+			ct_select(t.z, table[j].z, mask);
+		}
+		point_add(r, r, &t);
+	}
+}
+
+static uint32_t scalar_bit(const uint32_t *k, int i){
+	return (k[i / 32] >> (i % 32)) & 1;
+}
+
+/*
+ * r = k G with the comb table: one doubling and one addition for each
+ * of the 64 bit columns of k.
+ */
+static void point_mult_base(point_t *r, const uint32_t *k){
+	point_t t;
+	uint32_t idx;
+	limb_t mask;
+	int i, j;
+
+	point_set_infinity(r);
+	for (i = 64; i--;) {
+		point_double(r, r);
+
+		idx = scalar_bit(k, i) | scalar_bit(k, i + 64) << 1
+			| scalar_bit(k, i + 128) << 2 | scalar_bit(k, i + 192) << 3;
+		point_set_infinity(&t);
+		for (j = 1; j < 16; j++) {
+			mask = ct_eq(j, idx);
+			ct_select(t.x, ecc_g_comb[j - 1][0], mask);
+			ct_select(t.y, ecc_g_comb[j - 1][1], mask);
+			ct_select(t.z, ecc_p.one, mask);
+		}
+		point_add(r, r, &t);
+	}
+}
+
+void ecc_ec_mult(const uint32_t *px, const uint32_t *py, const uint32_t *secret, uint32_t *resultx, uint32_t *resulty){
+	point_t p;
+	point_t r;
+
+	if (!memcmp(px, ecc_g_point_x, sizeof(ecc_g_point_x)) &&
+	    !memcmp(py, ecc_g_point_y, sizeof(ecc_g_point_y))) {
+		point_mult_base(&r, secret);
+	} else {
+		point_from_affine(&p, px, py);
+		point_mult(&r, &p, secret);
+	}
+	point_to_affine(resultx, resulty, &r);
+}
+
+/**
+ * Calculate the ecdsa signature.
+ *
+ * For a description of this algorithm see
+ * https://en.wikipedia.org/wiki/Elliptic_Curve_DSA#Signature_generation_algorithm
+ *
+ * input:
+ *  d: private key on the curve secp256r1 (32 bytes)
+ *  e: hash to sign (32 bytes)
+ *  k: random data, this must be changed for every signature (32 bytes)
+ *
+ * output:
+ *  r: r value of the signature (32 bytes)
+ *  s: s value of the signature (32 bytes)
+ *
+ * return:
+ *   0: everything is ok
+ *  -1: can not create signature, try again with different k.
+ */
+int ecc_ecdsa_sign_hash(const uint32_t *d, const uint32_t *e, const uint32_t *k, uint32_t *r, uint32_t *s)
+{
+	point_t p;
+	uint32_t x1[8];
+	uint32_t y1[8];
+	limb_t rl[LIMBS];
+	limb_t sl[LIMBS];
+	limb_t tmp[LIMBS];
+
+	// 4. Calculate the curve point (x_1, y_1) = k * G.
+	point_mult_base(&p, k);
+	point_to_affine(x1, y1, &p);
+
+	// 5. Calculate r = x_1 \pmod{n}.
+	from_words(rl, x1);
+	scalar_reduce(rl, rl);
+
+	// 5. If r = 0, go back to step 3.
+	if (limbs_zero(rl))
+		return -1;
+
+	// 6. Calculate s = k^{-1}(z + r d_A) \pmod{n}.
+	// 6. r * d
+	from_words(tmp, d);
+	scalar_reduce(tmp, tmp);
+	scalar_mul(sl, rl, tmp);
+
+	// 6. z + (r d)
+	from_words(tmp, e);
+	scalar_reduce(tmp, tmp);
+	mod_add(sl, tmp, sl, &ecc_n);
+
+	// 6. k^{-1}, 0 if k is a multiple of n
+	from_words(tmp, k);
+	scalar_reduce(tmp, tmp);
+	scalar_inv(tmp, tmp);
+
+	// 6. (k^{-1}) (z + (r d))
+	scalar_mul(sl, tmp, sl);
+
+	// 6. If s = 0, go back to step 3.
+	if (limbs_zero(sl))
+		return -1;
+
+	to_words(r, rl);
+	to_words(s, sl);
+	return 0;
+}
+
+/**
+ * Verifies a ecdsa signature.
+ *
+ * For a description of this algorithm see
+ * https://en.wikipedia.org/wiki/Elliptic_Curve_DSA#Signature_verification_algorithm
+ *
+ * input:
+ *  x: x coordinate of the public key (32 bytes)
+ *  y: y coordinate of the public key (32 bytes)
+ *  e: hash to verify the signature of (32 bytes)
+ *  r: r value of the signature (32 bytes)
+ *  s: s value of the signature (32 bytes)
+ *
+ * return:
+ *  0: signature is ok
+ *  -1: signature check failed the signature is invalid
+ */
+int ecc_ecdsa_validate(const uint32_t *x, const uint32_t *y, const uint32_t *e, const uint32_t *r, const uint32_t *s)
+{
+	point_t p1;
+	point_t p2;
+	point_t q;
+	uint32_t u[8];
+	uint32_t x1[8];
+	uint32_t y1[8];
+	limb_t rl[LIMBS];
+	limb_t w[LIMBS];
+	limb_t tmp[LIMBS];
+
+	// 2. Check that r and s are in [1, n - 1]
+	from_words(rl, r);
+	from_words(tmp, s);
+	if (!scalar_valid(rl) || !scalar_valid(tmp))
+		return -1;
+
+	// 3. Calculate w = s^{-1} \pmod{n}
+	scalar_inv(w, tmp);
+
+	// 4. Calculate u_1 = zw \pmod{n}
+	from_words(tmp, e);
+	scalar_reduce(tmp, tmp);
+	scalar_mul(tmp, tmp, w);
+	to_words(u, tmp);
+
+	// 5. Calculate the curve point (x_1, y_1) = u_1 * G + u_2 * Q_A.
+	// p1 = u_1 * G
+	point_mult_base(&p1, u);
+
+	// 4. Calculate u_2 = rw \pmod{n}
+	scalar_mul(tmp, rl, w);
+	to_words(u, tmp);
+
+	// p2 = u_2 * Q_A
+	point_from_affine(&q, x, y);
+	point_mult(&p2, &q, u);
+
+	point_add(&p1, &p1, &p2);
+	point_to_affine(x1, y1, &p1);
+
+	// 6. The signature is valid if r = x_1 \pmod{n}
+	from_words(tmp, x1);
+	scalar_reduce(tmp, tmp);
+	return memcmp(tmp, rl, sizeof(tmp)) ? -1 : 0;
+}
+
+int ecc_is_valid_key(const uint32_t * priv_key)
+{
+	limb_t k[LIMBS];
+	limb_t t[LIMBS];
+
+	from_words(k, priv_key);
+	return limbs_sub(t, k, ecc_n.m) == 1;
+}
+
+/*
+ * This exports the low level functions so the tests can use them.
+ * In real use the compiler is now bale to optimice the code better.
+ * The field functions are the 32 bit reference implementation the
+ * curve arithmetic above replaced.
+ */
+#ifdef TEST_INCLUDE
+
 static uint32_t add( const uint32_t *x, const uint32_t *y, uint32_t *result, uint8_t length){
 	uint64_t d = 0; //carry
 	int v = 0;
@@ -90,21 +789,12 @@ static const uint32_t ecc_order_m[9] = {0xFC632551, 0xF3B9CAC2, 0xA7179E84, 0xBC
 					0xFFFFFFFF, 0xFFFFFFFF, 0x00000000, 0xFFFFFFFF,
 					0x00000000};
 
-static const uint32_t ecc_order_r[8] = {0x039CDAAF, 0x0C46353D, 0x58E8617B, 0x43190552,
-					0x00000000, 0x00000000, 0xFFFFFFFF, 0x00000000};
-
 static const uint32_t ecc_order_mu[9] = {0xEEDF9BFE, 0x012FFD85, 0xDF1A6C21, 0x43190552,
 					 0xFFFFFFFF, 0xFFFFFFFE, 0xFFFFFFFF, 0x00000000,
 					 0x00000001};
 
 static const uint8_t ecc_order_k = 8;
 
-const uint32_t ecc_g_point_x[8] = { 0xD898C296, 0xF4A13945, 0x2DEB33A0, 0x77037D81,
-				    0x63A440F2, 0xF8BCE6E5, 0xE12C4247, 0x6B17D1F2};
-const uint32_t ecc_g_point_y[8] = { 0x37BF51F5, 0xCBB64068, 0x6B315ECE, 0x2BCE3357,
-				    0x7C0F9E16, 0x8EE7EB4A, 0xFE1A7F9B, 0x4FE342E2};
-
-
 static void setZero(uint32_t *A, const int length){
 	memset(A, 0x0, length * sizeof(uint32_t));
 }
@@ -311,14 +1001,6 @@ static int isOne(const uint32_t* A){
 		return 0;
 }
 
-static int isZero(const uint32_t* A){
-	uint8_t n, r=0;
-	for(n=0;n<8;n++){
-		if (A[n] == 0) r++;
-	}
-	return r==8;
-}
-
 static void rshift(uint32_t* A){
 	int n, i;
 	uint32_t nOld = 0;
@@ -408,236 +1090,6 @@ static void fieldInv(const uint32_t *A, const uint32_t *modulus, const uint32_t
 	}
 }
 
-void static ec_double(const uint32_t *px, const uint32_t *py, uint32_t *Dx, uint32_t *Dy){
-	uint32_t tempA[8];
-	uint32_t tempB[8];
-	uint32_t tempC[8];
-	uint32_t tempD[16];
-
-	if(isZero(px) && isZero(py)){
-		copy(px, Dx,arrayLength);
-		copy(py, Dy,arrayLength);
-		return;
-	}
-
-	fieldMult(px, px, tempD, arrayLength);
-	fieldModP(tempA, tempD);
-	setZero(tempB, 8);
-	tempB[0] = 0x00000001;
-	fieldSub(tempA, tempB, ecc_prime_m, tempC); //tempC = (qx^2-1)
-	tempB[0] = 0x00000003;
-	fieldMult(tempC, tempB, tempD, arrayLength);
-	fieldModP(tempA, tempD);//tempA = 3*(qx^2-1)
-	fieldAdd(py, py, ecc_prime_r, tempB); //tempB = 2*qy
-	fieldInv(tempB, ecc_prime_m, ecc_prime_r, tempC); //tempC = 1/(2*qy)
-	fieldMult(tempA, tempC, tempD, arrayLength); //tempB = lambda = (3*(qx^2-1))/(2*qy)
-	fieldModP(tempB, tempD);
-
-	fieldMult(tempB, tempB, tempD, arrayLength); //tempC = lambda^2
-	fieldModP(tempC, tempD);
-	fieldSub(tempC, px, ecc_prime_m, tempA); //lambda^2 - Px
-	fieldSub(tempA, px, ecc_prime_m, Dx); //lambda^2 - Px - Qx
-
-	fieldSub(px, Dx, ecc_prime_m, tempA); //tempA = qx-dx
-	fieldMult(tempB, tempA, tempD, arrayLength); //tempC = lambda * (qx-dx)
-	fieldModP(tempC, tempD);
-	fieldSub(tempC, py, ecc_prime_m, Dy); //Dy = lambda * (qx-dx) - px
-}
-
-void static ec_add(const uint32_t *px, const uint32_t *py, const uint32_t *qx, const uint32_t *qy, uint32_t *Sx, uint32_t *Sy){
-	uint32_t tempA[8];
-	uint32_t tempB[8];
-	uint32_t tempC[8];
-	uint32_t tempD[16];
-
-	if(isZero(px) && isZero(py)){
-		copy(qx, Sx,arrayLength);
-		copy(qy, Sy,arrayLength);
-		return;
-	} else if(isZero(qx) && isZero(qy)) {
-		copy(px, Sx,arrayLength);
-		copy(py, Sy,arrayLength);
-		return;
-	}
-
-	if(isSame(px, qx, arrayLength)){
-		if(!isSame(py, qy, arrayLength)){
-			setZero(Sx, 8);
-			setZero(Sy, 8);
-			return;
-		} else {
-			ec_double(px, py, Sx, Sy);
-			return;
-		}
-	}
-
-	fieldSub(py, qy, ecc_prime_m, tempA);
-	fieldSub(px, qx, ecc_prime_m, tempB);
-	fieldInv(tempB, ecc_prime_m, ecc_prime_r, tempB);
-	fieldMult(tempA, tempB, tempD, arrayLength); 
-	fieldModP(tempC, tempD); //tempC = lambda
-
-	fieldMult(tempC, tempC, tempD, arrayLength); //tempA = lambda^2
-	fieldModP(tempA, tempD);
-	fieldSub(tempA, px, ecc_prime_m, tempB); //lambda^2 - Px
-	fieldSub(tempB, qx, ecc_prime_m, Sx); //lambda^2 - Px - Qx
-
-	fieldSub(qx, Sx, ecc_prime_m, tempB);
-	fieldMult(tempC, tempB, tempD, arrayLength);
-	fieldModP(tempC, tempD);
-	fieldSub(tempC, qy, ecc_prime_m, Sy);
-}
-
-void ecc_ec_mult(const uint32_t *px, const uint32_t *py, const uint32_t *secret, uint32_t *resultx, uint32_t *resulty){
-	uint32_t Qx[8];
-	uint32_t Qy[8];
-	setZero(Qx, 8);
-	setZero(Qy, 8);
-
-	uint32_t tempx[8];
-	uint32_t tempy[8];
-
-	int i;
-	for (i = 256;i--;){
-		ec_double(Qx, Qy, tempx, tempy);
-		copy(tempx, Qx,arrayLength);
-		copy(tempy, Qy,arrayLength);
-		if (((secret[i / 32]) & ((uint32_t)1 << (i % 32)))) {
-			ec_add(Qx, Qy, px, py, tempx, tempy); //eccAdd
-			copy(tempx, Qx,arrayLength);
-			copy(tempy, Qy,arrayLength);
-		}
-	}
-	copy(Qx, resultx,arrayLength);
-	copy(Qy, resulty,arrayLength);
-}
-
-/**
- * Calculate the ecdsa signature.
- *
- * For a description of this algorithm see
- * https://en.wikipedia.org/wiki/Elliptic_Curve_DSA#Signature_generation_algorithm
- *
- * input:
- *  d: private key on the curve secp256r1 (32 bytes)
- *  e: hash to sign (32 bytes)
- *  k: random data, this must be changed for every signature (32 bytes)
- *
- * output:
- *  r: r value of the signature (36 bytes)
- *  s: s value of the signature (36 bytes)
- *
- * return:
- *   0: everything is ok
- *  -1: can not create signature, try again with different k.
- */
-int ecc_ecdsa_sign_hash(const uint32_t *d, const uint32_t *e, const uint32_t *k, uint32_t *r, uint32_t *s)
-{
-	uint32_t tmp1[16];
-	uint32_t tmp2[9];
-	uint32_t tmp3[9];
-
-	if (isZero(k))
-		return -1;
-
-	// 4. Calculate the curve point (x_1, y_1) = k * G.
-	ecc_ec_mult(ecc_g_point_x, ecc_g_point_y, k, r, tmp1);
-
-	// 5. Calculate r = x_1 \pmod{n}.
-	fieldModO(r, r, 8);
-
-	// 5. If r = 0, go back to step 3.
-	if (isZero(r))
-		return -1;
-
-	// 6. Calculate s = k^{-1}(z + r d_A) \pmod{n}.
-	// 6. r * d
-	fieldMult(r, d, tmp1, arrayLength);
-	fieldModO(tmp1, tmp2, 16);
-
-	// 6. z + (r d)
-	tmp1[8] = add(e, tmp2, tmp1, 8);
-	fieldModO(tmp1, tmp3, 9);
-
-	// 6. k^{-1}
-	fieldInv(k, ecc_order_m, ecc_order_r, tmp2);
-
-	// 6. (k^{-1}) (z + (r d))
-	fieldMult(tmp2, tmp3, tmp1, arrayLength);
-	fieldModO(tmp1, s, 16);
-
-	// 6. If s = 0, go back to step 3.
-	if (isZero(s))
-		return -1;
-
-	return 0;
-}
-
-/**
- * Verifies a ecdsa signature.
- *
- * For a description of this algorithm see
- * https://en.wikipedia.org/wiki/Elliptic_Curve_DSA#Signature_verification_algorithm
- *
- * input:
- *  x: x coordinate of the public key (32 bytes)
- *  y: y coordinate of the public key (32 bytes)
- *  e: hash to verify the signature of (32 bytes)
- *  r: r value of the signature (32 bytes)
- *  s: s value of the signature (32 bytes)
- *
- * return:
- *  0: signature is ok
- *  -1: signature check failed the signature is invalid
- */
-int ecc_ecdsa_validate(const uint32_t *x, const uint32_t *y, const uint32_t *e, const uint32_t *r, const uint32_t *s)
-{
-	uint32_t w[8];
-	uint32_t tmp[16];
-	uint32_t u1[9];
-	uint32_t u2[9];
-	uint32_t tmp1_x[8];
-	uint32_t tmp1_y[8];
-	uint32_t tmp2_x[8];
-	uint32_t tmp2_y[8];
-	uint32_t tmp3_x[8];
-	uint32_t tmp3_y[8];
-
-	// 3. Calculate w = s^{-1} \pmod{n}
-	fieldInv(s, ecc_order_m, ecc_order_r, w);
-
-	// 4. Calculate u_1 = zw \pmod{n}
-	fieldMult(e, w, tmp, arrayLength);
-	fieldModO(tmp, u1, 16);
-
-	// 4. Calculate u_2 = rw \pmod{n}
-	fieldMult(r, w, tmp, arrayLength);
-	fieldModO(tmp, u2, 16);
-
-	// 5. Calculate the curve point (x_1, y_1) = u_1 * G + u_2 * Q_A.
-	// tmp1 = u_1 * G
-	ecc_ec_mult(ecc_g_point_x, ecc_g_point_y, u1, tmp1_x, tmp1_y);
-
-	// tmp2 = u_2 * Q_A
-	ecc_ec_mult(x, y, u2, tmp2_x, tmp2_y);
-
-	// tmp3 = tmp1 + tmp2
-	ec_add(tmp1_x, tmp1_y, tmp2_x, tmp2_y, tmp3_x, tmp3_y);
-	// TODO: this u_1 * G + u_2 * Q_A  could be optimiced with Straus's algorithm.
-
-	return isSame(tmp3_x, r, arrayLength) ? 0 : -1;
-}
-
-int ecc_is_valid_key(const uint32_t * priv_key)
-{
-	return isGreater(ecc_order_m, priv_key, arrayLength) == 1;
-}
-
-/*
- * This exports the low level functions so the tests can use them.
- * In real use the compiler is now bale to optimice the code better.
- */
-#ifdef TEST_INCLUDE
 uint32_t ecc_add( const uint32_t *x, const uint32_t *y, uint32_t *result, uint8_t length)
 {
 	return add(x, y, result, length);
@@ -697,11 +1149,20 @@ int ecc_isGreater(const uint32_t *A, const uint32_t *B, uint8_t length)
 
 void ecc_ec_add(const uint32_t *px, const uint32_t *py, const uint32_t *qx, const uint32_t *qy, uint32_t *Sx, uint32_t *Sy)
 {
-	ec_add(px, py, qx, qy, Sx, Sy);
+	point_t p, q;
+
+	point_from_affine(&p, px, py);
+	point_from_affine(&q, qx, qy);
+	point_add(&p, &p, &q);
+	point_to_affine(Sx, Sy, &p);
 }
 void ecc_ec_double(const uint32_t *px, const uint32_t *py, uint32_t *Dx, uint32_t *Dy)
 {
-	ec_double(px, py, Dx, Dy);
+	point_t p;
+
+	point_from_affine(&p, px, py);
+	point_double(&p, &p);
+	point_to_affine(Dx, Dy, &p);
 }
 
 #endif /* TEST_INCLUDE */
@@ -171,6 +171,30 @@ dtls_session_equals(const session_t *a, const session_t *b) {
   return 0;
 }
 
+uint32_t
+dtls_session_hash(const session_t *a)
+{
+  uint32_t h = dtls_session_hash_update(DTLS_SESSION_HASH_INIT,
+                                        &a->ifindex, sizeof(a->ifindex));
+
+  /* hash the same parts of the address that dtls_session_equals() compares */
+  switch (a->addr.sa.sa_family) {
+  case AF_INET:
+    h = dtls_session_hash_update(h, &a->addr.sin.sin_port,
+                                 sizeof(a->addr.sin.sin_port));
+    return dtls_session_hash_update(h, &a->addr.sin.sin_addr,
+                                    sizeof(struct in_addr));
+  case AF_INET6:
+    h = dtls_session_hash_update(h, &a->addr.sin6.sin6_port,
+                                 sizeof(a->addr.sin6.sin6_port));
+    return dtls_session_hash_update(h, &a->addr.sin6.sin6_addr,
+                                    sizeof(struct in6_addr));
+  default:
+    ;
+  }
+  return h;
+}
+
 void *
 dtls_session_get_address(const session_t *a)
 {
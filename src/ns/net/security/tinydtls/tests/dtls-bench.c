@@ -0,0 +1,383 @@
+/* Handshake and record rate of a client and a server context that
+ * talk over an in-memory datagram queue.
+ *
+ * Full handshakes connect to a new server port each time, so that the
+ * client has no session to offer, resumed handshakes reconnect to the
+ * same port and run the abbreviated handshake. Records are sent by
+ * BENCH_PEERS clients to a single server, which looks them up in its
+ * peer table. Build the library with LOG_LEVEL_DTLS=LOG_LEVEL_NONE
+ * and DTLS_PEER_MAX (or DTLS_PEER_HASH_SIZE) set to the number of
+ * sessions to measure, e.g.
+ *
+ *   make clean all LOG_LEVEL_DTLS=LOG_LEVEL_NONE \
+ *     CFLAGS_EXTRA="-O2 -DDTLS_PEER_MAX=64"
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include "tinydtls.h"
+#include "dtls.h"
+
+#define BENCH_PSK_HANDSHAKES  2000
+#define BENCH_ECC_HANDSHAKES  20
+#define BENCH_PEERS           64
+#define BENCH_RECORDS         200000
+#define BENCH_RECORD_SIZE     64
+
+#define SERVER_PORT 20220
+#define CLIENT_PORT 30000
+
+static const unsigned char ecdsa_priv_key[] = {
+			0xD9, 0xE2, 0x70, 0x7A, 0x72, 0xDA, 0x6A, 0x05,
+			0x04, 0x99, 0x5C, 0x86, 0xED, 0xDB, 0xE3, 0xEF,
+			0xC7, 0xF1, 0xCD, 0x74, 0x83, 0x8F, 0x75, 0x70,
+			0xC8, 0x07, 0x2D, 0x0A, 0x76, 0x26, 0x1B, 0xD4};
+
+static const unsigned char ecdsa_pub_key_x[] = {
+			0xD0, 0x55, 0xEE, 0x14, 0x08, 0x4D, 0x6E, 0x06,
+			0x15, 0x59, 0x9D, 0xB5, 0x83, 0x91, 0x3E, 0x4A,
+			0x3E, 0x45, 0x26, 0xA2, 0x70, 0x4D, 0x61, 0xF2,
+			0x7A, 0x4C, 0xCF, 0xBA, 0x97, 0x58, 0xEF, 0x9A};
+
+static const unsigned char ecdsa_pub_key_y[] = {
+			0xB4, 0x18, 0xB6, 0x4A, 0xFE, 0x80, 0x30, 0xDA,
+			0x1D, 0xDC, 0xF4, 0xF4, 0x2E, 0x2F, 0x26, 0x31,
+			0xD0, 0x43, 0xB1, 0xFB, 0x03, 0xE2, 0x2F, 0x4D,
+			0x17, 0xDE, 0x43, 0xF9, 0xF9, 0xAD, 0xEE, 0x70};
+
+/* An endpoint owns one context and its own transport address. A
+ * client remembers the server address it talks to. */
+typedef struct {
+  dtls_context_t *ctx;
+  session_t addr;
+  session_t remote;
+  int connected;
+} endpoint_t;
+
+typedef struct {
+  endpoint_t *to;
+  session_t from;
+  size_t length;
+  uint8_t data[DTLS_MAX_BUF];
+} datagram_t;
+
+#define QUEUE_SIZE 32
+
+static datagram_t queue[QUEUE_SIZE];
+static unsigned int queue_head, queue_tail;
+
+static endpoint_t server;
+static endpoint_t clients[BENCH_PEERS];
+
+static unsigned long records_read;
+static unsigned long key_exchanges;
+
+static void
+set_addr(session_t *s, unsigned short port) {
+  dtls_session_init(s);
+  s->size = sizeof(struct sockaddr_in);
+  s->addr.sin.sin_family = AF_INET;
+  s->addr.sin.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  s->addr.sin.sin_port = htons(port);
+}
+
+static endpoint_t *
+client_by_addr(const session_t *s) {
+  int i;
+  for (i = 0; i < BENCH_PEERS; i++) {
+    if (dtls_session_equals(&clients[i].addr, s)) {
+      return &clients[i];
+    }
+  }
+  return NULL;
+}
+
+static int
+send_to_peer(struct dtls_context_t *ctx,
+	     session_t *session, uint8_t *data, size_t len) {
+  endpoint_t *from = dtls_get_app_data(ctx);
+  datagram_t *d;
+
+  if (queue_tail - queue_head == QUEUE_SIZE || len > DTLS_MAX_BUF) {
+    return -1;
+  }
+  d = &queue[queue_tail++ % QUEUE_SIZE];
+
+  if (from == &server) {
+    d->to = client_by_addr(session);
+    d->from = d->to->remote;
+  } else {
+    from->remote = *session;
+    d->to = &server;
+    d->from = from->addr;
+  }
+
+  /* count ClientKeyExchange messages to tell full from abbreviated
+   * handshakes */
+  if (len > sizeof(dtls_record_header_t) && data[0] == DTLS_CT_HANDSHAKE &&
+      data[3] == 0 && data[4] == 0 &&
+      data[sizeof(dtls_record_header_t)] == DTLS_HT_CLIENT_KEY_EXCHANGE) {
+    key_exchanges++;
+  }
+
+  d->length = len;
+  memcpy(d->data, data, len);
+  return len;
+}
+
+static void
+deliver(void) {
+  while (queue_head != queue_tail) {
+    datagram_t *d = &queue[queue_head++ % QUEUE_SIZE];
+    dtls_handle_message(d->to->ctx, &d->from, d->data, d->length);
+  }
+}
+
+static int
+read_from_peer(struct dtls_context_t *ctx,
+	       session_t *session, uint8_t *data, size_t len) {
+  records_read++;
+  return 0;
+}
+
+static int
+handle_event(struct dtls_context_t *ctx, session_t *session,
+	     dtls_alert_level_t level, unsigned short code) {
+  endpoint_t *e = dtls_get_app_data(ctx);
+
+  if (e != &server && level == 0 && code == DTLS_EVENT_CONNECTED) {
+    e->connected = 1;
+  }
+  return 0;
+}
+
+static int
+get_psk_info(struct dtls_context_t *ctx, const session_t *session,
+	     dtls_credentials_type_t type,
+	     const unsigned char *id, size_t id_len,
+	     unsigned char *result, size_t result_length) {
+  switch (type) {
+  case DTLS_PSK_IDENTITY:
+    memcpy(result, "Client_identity", 15);
+    return 15;
+  case DTLS_PSK_KEY:
+    memcpy(result, "secretPSK", 9);
+    return 9;
+  default:
+    return 0;
+  }
+}
+
+static int
+get_ecdsa_key(struct dtls_context_t *ctx,
+	      const session_t *session,
+	      const dtls_ecdsa_key_t **result) {
+  static const dtls_ecdsa_key_t ecdsa_key = {
+    .curve = DTLS_ECDH_CURVE_SECP256R1,
+    .priv_key = ecdsa_priv_key,
+    .pub_key_x = ecdsa_pub_key_x,
+    .pub_key_y = ecdsa_pub_key_y
+  };
+
+  *result = &ecdsa_key;
+  return 0;
+}
+
+static int
+verify_ecdsa_key(struct dtls_context_t *ctx,
+		 const session_t *session,
+		 const unsigned char *other_pub_x,
+		 const unsigned char *other_pub_y,
+		 size_t key_size) {
+  return 0;
+}
+
+static const dtls_handler_t server_handlers = {
+  .write = send_to_peer,
+  .read  = read_from_peer,
+  .event = handle_event,
+  .get_psk_info = get_psk_info,
+  .get_ecdsa_key = get_ecdsa_key,
+  .verify_ecdsa_key = verify_ecdsa_key
+};
+
+static const dtls_handler_t psk_handlers = {
+  .write = send_to_peer,
+  .read  = read_from_peer,
+  .event = handle_event,
+  .get_psk_info = get_psk_info,
+};
+
+static const dtls_handler_t ecc_handlers = {
+  .write = send_to_peer,
+  .read  = read_from_peer,
+  .event = handle_event,
+  .get_ecdsa_key = get_ecdsa_key,
+  .verify_ecdsa_key = verify_ecdsa_key
+};
+
+static double
+now_seconds(void) {
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+static int
+setup(const dtls_handler_t *client_handlers) {
+  int i;
+
+  server.ctx = dtls_new_context(&server);
+  if (!server.ctx) {
+    return -1;
+  }
+  dtls_set_handler(server.ctx, &server_handlers);
+  set_addr(&server.addr, SERVER_PORT);
+
+  for (i = 0; i < BENCH_PEERS; i++) {
+    clients[i].ctx = dtls_new_context(&clients[i]);
+    if (!clients[i].ctx) {
+      return -1;
+    }
+    dtls_set_handler(clients[i].ctx, client_handlers);
+    set_addr(&clients[i].addr, CLIENT_PORT + i);
+    clients[i].connected = 0;
+  }
+  queue_head = queue_tail = 0;
+  return 0;
+}
+
+static void
+teardown(void) {
+  int i;
+
+  for (i = 0; i < BENCH_PEERS; i++) {
+    dtls_free_context(clients[i].ctx);
+  }
+  dtls_free_context(server.ctx);
+  queue_head = queue_tail = 0;
+}
+
+/* Connects the first client to @p port and closes the connection
+ * again, returns 0 when the handshake has completed. */
+static int
+handshake(unsigned short port) {
+  endpoint_t *c = &clients[0];
+  session_t dst;
+
+  set_addr(&dst, port);
+  c->connected = 0;
+  dtls_connect(c->ctx, &dst);
+  deliver();
+  if (!c->connected) {
+    return -1;
+  }
+  dtls_close(c->ctx, &dst);
+  deliver();
+  return 0;
+}
+
+/* Runs @p count full and @p count resumed handshakes and returns the
+ * number of failures. */
+static int
+bench_handshakes(const char *name, const dtls_handler_t *client_handlers,
+		 int count) {
+  double start, full, resumed;
+  unsigned long full_kx, resumed_kx;
+  int i, failed = 0;
+
+  if (setup(client_handlers) < 0) {
+    printf("%s: cannot create contexts\n", name);
+    return 1;
+  }
+
+  key_exchanges = 0;
+  start = now_seconds();
+  for (i = 0; i < count; i++) {
+    failed += handshake(SERVER_PORT + 1 + i) != 0;
+  }
+  full = now_seconds() - start;
+  full_kx = key_exchanges;
+
+  /* the first reconnect stores the session for this port */
+  failed += handshake(SERVER_PORT) != 0;
+
+  key_exchanges = 0;
+  start = now_seconds();
+  for (i = 0; i < count; i++) {
+    failed += handshake(SERVER_PORT) != 0;
+  }
+  resumed = now_seconds() - start;
+  resumed_kx = key_exchanges;
+
+  teardown();
+
+  printf("%s: full %.0f handshakes/s, resumed %.0f handshakes/s (%.1fx)\n",
+	 name, count / full, count / resumed, full / resumed);
+
+  /* every full handshake has one key exchange, resumed ones have none */
+  if (full_kx != count || resumed_kx != 0) {
+    printf("%s: %lu key exchanges in %d full handshakes, %lu in resumed ones\n",
+	   name, full_kx, count, resumed_kx);
+    failed++;
+  }
+  return failed;
+}
+
+/* Sends records from BENCH_PEERS clients in turn and returns the
+ * number of failures. */
+static int
+bench_records(void) {
+  uint8_t buf[BENCH_RECORD_SIZE];
+  double start, elapsed;
+  int i, failed = 0;
+
+  if (setup(&psk_handlers) < 0) {
+    printf("records: cannot create contexts\n");
+    return 1;
+  }
+
+  for (i = 0; i < BENCH_PEERS; i++) {
+    dtls_connect(clients[i].ctx, &server.addr);
+    deliver();
+    failed += !clients[i].connected;
+  }
+
+  memset(buf, 'x', sizeof(buf));
+  records_read = 0;
+  start = now_seconds();
+  for (i = 0; i < BENCH_RECORDS; i++) {
+    endpoint_t *c = &clients[i % BENCH_PEERS];
+    dtls_write(c->ctx, &c->remote, buf, sizeof(buf));
+    deliver();
+  }
+  elapsed = now_seconds() - start;
+
+  teardown();
+
+  printf("records: %d peers, %d buckets, %.0f records/s of %d bytes\n",
+	 BENCH_PEERS, DTLS_PEER_HASH_SIZE, BENCH_RECORDS / elapsed,
+	 BENCH_RECORD_SIZE);
+
+  if (records_read != BENCH_RECORDS) {
+    printf("records: %lu of %d records read\n", records_read, BENCH_RECORDS);
+    failed++;
+  }
+  return failed;
+}
+
+int
+main(int argc, char **argv) {
+  int failed = 0;
+
+  dtls_init();
+
+  failed += bench_handshakes("psk", &psk_handlers, BENCH_PSK_HANDSHAKES);
+  failed += bench_handshakes("ecdhe", &ecc_handlers, BENCH_ECC_HANDSHAKES);
+  failed += bench_records();
+
+  printf("dtls bench: -------- %s\n", failed ? "FAIL" : "SUCCESS");
+  return failed != 0;
+}
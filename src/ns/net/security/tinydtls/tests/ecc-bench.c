@@ -0,0 +1,164 @@
+/* Rate of the P-256 operations a DTLS ECDHE_ECDSA handshake uses.
+ *
+ * Key generation multiplies the base point, ECDH multiplies a peer's
+ * point, signing does one base point multiplication and verifying
+ * one of each. Before timing, the public key of a known private key
+ * is checked, both sides of an ECDH exchange must agree and every
+ * signature must verify, and fail once the hash is changed.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include "ecc/ecc.h"
+
+#define BENCH_ECC_ROUNDS  200
+
+static const unsigned char ecdsa_priv_key[] = {
+			0xD9, 0xE2, 0x70, 0x7A, 0x72, 0xDA, 0x6A, 0x05,
+			0x04, 0x99, 0x5C, 0x86, 0xED, 0xDB, 0xE3, 0xEF,
+			0xC7, 0xF1, 0xCD, 0x74, 0x83, 0x8F, 0x75, 0x70,
+			0xC8, 0x07, 0x2D, 0x0A, 0x76, 0x26, 0x1B, 0xD4};
+
+static const unsigned char ecdsa_pub_key_x[] = {
+			0xD0, 0x55, 0xEE, 0x14, 0x08, 0x4D, 0x6E, 0x06,
+			0x15, 0x59, 0x9D, 0xB5, 0x83, 0x91, 0x3E, 0x4A,
+			0x3E, 0x45, 0x26, 0xA2, 0x70, 0x4D, 0x61, 0xF2,
+			0x7A, 0x4C, 0xCF, 0xBA, 0x97, 0x58, 0xEF, 0x9A};
+
+static const unsigned char ecdsa_pub_key_y[] = {
+			0xB4, 0x18, 0xB6, 0x4A, 0xFE, 0x80, 0x30, 0xDA,
+			0x1D, 0xDC, 0xF4, 0xF4, 0x2E, 0x2F, 0x26, 0x31,
+			0xD0, 0x43, 0xB1, 0xFB, 0x03, 0xE2, 0x2F, 0x4D,
+			0x17, 0xDE, 0x43, 0xF9, 0xF9, 0xAD, 0xEE, 0x70};
+
+/* The ecc functions take the least significant word first. */
+static void
+key_to_words(const unsigned char *key, uint32_t *result) {
+  int i;
+
+  for (i = 0; i < 8; i++) {
+    const unsigned char *p = key + 28 - 4 * i;
+    result[i] = (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 |
+                (uint32_t)p[2] << 8 | p[3];
+  }
+}
+
+static void
+random_key(uint32_t *key) {
+  int i;
+
+  do {
+    for (i = 0; i < 8; i++)
+      key[i] = (uint32_t)rand() << 16 ^ (uint32_t)rand();
+  } while (!ecc_is_valid_key(key));
+}
+
+static double
+now_seconds(void) {
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+static uint32_t priv[BENCH_ECC_ROUNDS][8];
+static uint32_t pub_x[BENCH_ECC_ROUNDS][8], pub_y[BENCH_ECC_ROUNDS][8];
+static uint32_t hash[BENCH_ECC_ROUNDS][8], nonce[BENCH_ECC_ROUNDS][8];
+/* signing takes a spare word in r and s, as in dtls-crypto.c */
+static uint32_t sig_r[BENCH_ECC_ROUNDS][9], sig_s[BENCH_ECC_ROUNDS][9];
+
+/* Checks the results against a known key pair and each other and
+ * returns the number of failures. */
+static int
+check(void) {
+  uint32_t d[8], x[8], y[8], ex[8], ey[8];
+  uint32_t ax[8], ay[8], bx[8], by[8];
+  int failed = 0;
+  int i;
+
+  key_to_words(ecdsa_priv_key, d);
+  key_to_words(ecdsa_pub_key_x, ex);
+  key_to_words(ecdsa_pub_key_y, ey);
+  ecc_gen_pub_key(d, x, y);
+  if (memcmp(x, ex, sizeof(x)) || memcmp(y, ey, sizeof(y))) {
+    printf("ecc: wrong public key for the known private key\n");
+    failed++;
+  }
+
+  for (i = 0; i + 1 < BENCH_ECC_ROUNDS; i++) {
+    ecc_ecdh(pub_x[i + 1], pub_y[i + 1], priv[i], ax, ay);
+    ecc_ecdh(pub_x[i], pub_y[i], priv[i + 1], bx, by);
+    if (memcmp(ax, bx, sizeof(ax)) || memcmp(ay, by, sizeof(ay))) {
+      printf("ecc: ECDH secrets differ in round %d\n", i);
+      failed++;
+    }
+  }
+
+  for (i = 0; i < BENCH_ECC_ROUNDS; i++) {
+    if (ecc_ecdsa_validate(pub_x[i], pub_y[i], hash[i],
+                           sig_r[i], sig_s[i]) != 0) {
+      printf("ecc: signature %d does not verify\n", i);
+      failed++;
+    }
+    hash[i][0] ^= 1;
+    if (ecc_ecdsa_validate(pub_x[i], pub_y[i], hash[i],
+                           sig_r[i], sig_s[i]) == 0) {
+      printf("ecc: signature %d verifies a different hash\n", i);
+      failed++;
+    }
+    hash[i][0] ^= 1;
+  }
+  return failed;
+}
+
+int
+main(void) {
+  uint32_t x[8], y[8];
+  double start, keygen, ecdh, sign, verify;
+  int failed = 0;
+  int i;
+
+  srand(1);
+  for (i = 0; i < BENCH_ECC_ROUNDS; i++) {
+    random_key(priv[i]);
+    random_key(hash[i]);
+  }
+
+  start = now_seconds();
+  for (i = 0; i < BENCH_ECC_ROUNDS; i++)
+    ecc_gen_pub_key(priv[i], pub_x[i], pub_y[i]);
+  keygen = now_seconds() - start;
+
+  start = now_seconds();
+  for (i = 0; i < BENCH_ECC_ROUNDS; i++)
+    ecc_ecdh(pub_x[(i + 1) % BENCH_ECC_ROUNDS], pub_y[(i + 1) % BENCH_ECC_ROUNDS],
+             priv[i], x, y);
+  ecdh = now_seconds() - start;
+
+  start = now_seconds();
+  for (i = 0; i < BENCH_ECC_ROUNDS; i++) {
+    /* a nonce that gives r or s of zero must be replaced */
+    do {
+      random_key(nonce[i]);
+    } while (ecc_ecdsa_sign_hash(priv[i], hash[i], nonce[i],
+                                 sig_r[i], sig_s[i]) != 0);
+  }
+  sign = now_seconds() - start;
+
+  start = now_seconds();
+  for (i = 0; i < BENCH_ECC_ROUNDS; i++)
+    failed += ecc_ecdsa_validate(pub_x[i], pub_y[i], hash[i],
+                                 sig_r[i], sig_s[i]) != 0;
+  verify = now_seconds() - start;
+
+  printf("ecc: keygen %.0f/s, ECDH %.0f/s, sign %.0f/s, verify %.0f/s\n",
+         BENCH_ECC_ROUNDS / keygen, BENCH_ECC_ROUNDS / ecdh,
+         BENCH_ECC_ROUNDS / sign, BENCH_ECC_ROUNDS / verify);
+
+  failed += check();
+
+  printf("ecc bench: -------- %s\n", failed ? "FAIL" : "SUCCESS");
+  return failed != 0;
+}
@@ -24,6 +24,8 @@ SRC_NS_SYS += $(addprefix ns/sys/,\
 
 SRC_NS_LIB += $(addprefix ns/lib/,\
     aes-128.c \
+    aes-128-ni.c \
+    aes-128-ttable.c \
     assert.c \
     ccm-star.c \
     circular-list.c \
@@ -147,6 +149,7 @@ SRC_NS_NET_IPV6 += $(addprefix ns/net/ipv6/,\
     tcpip.c \
     udp-socket.c \
     uip-ds6-nbr.c \
+    uip-ds6-route-lpm.c \
     uip-ds6-route.c \
     uip-ds6.c \
     uip-icmp6.c \
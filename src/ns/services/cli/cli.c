@@ -117,7 +117,14 @@ static void command_ps(int argc, char *argv[])
     struct process *p;
     cli_uart_output_format("Process list:\r\n");
     for (p = process_list; p != NULL; p = p->next) {
+#if PROCESS_CONF_STATS
+        cli_uart_output_format("-- %-24s calls %-8lu time %lu ms\r\n", p->name,
+                               PROCESS_STATS_CALLS(p),
+                               (unsigned long)((unsigned long long)PROCESS_STATS_RUNTIME(p) *
+                                               1000 / CLOCK_SECOND));
+#else
         cli_uart_output_format("-- %s\r\n", p->name);
+#endif
     }
 }
 
@@ -45,7 +45,9 @@
 #include "sys/ctimer.h"
 #include "contiki.h"
 #include "lib/list.h"
+#include <stddef.h>
 
+/* Callback timers set before ctimer_process has started */
 LIST(ctimer_list);
 
 static char initialized;
@@ -65,28 +67,38 @@ PROCESS_THREAD(ctimer_process, ev, data)
   struct ctimer *c;
   PROCESS_BEGIN();
 
-  for(c = list_head(ctimer_list); c != NULL; c = c->next) {
+  while((c = list_pop(ctimer_list)) != NULL) {
     etimer_set(&c->etimer, c->etimer.timer.interval);
   }
   initialized = 1;
 
   while(1) {
     PROCESS_YIELD_UNTIL(ev == PROCESS_EVENT_TIMER);
-    for(c = list_head(ctimer_list); c != NULL; c = c->next) {
-      if(&c->etimer == data) {
-	list_remove(ctimer_list, c);
-	PROCESS_CONTEXT_BEGIN(c->p);
-	if(c->f != NULL) {
-	  c->f(c->ptr);
-	}
-	PROCESS_CONTEXT_END(c->p);
-	break;
+    /* Only ctimers post timer events to this process, so the fired
+       ctimer is found directly from its etimer. The event of a ctimer
+       that is stopped or set again is removed from the queue, so the
+       ctimer is still there; a reset timer may just not be due yet. */
+    c = (struct ctimer *)((char *)data - offsetof(struct ctimer, etimer));
+    if(c->armed && etimer_expired(&c->etimer)) {
+      c->armed = 0;
+      PROCESS_CONTEXT_BEGIN(c->p);
+      if(c->f != NULL) {
+        c->f(c->ptr);
       }
+      PROCESS_CONTEXT_END(c->p);
     }
   }
   PROCESS_END();
 }
 /*---------------------------------------------------------------------------*/
+/* Forget a timer event already posted for the ctimer, the ctimer may
+   be gone by the time it would be received */
+static void
+cancel_event(struct ctimer *c)
+{
+  process_cancel(&ctimer_process, PROCESS_EVENT_TIMER, &c->etimer);
+}
+/*---------------------------------------------------------------------------*/
 void
 ctimer_init(void)
 {
@@ -110,39 +122,44 @@ ctimer_set_with_process(struct ctimer *c, clock_time_t t,
   c->p = p;
   c->f = f;
   c->ptr = ptr;
+  c->armed = 1;
   if(initialized) {
+    cancel_event(c);
     PROCESS_CONTEXT_BEGIN(&ctimer_process);
     etimer_set(&c->etimer, t);
     PROCESS_CONTEXT_END(&ctimer_process);
   } else {
     c->etimer.timer.interval = t;
+    list_add(ctimer_list, c);
   }
-
-  list_add(ctimer_list, c);
 }
 /*---------------------------------------------------------------------------*/
 void
 ctimer_reset(struct ctimer *c)
 {
   if(initialized) {
+    cancel_event(c);
     PROCESS_CONTEXT_BEGIN(&ctimer_process);
     etimer_reset(&c->etimer);
     PROCESS_CONTEXT_END(&ctimer_process);
+  } else {
+    list_add(ctimer_list, c);
   }
-
-  list_add(ctimer_list, c);
+  c->armed = 1;
 }
 /*---------------------------------------------------------------------------*/
 void
 ctimer_restart(struct ctimer *c)
 {
   if(initialized) {
+    cancel_event(c);
     PROCESS_CONTEXT_BEGIN(&ctimer_process);
     etimer_restart(&c->etimer);
     PROCESS_CONTEXT_END(&ctimer_process);
+  } else {
+    list_add(ctimer_list, c);
   }
-
-  list_add(ctimer_list, c);
+  c->armed = 1;
 }
 /*---------------------------------------------------------------------------*/
 void
@@ -150,26 +167,22 @@ ctimer_stop(struct ctimer *c)
 {
   if(initialized) {
     etimer_stop(&c->etimer);
+    cancel_event(c);
   } else {
     c->etimer.next = NULL;
     c->etimer.p = PROCESS_NONE;
+    list_remove(ctimer_list, c);
   }
-  list_remove(ctimer_list, c);
+  c->armed = 0;
 }
 /*---------------------------------------------------------------------------*/
 int
 ctimer_expired(struct ctimer *c)
 {
-  struct ctimer *t;
   if(initialized) {
     return etimer_expired(&c->etimer);
   }
-  for(t = list_head(ctimer_list); t != NULL; t = t->next) {
-    if(t == c) {
-      return 0;
-    }
-  }
-  return 1;
+  return !c->armed;
 }
 /*---------------------------------------------------------------------------*/
 /** @} */
@@ -63,6 +63,7 @@ struct ctimer {
   struct process *p;
   void (*f)(void *);
   void *ptr;
+  char armed;
 };
 
 /**
@@ -140,6 +141,8 @@ void ctimer_set_with_process(struct ctimer *c, clock_time_t t,
  *             been set with ctimer_set(), ctimer_reset(), or ctimer_restart().
  *             After this function has been called, the callback timer will be
  *             expired and will not call the callback function.
+ *             The callback timer may be freed once this function returns,
+ *             even if it had already expired.
  *
  */
 void ctimer_stop(struct ctimer *c);
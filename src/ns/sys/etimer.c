@@ -52,8 +52,113 @@
 static struct etimer *timerlist;
 static clock_time_t next_expiration;
 
+#if ETIMER_HEAP_SIZE
+static struct etimer *heap[ETIMER_HEAP_SIZE];
+static unsigned short heap_len;
+#endif /* ETIMER_HEAP_SIZE */
+
 PROCESS(etimer_process, "Event timer");
 /*---------------------------------------------------------------------------*/
+#if ETIMER_HEAP_SIZE
+/* True if a expires before b, taking clock wraps into account */
+static int
+expires_before(struct etimer *a, struct etimer *b)
+{
+  clock_time_t diff = etimer_expiration_time(a) - etimer_expiration_time(b);
+  return diff > ((clock_time_t)~0 >> 1);
+}
+/*---------------------------------------------------------------------------*/
+static int
+heap_contains(struct etimer *t)
+{
+  return t->heap_index < heap_len && heap[t->heap_index] == t;
+}
+/*---------------------------------------------------------------------------*/
+static void
+heap_place(struct etimer *t, unsigned short i)
+{
+  heap[i] = t;
+  t->heap_index = i;
+}
+/*---------------------------------------------------------------------------*/
+static void
+heap_sift_up(unsigned short i)
+{
+  struct etimer *t = heap[i];
+
+  while(i > 0) {
+    unsigned short parent = (i - 1) / 2;
+    if(!expires_before(t, heap[parent])) {
+      break;
+    }
+    heap_place(heap[parent], i);
+    i = parent;
+  }
+  heap_place(t, i);
+}
+/*---------------------------------------------------------------------------*/
+static void
+heap_sift_down(unsigned short i)
+{
+  struct etimer *t = heap[i];
+
+  while(1) {
+    unsigned short child = 2 * i + 1;
+    if(child >= heap_len) {
+      break;
+    }
+    if(child + 1 < heap_len && expires_before(heap[child + 1], heap[child])) {
+      child++;
+    }
+    if(!expires_before(heap[child], t)) {
+      break;
+    }
+    heap_place(heap[child], i);
+    i = child;
+  }
+  heap_place(t, i);
+}
+/*---------------------------------------------------------------------------*/
+/* Restore the heap order after the expiration time of heap[i] changed */
+static void
+heap_update(unsigned short i)
+{
+  if(i > 0 && expires_before(heap[i], heap[(i - 1) / 2])) {
+    heap_sift_up(i);
+  } else {
+    heap_sift_down(i);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+heap_remove(unsigned short i)
+{
+  heap_len--;
+  if(i != heap_len) {
+    heap_place(heap[heap_len], i);
+    heap_update(i);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+update_time(void)
+{
+  struct etimer *first = NULL;
+  struct etimer *t;
+
+  if(heap_len > 0) {
+    first = heap[0];
+  }
+  /* Timers that didn't fit in the heap */
+  for(t = timerlist; t != NULL; t = t->next) {
+    if(first == NULL || expires_before(t, first)) {
+      first = t;
+    }
+  }
+  next_expiration = first != NULL ? etimer_expiration_time(first) : 0;
+}
+#else /* ETIMER_HEAP_SIZE */
+/*---------------------------------------------------------------------------*/
 static void
 update_time(void)
 {
@@ -76,14 +181,21 @@ update_time(void)
     next_expiration = now + tdist;
   }
 }
+#endif /* ETIMER_HEAP_SIZE */
 /*---------------------------------------------------------------------------*/
 PROCESS_THREAD(etimer_process, ev, data)
 {
   struct etimer *t, *u;
+#if ETIMER_HEAP_SIZE
+  unsigned short i, n;
+#endif /* ETIMER_HEAP_SIZE */
 	
   PROCESS_BEGIN();
 
   timerlist = NULL;
+#if ETIMER_HEAP_SIZE
+  heap_len = 0;
+#endif /* ETIMER_HEAP_SIZE */
   
   while(1) {
     PROCESS_YIELD();
@@ -91,6 +203,19 @@ PROCESS_THREAD(etimer_process, ev, data)
     if(ev == PROCESS_EVENT_EXITED) {
       struct process *p = data;
 
+#if ETIMER_HEAP_SIZE
+      /* Drop the timers of the exited process and rebuild the heap */
+      for(i = 0, n = 0; i < heap_len; i++) {
+        if(heap[i]->p != p) {
+          heap_place(heap[i], n++);
+        }
+      }
+      heap_len = n;
+      for(i = heap_len / 2; i > 0; i--) {
+        heap_sift_down(i - 1);
+      }
+#endif /* ETIMER_HEAP_SIZE */
+
       while(timerlist != NULL && timerlist->p == p) {
 	timerlist = timerlist->next;
       }
@@ -104,11 +229,27 @@ PROCESS_THREAD(etimer_process, ev, data)
 	    t = t->next;
 	}
       }
+      update_time();
       continue;
     } else if(ev != PROCESS_EVENT_POLL) {
       continue;
     }
 
+#if ETIMER_HEAP_SIZE
+    /* Expired timers are at the top of the heap */
+    while(heap_len > 0 && timer_expired(&heap[0]->timer)) {
+      t = heap[0];
+      if(process_post(t->p, PROCESS_EVENT_TIMER, t) == PROCESS_ERR_OK) {
+        t->p = PROCESS_NONE;
+        heap_remove(0);
+        update_time();
+      } else {
+        etimer_request_poll();
+        break;
+      }
+    }
+#endif /* ETIMER_HEAP_SIZE */
+
   again:
     
     u = NULL;
@@ -155,6 +296,15 @@ add_timer(struct etimer *timer)
   etimer_request_poll();
 
   if(timer->p != PROCESS_NONE) {
+#if ETIMER_HEAP_SIZE
+    if(heap_contains(timer)) {
+      /* Timer already in the heap, move it to its new position. */
+      timer->p = PROCESS_CURRENT();
+      heap_update(timer->heap_index);
+      update_time();
+      return;
+    }
+#endif /* ETIMER_HEAP_SIZE */
     for(t = timerlist; t != NULL; t = t->next) {
       if(t == timer) {
 	/* Timer already on list, bail out. */
@@ -165,8 +315,18 @@ add_timer(struct etimer *timer)
     }
   }
 
-  /* Timer not on list. */
   timer->p = PROCESS_CURRENT();
+
+#if ETIMER_HEAP_SIZE
+  if(heap_len < ETIMER_HEAP_SIZE) {
+    heap_place(timer, heap_len++);
+    heap_sift_up(timer->heap_index);
+    update_time();
+    return;
+  }
+#endif /* ETIMER_HEAP_SIZE */
+
+  /* Timer not on list. */
   timer->next = timerlist;
   timerlist = timer;
 
@@ -206,6 +366,11 @@ void
 etimer_adjust(struct etimer *et, int timediff)
 {
   et->timer.start += timediff;
+#if ETIMER_HEAP_SIZE
+  if(heap_contains(et)) {
+    heap_update(et->heap_index);
+  }
+#endif /* ETIMER_HEAP_SIZE */
   update_time();
 }
 /*---------------------------------------------------------------------------*/
@@ -230,6 +395,11 @@ etimer_start_time(struct etimer *et)
 int
 etimer_pending(void)
 {
+#if ETIMER_HEAP_SIZE
+  if(heap_len > 0) {
+    return 1;
+  }
+#endif /* ETIMER_HEAP_SIZE */
   return timerlist != NULL;
 }
 /*---------------------------------------------------------------------------*/
@@ -244,6 +414,12 @@ etimer_stop(struct etimer *et)
 {
   struct etimer *t;
 
+#if ETIMER_HEAP_SIZE
+  if(heap_contains(et)) {
+    heap_remove(et->heap_index);
+    update_time();
+  } else
+#endif /* ETIMER_HEAP_SIZE */
   /* First check if et is the first event timer on the list. */
   if(et == timerlist) {
     timerlist = timerlist->next;
@@ -64,6 +64,18 @@
 
 #include "contiki.h"
 
+/**
+ * Number of event timers kept in a binary min-heap ordered by expiration
+ * time. With a heap, setting or stopping a timer is O(log n) and the next
+ * expiration is known in O(1). Timers beyond the heap capacity fall back
+ * to the linked list. Set to 0 to only use the linked list.
+ */
+#ifdef ETIMER_CONF_HEAP_SIZE
+#define ETIMER_HEAP_SIZE ETIMER_CONF_HEAP_SIZE
+#else
+#define ETIMER_HEAP_SIZE 0
+#endif
+
 /**
  * A timer.
  *
@@ -76,6 +88,9 @@ struct etimer {
   struct timer timer;
   struct etimer *next;
   struct process *p;
+#if ETIMER_HEAP_SIZE
+  unsigned short heap_index;
+#endif
 };
 
 /**
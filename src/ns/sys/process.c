@@ -47,6 +47,10 @@
 
 #include "contiki.h"
 #include "sys/process.h"
+#include "sys/critical.h"
+#if PROCESS_EVENTS_GROW
+#include "lib/heapmem.h"
+#endif /* PROCESS_EVENTS_GROW */
 
 /*
  * Pointer to the currently running process structure.
@@ -57,22 +61,52 @@ struct process *process_current = NULL;
 static process_event_t lastevent;
 
 /*
- * Structure used for keeping the queue of active events.
+ * Structure used for keeping the queue of active events. Every
+ * process has its own FIFO of them. A broadcast event is queued once,
+ * in the broadcast FIFO, and every process that is to receive it
+ * points at it until it has.
  */
-struct event_data {
-  process_event_t ev;
+struct process_event {
+  struct process_event *next;
   process_data_t data;
-  struct process *p;
+  /* Post order, to interleave a process' events with the broadcasts */
+  unsigned int seq;
+  /* Number of processes that have yet to receive a broadcast */
+  unsigned short refs;
+  process_event_t ev;
 };
 
-static process_num_events_t nevents, fevent;
-static struct event_data events[PROCESS_CONF_NUMEVENTS];
+/* The processes that have events waiting, one FIFO per priority
+   class. A process is in the FIFO of its class exactly as long as its
+   own event queue is not empty. */
+struct ready_queue {
+  struct process *head;
+  struct process *tail;
+};
+
+static process_num_events_t nevents;
+static struct process_event events[PROCESS_CONF_NUMEVENTS];
+static struct process_event *free_events;
+static struct ready_queue ready[PROCESS_PRIORITY_NUM];
+static struct process_event *bcast_head, *bcast_tail;
+static unsigned int post_seq;
+
+#if PROCESS_EVENTS_GROW
+/* Number of events the queue can currently hold */
+static process_num_events_t events_size;
+#define EVENTS_SIZE events_size
+#else /* PROCESS_EVENTS_GROW */
+#define EVENTS_SIZE PROCESS_CONF_NUMEVENTS
+#endif /* PROCESS_EVENTS_GROW */
 
 #if PROCESS_CONF_STATS
 process_num_events_t process_maxevents;
+unsigned long process_dropped_events;
 #endif
 
 static volatile unsigned char poll_requested;
+/* Processes that called process_poll(), in request order */
+static struct process *poll_head, *poll_tail;
 
 #define PROCESS_STATE_NONE        0
 #define PROCESS_STATE_RUNNING     1
@@ -88,6 +122,71 @@ static void call_process(struct process *p, process_event_t ev, process_data_t d
 #define PRINTF(...)
 #endif
 
+/*---------------------------------------------------------------------------*/
+static int
+has_events(struct process *p)
+{
+  return p->event_head != NULL || p->bcast_next != NULL;
+}
+/*---------------------------------------------------------------------------*/
+static void
+ready_add(struct process *p)
+{
+  struct ready_queue *r = &ready[p->priority];
+
+  p->next_ready = NULL;
+  if(r->tail != NULL) {
+    r->tail->next_ready = p;
+  } else {
+    r->head = p;
+  }
+  r->tail = p;
+}
+/*---------------------------------------------------------------------------*/
+static void
+ready_remove(struct process *p)
+{
+  struct ready_queue *r = &ready[p->priority];
+  struct process *q, *prev;
+
+  for(prev = NULL, q = r->head; q != NULL; prev = q, q = q->next_ready) {
+    if(q == p) {
+      if(prev == NULL) {
+        r->head = p->next_ready;
+      } else {
+        prev->next_ready = p->next_ready;
+      }
+      if(r->tail == p) {
+        r->tail = prev;
+      }
+      p->next_ready = NULL;
+      break;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+free_event(struct process_event *e)
+{
+  e->next = free_events;
+  free_events = e;
+  --nevents;
+}
+/*---------------------------------------------------------------------------*/
+/* Release the broadcasts all their processes have received */
+static void
+free_broadcasts(void)
+{
+  struct process_event *e;
+
+  while((e = bcast_head) != NULL && e->refs == 0) {
+    bcast_head = e->next;
+    if(bcast_head == NULL) {
+      bcast_tail = NULL;
+    }
+    free_event(e);
+  }
+}
 /*---------------------------------------------------------------------------*/
 process_event_t
 process_alloc_event(void)
@@ -120,6 +219,53 @@ process_start(struct process *p, process_data_t data)
   process_post_synch(p, PROCESS_EVENT_INIT, data);
 }
 /*---------------------------------------------------------------------------*/
+/*
+ * Forget the events and the poll request still pending for a process
+ * that has exited, so that nothing refers to it anymore and processes
+ * living in dynamically allocated memory can be released.
+ */
+static void
+purge_process(struct process *p)
+{
+  struct process_event *e;
+  struct process *q, *prev;
+  int_master_status_t status;
+
+  if(has_events(p)) {
+    ready_remove(p);
+    while((e = p->event_head) != NULL) {
+      p->event_head = e->next;
+      free_event(e);
+    }
+    p->event_tail = NULL;
+    for(e = p->bcast_next; e != NULL; e = e->next) {
+      e->refs--;
+    }
+    p->bcast_next = NULL;
+    free_broadcasts();
+  }
+
+  status = critical_enter();
+  if(p->needspoll) {
+    for(prev = NULL, q = poll_head; q != NULL; prev = q, q = q->next_poll) {
+      if(q == p) {
+        if(prev == NULL) {
+          poll_head = p->next_poll;
+        } else {
+          prev->next_poll = p->next_poll;
+        }
+        if(poll_tail == p) {
+          poll_tail = prev;
+        }
+        p->next_poll = NULL;
+        p->needspoll = 0;
+        break;
+      }
+    }
+  }
+  critical_exit(status);
+}
+/*---------------------------------------------------------------------------*/
 static void
 exit_process(struct process *p, struct process *fromprocess)
 {
@@ -168,6 +314,8 @@ exit_process(struct process *p, struct process *fromprocess)
     }
   }
 
+  purge_process(p);
+
   process_current = old_current;
 }
 /*---------------------------------------------------------------------------*/
@@ -187,7 +335,16 @@ call_process(struct process *p, process_event_t ev, process_data_t data)
     PRINTF("process: calling process '%s' with event %d\n", PROCESS_NAME_STRING(p), ev);
     process_current = p;
     p->state = PROCESS_STATE_CALLED;
+#if PROCESS_CONF_STATS
+    {
+      clock_time_t start = clock_time();
+      ret = p->thread(&p->pt, ev, data);
+      p->runtime += clock_time() - start;
+      p->ncalls++;
+    }
+#else /* PROCESS_CONF_STATS */
     ret = p->thread(&p->pt, ev, data);
+#endif /* PROCESS_CONF_STATS */
     if(ret == PT_EXITED ||
        ret == PT_ENDED ||
        ev == PROCESS_EVENT_EXIT) {
@@ -205,13 +362,46 @@ process_exit(struct process *p)
 }
 /*---------------------------------------------------------------------------*/
 void
+process_set_priority(struct process *p, unsigned char priority)
+{
+  if(priority >= PROCESS_PRIORITY_NUM) {
+    priority = PROCESS_PRIORITY_NUM - 1;
+  }
+  if(has_events(p) && p->priority != priority) {
+    /* Move its waiting events to the new class */
+    ready_remove(p);
+    p->priority = priority;
+    ready_add(p);
+  } else {
+    p->priority = priority;
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
 process_init(void)
 {
+  int i;
+
   lastevent = PROCESS_EVENT_MAX;
 
-  nevents = fevent = 0;
+  nevents = 0;
+  poll_head = poll_tail = NULL;
+  bcast_head = bcast_tail = NULL;
+  post_seq = 0;
+  free_events = NULL;
+  for(i = PROCESS_CONF_NUMEVENTS - 1; i >= 0; i--) {
+    events[i].next = free_events;
+    free_events = &events[i];
+  }
+  for(i = 0; i < PROCESS_PRIORITY_NUM; i++) {
+    ready[i].head = ready[i].tail = NULL;
+  }
+#if PROCESS_EVENTS_GROW
+  events_size = PROCESS_CONF_NUMEVENTS;
+#endif /* PROCESS_EVENTS_GROW */
 #if PROCESS_CONF_STATS
   process_maxevents = 0;
+  process_dropped_events = 0;
 #endif /* PROCESS_CONF_STATS */
 
   process_current = process_list = NULL;
@@ -224,14 +414,27 @@ process_init(void)
 static void
 do_poll(void)
 {
-  struct process *p;
-
+  struct process *p, *next;
+  int_master_status_t status;
+
+  /* Take the processes that requested a poll so far, the ones polled
+     from the poll handlers are called on the next round. */
+  status = critical_enter();
+  p = poll_head;
+  poll_head = poll_tail = NULL;
   poll_requested = 0;
+  critical_exit(status);
+
   /* Call the processes that needs to be polled. */
-  for(p = process_list; p != NULL; p = p->next) {
-    if(p->needspoll) {
+  for(; p != NULL; p = next) {
+    status = critical_enter();
+    next = p->next_poll;
+    p->next_poll = NULL;
+    p->needspoll = 0;
+    critical_exit(status);
+    /* The process may have exited after requesting the poll */
+    if(process_is_running(p)) {
       p->state = PROCESS_STATE_RUNNING;
-      p->needspoll = 0;
       call_process(p, PROCESS_EVENT_POLL, NULL);
     }
   }
@@ -248,53 +451,64 @@ do_event(void)
   process_event_t ev;
   process_data_t data;
   struct process *receiver;
-  struct process *p;
+  struct process_event *e;
+  int prio;
 
   /*
-   * If there are any events in the queue, take the first one and walk
-   * through the list of processes to see if the event should be
-   * delivered to any of them. If so, we call the event handler
-   * function for the process. We only process one event at a time and
-   * call the poll handlers inbetween.
+   * If there are any events in the queue, take the oldest one of the
+   * first process waiting in the highest priority class and deliver
+   * it. We only process one event at a time and call the poll
+   * handlers inbetween.
    */
 
-  if(nevents > 0) {
-
-    /* There are events that we should deliver. */
-    ev = events[fevent].ev;
+  for(prio = PROCESS_PRIORITY_NUM - 1;
+      prio >= 0 && ready[prio].head == NULL; prio--);
 
-    data = events[fevent].data;
-    receiver = events[fevent].p;
+  if(prio >= 0) {
 
-    /* Since we have seen the new event, we move pointer upwards
-       and decrease the number of events. */
-    fevent = (fevent + 1) % PROCESS_CONF_NUMEVENTS;
-    --nevents;
-
-    /* If this is a broadcast event, we deliver it to all events, in
-       order of their priority. */
-    if(receiver == PROCESS_BROADCAST) {
-      for(p = process_list; p != NULL; p = p->next) {
+    receiver = ready[prio].head;
+    ready[prio].head = receiver->next_ready;
+    if(ready[prio].head == NULL) {
+      ready[prio].tail = NULL;
+    }
 
-	/* If we have been requested to poll a process, we do this in
-	   between processing the broadcast event. */
-	if(poll_requested) {
-	  do_poll();
-	}
-	call_process(p, ev, data);
-      }
+    /* Whichever of its own events and the broadcasts was posted first */
+    e = receiver->event_head;
+    if(e == NULL || (receiver->bcast_next != NULL &&
+                     (int)(receiver->bcast_next->seq - e->seq) < 0)) {
+      e = receiver->bcast_next;
+      receiver->bcast_next = e->next;
+      ev = e->ev;
+      data = e->data;
+      /* The entry is released once every process has seen it */
+      e->refs--;
+      free_broadcasts();
     } else {
-      /* This is not a broadcast event, so we deliver it to the
-	 specified process. */
-      /* If the event was an INIT event, we should also update the
-	 state of the process. */
-      if(ev == PROCESS_EVENT_INIT) {
-	receiver->state = PROCESS_STATE_RUNNING;
+      receiver->event_head = e->next;
+      if(receiver->event_head == NULL) {
+        receiver->event_tail = NULL;
       }
+      ev = e->ev;
+      data = e->data;
+      /* Since we have seen the new event, we release its entry and
+         decrease the number of events. */
+      free_event(e);
+    }
 
-      /* Make sure that the process actually is running. */
-      call_process(receiver, ev, data);
+    if(has_events(receiver)) {
+      /* Take turns with the other processes of the class. This is done
+         before the call, which may post to the process again. */
+      ready_add(receiver);
     }
+
+    /* If the event was an INIT event, we should also update the
+       state of the process. */
+    if(ev == PROCESS_EVENT_INIT) {
+      receiver->state = PROCESS_STATE_RUNNING;
+    }
+
+    /* Make sure that the process actually is running. */
+    call_process(receiver, ev, data);
   }
 }
 /*---------------------------------------------------------------------------*/
@@ -318,10 +532,104 @@ process_nevents(void)
   return nevents + poll_requested;
 }
 /*---------------------------------------------------------------------------*/
+#if PROCESS_EVENTS_GROW
+static void
+grow_events(void)
+{
+  struct process_event *block;
+  int i;
+
+  if(events_size > PROCESS_EVENTS_MAX - PROCESS_EVENTS_GROW) {
+    return;
+  }
+  block = heapmem_alloc(PROCESS_EVENTS_GROW * sizeof(struct process_event));
+  if(block == NULL) {
+    return;
+  }
+  for(i = 0; i < PROCESS_EVENTS_GROW; i++) {
+    block[i].next = free_events;
+    free_events = &block[i];
+  }
+  events_size += PROCESS_EVENTS_GROW;
+}
+#endif /* PROCESS_EVENTS_GROW */
+/*---------------------------------------------------------------------------*/
+/* Make sure that one more event can be queued */
+static int
+reserve_event(void)
+{
+#if PROCESS_EVENTS_GROW
+  if(nevents == EVENTS_SIZE) {
+    grow_events();
+  }
+#endif /* PROCESS_EVENTS_GROW */
+  return nevents < EVENTS_SIZE;
+}
+/*---------------------------------------------------------------------------*/
+static struct process_event *
+new_event(process_event_t ev, process_data_t data)
+{
+  struct process_event *e;
+
+  e = free_events;
+  free_events = e->next;
+  e->next = NULL;
+  e->ev = ev;
+  e->data = data;
+  e->seq = post_seq++;
+  e->refs = 0;
+  ++nevents;
+  return e;
+}
+/*---------------------------------------------------------------------------*/
+static void
+queue_event(struct process *p, process_event_t ev, process_data_t data)
+{
+  struct process_event *e;
+
+  if(!has_events(p)) {
+    ready_add(p);
+  }
+  e = new_event(ev, data);
+  if(p->event_tail != NULL) {
+    p->event_tail->next = e;
+  } else {
+    p->event_head = e;
+  }
+  p->event_tail = e;
+}
+/*---------------------------------------------------------------------------*/
+static void
+queue_broadcast(unsigned short n, process_event_t ev, process_data_t data)
+{
+  struct process_event *e;
+  struct process *q;
+
+  e = new_event(ev, data);
+  e->refs = n;
+  if(bcast_tail != NULL) {
+    bcast_tail->next = e;
+  } else {
+    bcast_head = e;
+  }
+  bcast_tail = e;
+
+  /* Processes already waiting for a broadcast reach this one after it */
+  for(q = process_list; q != NULL; q = q->next) {
+    if(process_is_running(q) && q->bcast_next == NULL) {
+      if(q->event_head == NULL) {
+        ready_add(q);
+      }
+      q->bcast_next = e;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
 int
 process_post(struct process *p, process_event_t ev, process_data_t data)
 {
-  process_num_events_t snum;
+  struct process *q;
+  unsigned short n;
 
   if(PROCESS_CURRENT() == NULL) {
     PRINTF("process_post: NULL process posts event %d to process '%s', nevents %d\n",
@@ -332,7 +640,24 @@ process_post(struct process *p, process_event_t ev, process_data_t data)
 	   p == PROCESS_BROADCAST? "<broadcast>": PROCESS_NAME_STRING(p), nevents);
   }
 
-  if(nevents == PROCESS_CONF_NUMEVENTS) {
+  /* A broadcast event takes a single entry, shared by every process
+     running now. */
+  if(p == PROCESS_BROADCAST) {
+    n = 0;
+    for(q = process_list; q != NULL; q = q->next) {
+      if(process_is_running(q)) {
+        n++;
+      }
+    }
+    if(n == 0) {
+      return PROCESS_ERR_OK;
+    }
+  }
+
+  if(!reserve_event()) {
+#if PROCESS_CONF_STATS
+    process_dropped_events++;
+#endif /* PROCESS_CONF_STATS */
 #if DEBUG
     if(p == PROCESS_BROADCAST) {
       printf("soft panic: event queue is full when broadcast event %d was posted from %s\n", ev, PROCESS_NAME_STRING(process_current));
@@ -343,11 +668,11 @@ process_post(struct process *p, process_event_t ev, process_data_t data)
     return PROCESS_ERR_FULL;
   }
 
-  snum = (process_num_events_t)(fevent + nevents) % PROCESS_CONF_NUMEVENTS;
-  events[snum].ev = ev;
-  events[snum].data = data;
-  events[snum].p = p;
-  ++nevents;
+  if(p == PROCESS_BROADCAST) {
+    queue_broadcast(n, ev, data);
+  } else {
+    queue_event(p, ev, data);
+  }
 
 #if PROCESS_CONF_STATS
   if(nevents > process_maxevents) {
@@ -358,6 +683,33 @@ process_post(struct process *p, process_event_t ev, process_data_t data)
   return PROCESS_ERR_OK;
 }
 /*---------------------------------------------------------------------------*/
+int
+process_cancel(struct process *p, process_event_t ev, process_data_t data)
+{
+  struct process_event **ep, *e;
+  int n = 0;
+
+  if(p->event_head == NULL) {
+    return 0;
+  }
+
+  p->event_tail = NULL;
+  for(ep = &p->event_head; (e = *ep) != NULL;) {
+    if(e->ev == ev && e->data == data) {
+      *ep = e->next;
+      free_event(e);
+      n++;
+    } else {
+      p->event_tail = e;
+      ep = &e->next;
+    }
+  }
+  if(!has_events(p)) {
+    ready_remove(p);
+  }
+  return n;
+}
+/*---------------------------------------------------------------------------*/
 void
 process_post_synch(struct process *p, process_event_t ev, process_data_t data)
 {
@@ -370,11 +722,24 @@ process_post_synch(struct process *p, process_event_t ev, process_data_t data)
 void
 process_poll(struct process *p)
 {
+  int_master_status_t status;
+
   if(p != NULL) {
     if(p->state == PROCESS_STATE_RUNNING ||
        p->state == PROCESS_STATE_CALLED) {
-      p->needspoll = 1;
+      status = critical_enter();
+      if(!p->needspoll) {
+        p->needspoll = 1;
+        p->next_poll = NULL;
+        if(poll_tail != NULL) {
+          poll_tail->next_poll = p;
+        } else {
+          poll_head = p;
+        }
+        poll_tail = p;
+      }
       poll_requested = 1;
+      critical_exit(status);
     }
   }
 }
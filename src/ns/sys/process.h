@@ -56,9 +56,36 @@
 #include "sys/pt.h"
 #include "sys/cc.h"
 
+#ifndef PROCESS_CONF_NUMEVENTS
+#define PROCESS_CONF_NUMEVENTS 32
+#endif /* PROCESS_CONF_NUMEVENTS */
+
+/**
+ * Number of events added to the event queue each time it runs full,
+ * allocated with heapmem. 0 keeps the queue at PROCESS_CONF_NUMEVENTS.
+ */
+#ifdef PROCESS_CONF_EVENTS_GROW
+#define PROCESS_EVENTS_GROW PROCESS_CONF_EVENTS_GROW
+#else /* PROCESS_CONF_EVENTS_GROW */
+#define PROCESS_EVENTS_GROW 0
+#endif /* PROCESS_CONF_EVENTS_GROW */
+
+/**
+ * Upper bound of the event queue size when it grows.
+ */
+#ifdef PROCESS_CONF_EVENTS_MAX
+#define PROCESS_EVENTS_MAX PROCESS_CONF_EVENTS_MAX
+#else /* PROCESS_CONF_EVENTS_MAX */
+#define PROCESS_EVENTS_MAX PROCESS_CONF_NUMEVENTS
+#endif /* PROCESS_CONF_EVENTS_MAX */
+
 typedef unsigned char process_event_t;
 typedef void *        process_data_t;
+#if PROCESS_EVENTS_MAX > 255
+typedef unsigned short process_num_events_t;
+#else
 typedef unsigned char process_num_events_t;
+#endif
 
 /**
  * \name Return values
@@ -84,9 +111,20 @@ typedef unsigned char process_num_events_t;
 
 #define PROCESS_NONE          NULL
 
-#ifndef PROCESS_CONF_NUMEVENTS
-#define PROCESS_CONF_NUMEVENTS 32
-#endif /* PROCESS_CONF_NUMEVENTS */
+/**
+ * \name Priority classes
+ *
+ * Every process has its own queue of events, which it receives in the
+ * order they were posted. Processes with queued events are served
+ * higher priority class first, and the processes of a class take turns
+ * one event at a time.
+ * @{
+ */
+#define PROCESS_PRIORITY_APP     0
+#define PROCESS_PRIORITY_NETWORK 1
+#define PROCESS_PRIORITY_MAC     2
+#define PROCESS_PRIORITY_NUM     3
+/* @} */
 
 #define PROCESS_EVENT_NONE            0x80
 #define PROCESS_EVENT_INIT            0x81
@@ -312,6 +350,8 @@ static PT_THREAD(process_thread_##name(struct pt *process_pt,	\
 
 /** @} */
 
+struct process_event;
+
 struct process {
   struct process *next;
 #if PROCESS_CONF_NO_PROCESS_NAMES
@@ -323,6 +363,15 @@ struct process {
   PT_THREAD((* thread)(struct pt *, process_event_t, process_data_t));
   struct pt pt;
   unsigned char state, needspoll;
+  unsigned char priority;
+  struct process *next_poll;
+  struct process_event *event_head, *event_tail;
+  struct process_event *bcast_next;
+  struct process *next_ready;
+#if PROCESS_CONF_STATS
+  unsigned long ncalls;
+  unsigned long runtime;
+#endif /* PROCESS_CONF_STATS */
 };
 
 /**
@@ -347,8 +396,9 @@ void process_start(struct process *p, process_data_t data);
  * This function posts an asynchronous event to one or more
  * processes. The handing of the event is deferred until the target
  * process is scheduled by the kernel. An event can be broadcast to
- * all processes, in which case all processes in the system will be
- * scheduled to handle the event.
+ * all processes, in which case it is received by every process running
+ * at the time it is posted. A broadcast takes a single entry of the
+ * event queue however many processes receive it.
  *
  * \param ev The event to be posted.
  *
@@ -360,10 +410,23 @@ void process_start(struct process *p, process_data_t data);
  * \retval PROCESS_ERR_OK The event could be posted.
  *
  * \retval PROCESS_ERR_FULL The event queue was full and the event could
- * not be posted.
+ * not be posted. A broadcast event is then posted to no process.
  */
 int process_post(struct process *p, process_event_t ev, process_data_t data);
 
+/**
+ * \brief      Remove queued events from a process
+ * \param p    The process the events were posted to
+ * \param ev   The event
+ * \param data The data the event was posted with
+ * \return     The number of events removed
+ *
+ *             Drops the events posted to \p p with process_post()
+ *             that it has not received yet, for when \p data is about
+ *             to become invalid. Broadcast events are not removed.
+ */
+int process_cancel(struct process *p, process_event_t ev, process_data_t data);
+
 /**
  * Post a synchronous event to a process.
  *
@@ -389,6 +452,16 @@ void process_post_synch(struct process *p,
  */
 void process_exit(struct process *p);
 
+/**
+ * \brief      Set the priority class of a process
+ * \param p    The process
+ * \param priority One of the PROCESS_PRIORITY_ values
+ *
+ *             Processes start with PROCESS_PRIORITY_APP. Events
+ *             already queued to the process move along with it.
+ */
+void process_set_priority(struct process *p, unsigned char priority);
+
 
 /**
  * Get a pointer to the currently running process.
@@ -519,6 +592,19 @@ int process_is_running(struct process *p);
  */
 int process_nevents(void);
 
+#if PROCESS_CONF_STATS
+/** Highest number of events waiting at the same time */
+extern process_num_events_t process_maxevents;
+/** Number of events dropped because the event queue was full */
+extern unsigned long process_dropped_events;
+
+/** Number of times the process thread has been called */
+#define PROCESS_STATS_CALLS(p)   ((p)->ncalls)
+/** Time spent in the process thread, in clock ticks. Includes the
+    synchronous events it posted. */
+#define PROCESS_STATS_RUNTIME(p) ((p)->runtime)
+#endif /* PROCESS_CONF_STATS */
+
 /** @} */
 
 extern struct process *process_list;
@@ -0,0 +1,152 @@
+#include "ns/contiki.h"
+#include "ns/net/netstack.h"
+#include "ns/net/packetbuf.h"
+#include "ns/net/ipv6/sicslowpan.h"
+#include "ns/lib/py/nstd.h"
+#include <stdio.h>
+#include <string.h>
+
+// Feeds fragments of an uncompressed IPv6 packet to the 6LoWPAN input
+// out of order, twice, and with sizes that do not fit, and checks the
+// reassembly statistics. Run it under AddressSanitizer to also catch a
+// fragment written past the reassembly buffer.
+
+#define REASS_PACKET_LEN  192
+// the first fragment carries the IPv6 header and 48 bytes of payload
+#define REASS_FIRST_LEN   88
+#define REASS_MID_OFFSET  (REASS_FIRST_LEN / 8)
+#define REASS_LAST_OFFSET 18
+#define REASS_OVERSIZE    0x7ff
+
+PROCESS(reassembly_test_process, "reassembly test process");
+AUTOSTART_PROCESSES(&reassembly_test_process);
+
+static const linkaddr_t sender = { { 0x02, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01 } };
+static uint8_t packet[REASS_PACKET_LEN];
+static int failed;
+
+static void make_packet(void)
+{
+    int i;
+
+    memset(packet, 0, sizeof(packet));
+    packet[0] = 0x60;
+    packet[5] = REASS_PACKET_LEN - 40;
+    packet[6] = 17;
+    packet[7] = 64;
+    // fe80::1 to fe80::2
+    packet[8] = 0xfe;
+    packet[9] = 0x80;
+    packet[23] = 1;
+    packet[24] = 0xfe;
+    packet[25] = 0x80;
+    packet[39] = 2;
+    for (i = 40; i < REASS_PACKET_LEN; i++) {
+        packet[i] = i;
+    }
+}
+
+static void input_frame(const uint8_t *frame, int len)
+{
+    packetbuf_clear();
+    memcpy(packetbuf_dataptr(), frame, len);
+    packetbuf_set_datalen(len);
+    packetbuf_set_addr(PACKETBUF_ADDR_SENDER, &sender);
+    sicslowpan_driver.input();
+}
+
+// FRAG1 with the IPv6 dispatch, len bytes of the packet from its start
+static void input_first(uint16_t tag, uint16_t size, int len)
+{
+    uint8_t frame[5 + REASS_PACKET_LEN];
+
+    frame[0] = 0xc0 | (size >> 8);
+    frame[1] = size & 0xff;
+    frame[2] = tag >> 8;
+    frame[3] = tag & 0xff;
+    frame[4] = 0x41;
+    memcpy(frame + 5, packet, len);
+    input_frame(frame, 5 + len);
+}
+
+// FRAGN carrying the packet from offset * 8 on
+static void input_next(uint16_t tag, uint16_t size, uint8_t offset, int len)
+{
+    uint8_t frame[5 + REASS_PACKET_LEN];
+
+    frame[0] = 0xe0 | (size >> 8);
+    frame[1] = size & 0xff;
+    frame[2] = tag >> 8;
+    frame[3] = tag & 0xff;
+    frame[4] = offset;
+    memcpy(frame + 5, packet + offset * 8, len);
+    input_frame(frame, 5 + len);
+}
+
+static void input_mid(uint16_t tag)
+{
+    input_next(tag, REASS_PACKET_LEN, REASS_MID_OFFSET,
+               (REASS_LAST_OFFSET - REASS_MID_OFFSET) * 8);
+}
+
+static void input_last(uint16_t tag)
+{
+    input_next(tag, REASS_PACKET_LEN, REASS_LAST_OFFSET,
+               REASS_PACKET_LEN - REASS_LAST_OFFSET * 8);
+}
+
+static void check(const char *name, uint32_t got, uint32_t expected)
+{
+    if (got != expected) {
+        ns_log("reassembly: %s: %lu, expected %lu\n", name,
+               (unsigned long)got, (unsigned long)expected);
+        failed++;
+    }
+}
+
+PROCESS_THREAD(reassembly_test_process, ev, data)
+{
+    static struct sicslowpan_reass_stats start;
+
+    PROCESS_BEGIN();
+
+    ns_log("reassembly test process start\n");
+
+    make_packet();
+    start = sicslowpan_reass_stats;
+
+    // out of order, the first fragment last
+    input_last(1);
+    input_mid(1);
+    input_first(1, REASS_PACKET_LEN, REASS_FIRST_LEN);
+    check("out of order", sicslowpan_reass_stats.reassembled - start.reassembled, 1);
+
+    // every fragment twice
+    input_first(2, REASS_PACKET_LEN, REASS_FIRST_LEN);
+    input_first(2, REASS_PACKET_LEN, REASS_FIRST_LEN);
+    input_mid(2);
+    input_mid(2);
+    input_last(2);
+    check("duplicated", sicslowpan_reass_stats.reassembled - start.reassembled, 2);
+    check("duplicates", sicslowpan_reass_stats.duplicates - start.duplicates, 2);
+
+    // a packet larger than the reassembly buffer, first and N-fragment
+    input_first(3, REASS_OVERSIZE, REASS_FIRST_LEN);
+    input_next(4, REASS_OVERSIZE, REASS_MID_OFFSET, 64);
+    // headers larger than the packet they start
+    input_first(5, 32, REASS_FIRST_LEN);
+    // an N-fragment starting past the end of the packet
+    input_first(6, REASS_PACKET_LEN, REASS_FIRST_LEN);
+    input_next(6, REASS_PACKET_LEN, REASS_PACKET_LEN / 8, 8);
+    check("oversize", sicslowpan_reass_stats.invalid - start.invalid, 4);
+    check("oversize delivered", sicslowpan_reass_stats.reassembled - start.reassembled, 2);
+
+    // the rest of packet 6 still completes it
+    input_mid(6);
+    input_last(6);
+    check("after oversize", sicslowpan_reass_stats.reassembled - start.reassembled, 3);
+
+    ns_log("reassembly: -------- %s\n", failed == 0 ? "SUCCESS" : "FAIL");
+
+    PROCESS_END();
+}
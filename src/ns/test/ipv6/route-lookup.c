@@ -0,0 +1,106 @@
+#include "ns/contiki.h"
+#include "ns/net/ipv6/uip-ds6-route.h"
+#include "ns/net/ipv6/uip-ds6-route-lpm.h"
+#include "ns/lib/py/nstd.h"
+#include <stdio.h>
+#include <string.h>
+
+// Compares uip_ds6_route_lookup() through the longest prefix match trie
+// with the list walk it replaces. Needs UIP_DS6_ROUTE_CONF_LPM 1 and
+// UIP_CONF_MAX_ROUTES of at least ROUTE_LOOKUP_ROUTES.
+
+#define ROUTE_LOOKUP_ROUTES  512
+#define ROUTE_LOOKUP_ROUNDS  200
+
+PROCESS(route_lookup_test_process, "route lookup test process");
+AUTOSTART_PROCESSES(&route_lookup_test_process);
+
+static uip_ds6_route_t routes[ROUTE_LOOKUP_ROUTES];
+static uip_ipaddr_t dests[ROUTE_LOOKUP_ROUTES];
+// keeps the compiler from dropping the timed lookups
+static uip_ds6_route_t *volatile found;
+
+// the list walk of uip_ds6_route_lookup() without the trie
+static uip_ds6_route_t *list_lookup(const uip_ipaddr_t *addr)
+{
+    uip_ds6_route_t *best = NULL;
+    uint8_t longestmatch = 0;
+    int i;
+
+    for (i = 0; i < ROUTE_LOOKUP_ROUTES; i++) {
+        uip_ds6_route_t *r = &routes[i];
+        if (r->length >= longestmatch &&
+            uip_ipaddr_prefixcmp(addr, &r->ipaddr, r->length)) {
+            longestmatch = r->length;
+            best = r;
+            if (longestmatch == 128) {
+                break;
+            }
+        }
+    }
+    return best;
+}
+
+static void setup_routes(void)
+{
+    int i;
+
+    uip_ds6_route_lpm_init();
+
+    // a storing mode root: one /128 host route per node below it, plus a
+    // few /64 prefixes routed to border routers
+    for (i = 0; i < ROUTE_LOOKUP_ROUTES; i++) {
+        uip_ip6addr(&routes[i].ipaddr, 0xfd00, 0, 0, i % 8,
+                    0x0200, 0, (i * 7919) & 0xffff, i);
+        routes[i].length = (i % 64 == 0) ? 64 : 128;
+        uip_ds6_route_lpm_add(&routes[i]);
+        uip_ip6addr(&dests[i], 0xfd00, 0, 0, i % 8,
+                    0x0200, 0, (i * 7919) & 0xffff, i);
+    }
+}
+
+PROCESS_THREAD(route_lookup_test_process, ev, data)
+{
+    static int i, n, mismatch;
+    static clock_time_t start, list_time, trie_time;
+
+    PROCESS_BEGIN();
+
+    ns_log("route lookup test process start\n");
+
+    setup_routes();
+
+    mismatch = 0;
+    for (i = 0; i < ROUTE_LOOKUP_ROUTES; i++) {
+        if (list_lookup(&dests[i]) != uip_ds6_route_lpm_lookup(&dests[i])) {
+            mismatch++;
+        }
+    }
+
+    start = clock_time();
+    for (n = 0; n < ROUTE_LOOKUP_ROUNDS; n++) {
+        for (i = 0; i < ROUTE_LOOKUP_ROUTES; i++) {
+            found = list_lookup(&dests[i]);
+        }
+    }
+    list_time = clock_time() - start;
+
+    start = clock_time();
+    for (n = 0; n < ROUTE_LOOKUP_ROUNDS; n++) {
+        for (i = 0; i < ROUTE_LOOKUP_ROUTES; i++) {
+            found = uip_ds6_route_lpm_lookup(&dests[i]);
+        }
+    }
+    trie_time = clock_time() - start;
+
+    ns_log("%d routes, %d lookups: list %lu lookups/s, trie %lu lookups/s\n",
+           ROUTE_LOOKUP_ROUTES, ROUTE_LOOKUP_ROUTES * ROUTE_LOOKUP_ROUNDS,
+           (unsigned long)((double)ROUTE_LOOKUP_ROUTES * ROUTE_LOOKUP_ROUNDS *
+                           CLOCK_SECOND / (list_time ? list_time : 1)),
+           (unsigned long)((double)ROUTE_LOOKUP_ROUTES * ROUTE_LOOKUP_ROUNDS *
+                           CLOCK_SECOND / (trie_time ? trie_time : 1)));
+
+    ns_log("route lookup test: -------- %s\n", mismatch == 0 ? "SUCCESS" : "FAIL");
+
+    PROCESS_END();
+}
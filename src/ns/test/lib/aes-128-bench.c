@@ -0,0 +1,142 @@
+#include "ns/contiki.h"
+#include "ns/lib/aes-128.h"
+#include "ns/lib/ccm-star.h"
+#include "ns/lib/py/nstd.h"
+#include <stdio.h>
+#include <string.h>
+
+// Checks every AES-128 driver built in against FIPS-197 and the
+// reference driver, then times block encryption per driver and CCM*
+// over 802.15.4 sized frames with the configured AES_128. The AES-NI
+// driver runs on T-tables on a CPU without AES-NI.
+
+#define AES_BLOCKS       200000
+#define AES_CHECK_BLOCKS 1000
+#define CCM_FRAME_LEN    100
+#define CCM_HEADER_LEN   23
+#define CCM_MIC_LEN      8
+#define CCM_FRAMES       20000
+
+PROCESS(aes_test_process, "aes test process");
+AUTOSTART_PROCESSES(&aes_test_process);
+
+static const struct {
+    const char *name;
+    const struct aes_128_driver *driver;
+} drivers[] = {
+    { "reference", &aes_128_driver },
+    { "t-table", &aes_128_ttable_driver },
+#if AES_128_NI
+    { "aes-ni", &aes_128_ni_driver },
+#endif
+};
+
+#define DRIVERS (sizeof(drivers) / sizeof(drivers[0]))
+
+// FIPS-197 appendix C.1
+static const uint8_t fips_key[AES_128_KEY_LENGTH] = {
+    0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+    0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f
+};
+static const uint8_t fips_plaintext[AES_128_BLOCK_SIZE] = {
+    0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77,
+    0x88, 0x99, 0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0xff
+};
+static const uint8_t fips_ciphertext[AES_128_BLOCK_SIZE] = {
+    0x69, 0xc4, 0xe0, 0xd8, 0x6a, 0x7b, 0x04, 0x30,
+    0xd8, 0xcd, 0xb7, 0x80, 0x70, 0xb4, 0xc5, 0x5a
+};
+
+static uint8_t block[AES_128_BLOCK_SIZE];
+static uint8_t frame[CCM_FRAME_LEN];
+static uint8_t mic[CCM_MIC_LEN];
+
+static int check(const struct aes_128_driver *driver)
+{
+    uint8_t key[AES_128_KEY_LENGTH];
+    uint8_t expected[AES_128_BLOCK_SIZE];
+    int mismatch = 0;
+    int i, n;
+
+    memcpy(block, fips_plaintext, sizeof(block));
+    driver->set_key(fips_key);
+    driver->encrypt(block);
+    if (memcmp(block, fips_ciphertext, sizeof(block)) != 0) {
+        mismatch++;
+    }
+
+    // a new key and plaintext for every block, chained through the
+    // previous result
+    for (n = 0; n < AES_CHECK_BLOCKS; n++) {
+        for (i = 0; i < AES_128_KEY_LENGTH; i++) {
+            key[i] = block[i] ^ (uint8_t)(n * 31 + i);
+        }
+        aes_128_driver.set_key(key);
+        memcpy(expected, block, sizeof(expected));
+        aes_128_driver.encrypt(expected);
+
+        driver->set_key(key);
+        driver->encrypt(block);
+        if (memcmp(block, expected, sizeof(block)) != 0) {
+            mismatch++;
+            break;
+        }
+    }
+
+    return mismatch;
+}
+
+static unsigned long rate(unsigned long bytes, clock_time_t time)
+{
+    // MB/s
+    return (unsigned long)((double)bytes * CLOCK_SECOND / (time ? time : 1) / 1000000);
+}
+
+PROCESS_THREAD(aes_test_process, ev, data)
+{
+    static const uint8_t nonce[CCM_STAR_NONCE_LENGTH] = { 0xac, 0xde, 0x48 };
+    static clock_time_t start, time;
+    static int i, n, mismatch;
+
+    PROCESS_BEGIN();
+
+    ns_log("aes test process start\n");
+
+    mismatch = 0;
+    for (i = 0; i < DRIVERS; i++) {
+        if (check(drivers[i].driver)) {
+            ns_log("%s driver does not match\n", drivers[i].name);
+            mismatch++;
+        }
+    }
+
+    for (i = 0; i < DRIVERS; i++) {
+        drivers[i].driver->set_key(fips_key);
+
+        start = clock_time();
+        for (n = 0; n < AES_BLOCKS; n++) {
+            drivers[i].driver->encrypt(block);
+        }
+        time = clock_time() - start;
+
+        ns_log("%-9s %lu MB/s\n", drivers[i].name,
+               rate((unsigned long)AES_128_BLOCK_SIZE * AES_BLOCKS, time));
+    }
+
+    memset(frame, 0x5a, sizeof(frame));
+    CCM_STAR.set_key(fips_key);
+
+    start = clock_time();
+    for (n = 0; n < CCM_FRAMES; n++) {
+        CCM_STAR.aead(nonce, frame + CCM_HEADER_LEN, CCM_FRAME_LEN - CCM_HEADER_LEN,
+                      frame, CCM_HEADER_LEN, mic, CCM_MIC_LEN, 1);
+    }
+    time = clock_time() - start;
+
+    ns_log("ccm* %d byte frames, %lu MB/s\n", CCM_FRAME_LEN,
+           rate((unsigned long)CCM_FRAME_LEN * CCM_FRAMES, time));
+
+    ns_log("aes test: -------- %s\n", mismatch == 0 ? "SUCCESS" : "FAIL");
+
+    PROCESS_END();
+}
@@ -0,0 +1,295 @@
+#include "ns/contiki.h"
+#include "ns/lib/aes-128.h"
+#include "ns/lib/ccm-star.h"
+#include "ns/lib/py/nstd.h"
+#include <stdio.h>
+#include <string.h>
+
+// Checks CCM_STAR against the IEEE 802.15.4-2011 annex C test vectors
+// and the two pass implementation it replaces over a sweep of frame
+// sizes and security levels, in both directions and through
+// aead_batch(), then times the two pass, fused and batch versions.
+
+#define CCM_MAX_LEN   127
+#define CCM_BATCH     16
+#define CCM_ROUNDS    2000
+
+PROCESS(ccm_star_test_process, "ccm star test process");
+AUTOSTART_PROCESSES(&ccm_star_test_process);
+
+// annex C.2, all frames are sent by 0xacde480000000001 with frame counter 5
+static const uint8_t key[AES_128_KEY_LENGTH] = {
+    0xc0, 0xc1, 0xc2, 0xc3, 0xc4, 0xc5, 0xc6, 0xc7,
+    0xc8, 0xc9, 0xca, 0xcb, 0xcc, 0xcd, 0xce, 0xcf
+};
+
+static const struct {
+    const char *name;
+    uint8_t level;
+    uint8_t a_len;
+    uint8_t m_len;
+    uint8_t mic_len;
+    uint8_t a[32];
+    uint8_t m[4];
+    uint8_t c[4];
+    uint8_t mic[8];
+} vectors[] = {
+    // C.2.1 beacon frame, MIC-64
+    { "beacon", 2, 26, 0, 8,
+      { 0x08, 0xd0, 0x84, 0x21, 0x43, 0x01, 0x00, 0x00, 0x00, 0x00, 0x48, 0xde, 0xac,
+        0x02, 0x05, 0x00, 0x00, 0x00, 0x55, 0xcf, 0x00, 0x00, 0x51, 0x52, 0x53, 0x54 },
+      { 0 }, { 0 },
+      { 0x22, 0x3b, 0xc1, 0xec, 0x84, 0x1a, 0xb5, 0x53 } },
+    // C.2.2 data frame, ENC
+    { "data", 4, 26, 4, 0,
+      { 0x69, 0xdc, 0x84, 0x21, 0x43, 0x02, 0x00, 0x00, 0x00, 0x00, 0x48, 0xde, 0xac,
+        0x01, 0x00, 0x00, 0x00, 0x00, 0x48, 0xde, 0xac, 0x04, 0x05, 0x00, 0x00, 0x00 },
+      { 0x61, 0x62, 0x63, 0x64 }, { 0xd4, 0x3e, 0x02, 0x2b },
+      { 0 } },
+    // C.2.3 MAC command frame, ENC-MIC-64
+    { "command", 6, 29, 1, 8,
+      { 0x2b, 0xdc, 0x84, 0x21, 0x43, 0x02, 0x00, 0x00, 0x00, 0x00, 0x48, 0xde, 0xac,
+        0xff, 0xff, 0x01, 0x00, 0x00, 0x00, 0x00, 0x48, 0xde, 0xac, 0x06, 0x05, 0x00,
+        0x00, 0x00, 0x01 },
+      { 0xce }, { 0xd8 },
+      { 0x4f, 0xde, 0x52, 0x90, 0x61, 0xf9, 0xc6, 0xf1 } },
+};
+
+static uint8_t frames[CCM_BATCH][CCM_MAX_LEN];
+static uint8_t mics[CCM_BATCH][AES_128_BLOCK_SIZE];
+static struct ccm_star_frame batch[CCM_BATCH];
+
+// the CBC-MAC and CTR passes ccm-star.c used before they were fused
+#define REF_AUTH_FLAGS(Adata, M) ((Adata ? (1u << 6) : 0) | (((M - 2u) >> 1) << 3) | 1u)
+
+static void ref_set_iv(uint8_t *iv, uint8_t flags, const uint8_t *nonce, uint8_t counter)
+{
+    iv[0] = flags;
+    memcpy(iv + 1, nonce, CCM_STAR_NONCE_LENGTH);
+    iv[14] = 0;
+    iv[15] = counter;
+}
+
+static void ref_ctr_step(const uint8_t *nonce, int pos, uint8_t *m, int m_len, uint8_t counter)
+{
+    uint8_t a[AES_128_BLOCK_SIZE];
+    int i;
+
+    ref_set_iv(a, 1, nonce, counter);
+    AES_128.encrypt(a);
+    for (i = 0; (pos + i < m_len) && (i < AES_128_BLOCK_SIZE); i++) {
+        m[pos + i] ^= a[i];
+    }
+}
+
+static void ref_mic(const uint8_t *nonce, const uint8_t *m, int m_len,
+                    const uint8_t *a, int a_len, uint8_t *result, uint8_t mic_len)
+{
+    uint8_t x[AES_128_BLOCK_SIZE];
+    int pos, i;
+
+    ref_set_iv(x, REF_AUTH_FLAGS(a_len, mic_len), nonce, m_len);
+    AES_128.encrypt(x);
+    if (a_len) {
+        x[1] = x[1] ^ a_len;
+        for (i = 2; (i - 2 < a_len) && (i < AES_128_BLOCK_SIZE); i++) {
+            x[i] ^= a[i - 2];
+        }
+        AES_128.encrypt(x);
+        for (pos = 14; pos < a_len; pos += AES_128_BLOCK_SIZE) {
+            for (i = 0; (pos + i < a_len) && (i < AES_128_BLOCK_SIZE); i++) {
+                x[i] ^= a[pos + i];
+            }
+            AES_128.encrypt(x);
+        }
+    }
+    for (pos = 0; pos < m_len; pos += AES_128_BLOCK_SIZE) {
+        for (i = 0; (pos + i < m_len) && (i < AES_128_BLOCK_SIZE); i++) {
+            x[i] ^= m[pos + i];
+        }
+        AES_128.encrypt(x);
+    }
+    ref_ctr_step(nonce, 0, x, AES_128_BLOCK_SIZE, 0);
+    memcpy(result, x, mic_len);
+}
+
+static void ref_aead(const uint8_t *nonce, uint8_t *m, uint8_t m_len,
+                     const uint8_t *a, uint8_t a_len, uint8_t *result, uint8_t mic_len,
+                     int forward)
+{
+    int pos;
+
+    if (!forward) {
+        for (pos = 0; pos < m_len; pos += AES_128_BLOCK_SIZE) {
+            ref_ctr_step(nonce, pos, m, m_len, pos / AES_128_BLOCK_SIZE + 1);
+        }
+    }
+    ref_mic(nonce, m, m_len, a, a_len, result, mic_len);
+    if (forward) {
+        for (pos = 0; pos < m_len; pos += AES_128_BLOCK_SIZE) {
+            ref_ctr_step(nonce, pos, m, m_len, pos / AES_128_BLOCK_SIZE + 1);
+        }
+    }
+}
+
+static void set_nonce(uint8_t *nonce, uint8_t level)
+{
+    static const uint8_t source[8] = { 0xac, 0xde, 0x48, 0x00, 0x00, 0x00, 0x00, 0x01 };
+
+    memcpy(nonce, source, sizeof(source));
+    nonce[8] = 0x00;
+    nonce[9] = 0x00;
+    nonce[10] = 0x00;
+    nonce[11] = 0x05;
+    nonce[12] = level;
+}
+
+static int check_vectors(void)
+{
+    uint8_t nonce[CCM_STAR_NONCE_LENGTH];
+    uint8_t m[4];
+    uint8_t mic[8];
+    int mismatch = 0;
+    int i;
+
+    CCM_STAR.set_key(key);
+
+    for (i = 0; i < sizeof(vectors) / sizeof(vectors[0]); i++) {
+        set_nonce(nonce, vectors[i].level);
+
+        memcpy(m, vectors[i].m, vectors[i].m_len);
+        CCM_STAR.aead(nonce, m, vectors[i].m_len, vectors[i].a, vectors[i].a_len,
+                      mic, vectors[i].mic_len, 1);
+        if (memcmp(m, vectors[i].c, vectors[i].m_len) != 0 ||
+            memcmp(mic, vectors[i].mic, vectors[i].mic_len) != 0) {
+            ns_log("%s frame: wrong encryption\n", vectors[i].name);
+            mismatch++;
+        }
+
+        CCM_STAR.aead(nonce, m, vectors[i].m_len, vectors[i].a, vectors[i].a_len,
+                      mic, vectors[i].mic_len, 0);
+        if (memcmp(m, vectors[i].m, vectors[i].m_len) != 0 ||
+            memcmp(mic, vectors[i].mic, vectors[i].mic_len) != 0) {
+            ns_log("%s frame: wrong decryption\n", vectors[i].name);
+            mismatch++;
+        }
+    }
+
+    return mismatch;
+}
+
+static int check_reference(void)
+{
+    uint8_t nonce[CCM_STAR_NONCE_LENGTH];
+    uint8_t expected[CCM_MAX_LEN];
+    uint8_t expected_mic[AES_128_BLOCK_SIZE];
+    int mismatch = 0;
+    int a_len, m_len, mic_len, forward, i, n;
+
+    CCM_STAR.set_key(key);
+    set_nonce(nonce, 7);
+
+    for (a_len = 0; a_len <= 40; a_len += 3) {
+        for (m_len = 0; a_len + m_len <= CCM_MAX_LEN; m_len++) {
+            for (mic_len = 0; mic_len <= 16; mic_len += 4) {
+                for (forward = 0; forward < 2; forward++) {
+                    // the same frame through aead() and twice through aead_batch()
+                    for (n = 0; n < 3; n++) {
+                        for (i = 0; i < CCM_MAX_LEN; i++) {
+                            frames[n][i] = (uint8_t)(i * 13 + m_len);
+                        }
+                        batch[n].nonce = nonce;
+                        batch[n].a = frames[n];
+                        batch[n].a_len = a_len;
+                        batch[n].m = frames[n] + a_len;
+                        batch[n].m_len = m_len;
+                        batch[n].result = mics[n];
+                        batch[n].mic_len = mic_len;
+                    }
+                    memcpy(expected, frames[0], CCM_MAX_LEN);
+                    ref_aead(nonce, expected + a_len, m_len, expected, a_len,
+                             expected_mic, mic_len, forward);
+
+                    CCM_STAR.aead(nonce, frames[0] + a_len, m_len, frames[0], a_len,
+                                  mics[0], mic_len, forward);
+                    CCM_STAR.aead_batch(batch + 1, 2, forward);
+
+                    for (n = 0; n < 3; n++) {
+                        if (memcmp(frames[n], expected, CCM_MAX_LEN) != 0 ||
+                            memcmp(mics[n], expected_mic, mic_len) != 0) {
+                            mismatch++;
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    return mismatch;
+}
+
+static unsigned long rate(unsigned long bytes, clock_time_t time)
+{
+    // kB/s
+    return (unsigned long)((double)bytes * CLOCK_SECOND / (time ? time : 1) / 1000);
+}
+
+PROCESS_THREAD(ccm_star_test_process, ev, data)
+{
+    static const uint8_t a_len = 23, m_len = 80, mic_len = 8;
+    static uint8_t nonce[CCM_STAR_NONCE_LENGTH];
+    static clock_time_t start, ref_time, time, batch_time;
+    static int i, n, mismatch;
+
+    PROCESS_BEGIN();
+
+    ns_log("ccm star test process start\n");
+
+    mismatch = check_vectors();
+    mismatch += check_reference();
+
+    // a queue of secured data frames of one neighbor, ENC-MIC-64
+    set_nonce(nonce, 6);
+    for (i = 0; i < CCM_BATCH; i++) {
+        batch[i].nonce = nonce;
+        batch[i].a = frames[i];
+        batch[i].a_len = a_len;
+        batch[i].m = frames[i] + a_len;
+        batch[i].m_len = m_len;
+        batch[i].result = mics[i];
+        batch[i].mic_len = mic_len;
+    }
+    CCM_STAR.set_key(key);
+
+    start = clock_time();
+    for (n = 0; n < CCM_ROUNDS; n++) {
+        for (i = 0; i < CCM_BATCH; i++) {
+            ref_aead(nonce, frames[i] + a_len, m_len, frames[i], a_len, mics[i], mic_len, 0);
+        }
+    }
+    ref_time = clock_time() - start;
+
+    start = clock_time();
+    for (n = 0; n < CCM_ROUNDS; n++) {
+        for (i = 0; i < CCM_BATCH; i++) {
+            CCM_STAR.aead(nonce, frames[i] + a_len, m_len, frames[i], a_len, mics[i], mic_len, 0);
+        }
+    }
+    time = clock_time() - start;
+
+    start = clock_time();
+    for (n = 0; n < CCM_ROUNDS; n++) {
+        CCM_STAR.aead_batch(batch, CCM_BATCH, 0);
+    }
+    batch_time = clock_time() - start;
+
+    ns_log("%d byte frames: two pass %lu kB/s, fused %lu kB/s, batch of %d %lu kB/s\n",
+           a_len + m_len,
+           rate((unsigned long)(a_len + m_len) * CCM_BATCH * CCM_ROUNDS, ref_time),
+           rate((unsigned long)(a_len + m_len) * CCM_BATCH * CCM_ROUNDS, time), CCM_BATCH,
+           rate((unsigned long)(a_len + m_len) * CCM_BATCH * CCM_ROUNDS, batch_time));
+
+    ns_log("ccm star test: -------- %s\n", mismatch == 0 ? "SUCCESS" : "FAIL");
+
+    PROCESS_END();
+}
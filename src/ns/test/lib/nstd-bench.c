@@ -0,0 +1,146 @@
+#include "ns/contiki.h"
+#include "ns/lib/py/nstd.h"
+#include <stdio.h>
+#include <string.h>
+
+// Checks ns_memcpy() and ns_strlen() over a sweep of lengths and
+// alignments, then compares their speed with the plain byte loops they
+// replace. Build with and without NS_STD_CONF_LIBC.
+
+#define NSTD_MAX_LEN   1024
+#define NSTD_ROUNDS    20000
+
+PROCESS(nstd_test_process, "nstd test process");
+AUTOSTART_PROCESSES(&nstd_test_process);
+
+static unsigned char src[NSTD_MAX_LEN + 16];
+static unsigned char dest[NSTD_MAX_LEN + 16];
+static char str[NSTD_MAX_LEN + 16];
+// keeps the compiler from dropping the timed calls
+static volatile size_t result;
+
+static void byte_memcpy(void *d, const void *s, size_t n)
+{
+    volatile unsigned char *cd = d;
+    const unsigned char *cs = s;
+
+    while (n--) {
+        *cd++ = *cs++;
+    }
+}
+
+static size_t byte_strlen(const char *s)
+{
+    volatile size_t ret;
+
+    for (ret = 0; s[ret] != 0; ret++) {
+        // empty loop
+    }
+    return ret;
+}
+
+static int check(void)
+{
+    int len, soff, doff, i;
+    int mismatch = 0;
+
+    for (i = 0; i < sizeof(src); i++) {
+        src[i] = (unsigned char)(i * 37 + 1);
+    }
+
+    for (soff = 0; soff < 8; soff++) {
+        for (doff = 0; doff < 8; doff++) {
+            for (len = 0; len <= 100; len++) {
+                memset(dest, 0xaa, sizeof(dest));
+                ns_memcpy(dest + doff, src + soff, len);
+                for (i = 0; i < sizeof(dest); i++) {
+                    int in = i >= doff && i < doff + len;
+                    if (dest[i] != (in ? src[soff + i - doff] : 0xaa)) {
+                        mismatch++;
+                        break;
+                    }
+                }
+            }
+        }
+    }
+
+    for (soff = 0; soff < 8; soff++) {
+        for (len = 0; len <= 100; len++) {
+            memset(str, 'x', sizeof(str));
+            str[soff + len] = '\0';
+            if (ns_strlen(str + soff) != len) {
+                mismatch++;
+            }
+        }
+    }
+
+    if (ns_strcmp("abc", "abd") >= 0 || ns_strncmp("ab\0x", "ab\0y", 4) != 0 ||
+        ns_strcasecmp("Node.LOCAL", "node.local") != 0) {
+        mismatch++;
+    }
+
+    return mismatch;
+}
+
+static unsigned long rate(unsigned long bytes, clock_time_t time)
+{
+    // MB/s
+    return (unsigned long)((double)bytes * CLOCK_SECOND / (time ? time : 1) / 1000000);
+}
+
+PROCESS_THREAD(nstd_test_process, ev, data)
+{
+    static const uint16_t sizes[] = { 16, 127, 1024 };
+    static clock_time_t start, ref_time, time;
+    static int i, n, mismatch;
+    int len;
+
+    PROCESS_BEGIN();
+
+    ns_log("nstd test process start\n");
+
+    mismatch = check();
+
+    for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        len = sizes[i];
+
+        start = clock_time();
+        for (n = 0; n < NSTD_ROUNDS; n++) {
+            byte_memcpy(dest, src, len);
+        }
+        ref_time = clock_time() - start;
+
+        start = clock_time();
+        for (n = 0; n < NSTD_ROUNDS; n++) {
+            ns_memcpy(dest, src, len);
+        }
+        time = clock_time() - start;
+
+        ns_log("%4d bytes: memcpy byte loop %lu MB/s, ns_memcpy %lu MB/s\n", len,
+               rate((unsigned long)len * NSTD_ROUNDS, ref_time),
+               rate((unsigned long)len * NSTD_ROUNDS, time));
+
+        memset(str, 'x', len);
+        str[len] = '\0';
+
+        start = clock_time();
+        for (n = 0; n < NSTD_ROUNDS; n++) {
+            result = byte_strlen(str);
+        }
+        ref_time = clock_time() - start;
+
+        start = clock_time();
+        for (n = 0; n < NSTD_ROUNDS; n++) {
+            result = ns_strlen(str);
+        }
+        time = clock_time() - start;
+
+        ns_log("%4d bytes: strlen byte loop %lu MB/s, ns_strlen %lu MB/s\n", len,
+               rate((unsigned long)len * NSTD_ROUNDS, ref_time),
+               rate((unsigned long)len * NSTD_ROUNDS, time));
+    }
+
+    ns_log("nstd test: -------- %s\n", mismatch == 0 ? "SUCCESS" : "FAIL");
+
+    PROCESS_END();
+}
@@ -0,0 +1,159 @@
+#include "ns/contiki.h"
+#include "ns/net/mac/tsch/tsch.h"
+#include "ns/lib/random.h"
+#include "ns/lib/py/nstd.h"
+#include <stdio.h>
+
+// Walks the ASN through an Orchestra like schedule and checks that
+// tsch_schedule_get_next_active_link() agrees with the walk over every
+// link it replaces, then compares their speed. Needs
+// TSCH_SCHEDULE_CONF_MAX_LINKS of at least TSCH_SCHED_LINKS + 2.
+
+#define TSCH_SCHED_LINKS    300
+#define TSCH_SCHED_SLOTS    20000
+
+PROCESS(tsch_schedule_test_process, "tsch schedule test process");
+AUTOSTART_PROCESSES(&tsch_schedule_test_process);
+
+// keeps the compiler from dropping the timed lookups
+static struct tsch_link *volatile found;
+
+// the walk over every link of every slotframe, without the cursors
+static struct tsch_link *list_next_active_link(struct tsch_asn_t *asn,
+                                               uint16_t *time_offset,
+                                               struct tsch_link **backup_link)
+{
+    uint16_t time_to_curr_best = 0;
+    struct tsch_link *curr_best = NULL;
+    struct tsch_link *curr_backup = NULL;
+    struct tsch_slotframe *sf;
+
+    for (sf = tsch_schedule_slotframe_head(); sf != NULL;
+         sf = tsch_schedule_slotframe_next(sf)) {
+        uint16_t timeslot = TSCH_ASN_MOD(*asn, sf->size);
+        struct tsch_link *l;
+        for (l = list_head(sf->links_list); l != NULL; l = list_item_next(l)) {
+            uint16_t time_to_timeslot = l->timeslot > timeslot ?
+                l->timeslot - timeslot : sf->size.val + l->timeslot - timeslot;
+            if (curr_best == NULL || time_to_timeslot < time_to_curr_best) {
+                time_to_curr_best = time_to_timeslot;
+                curr_best = l;
+                curr_backup = NULL;
+            } else if (time_to_timeslot == time_to_curr_best) {
+                struct tsch_link *new_best = NULL;
+                if ((curr_best->link_options & LINK_OPTION_TX) ==
+                    (l->link_options & LINK_OPTION_TX)) {
+                    if (l->slotframe_handle < curr_best->slotframe_handle) {
+                        new_best = l;
+                    }
+                } else if (l->link_options & LINK_OPTION_TX) {
+                    new_best = l;
+                }
+                if (curr_backup == NULL) {
+                    if (new_best != l && (l->link_options & LINK_OPTION_RX)) {
+                        curr_backup = l;
+                    }
+                    if (new_best != curr_best &&
+                        (curr_best->link_options & LINK_OPTION_RX)) {
+                        curr_backup = curr_best;
+                    }
+                }
+                if (new_best != NULL) {
+                    curr_best = new_best;
+                }
+            }
+        }
+    }
+    *time_offset = time_to_curr_best;
+    *backup_link = curr_backup;
+    return curr_best;
+}
+
+static void setup_schedule(void)
+{
+    struct tsch_slotframe *sf_eb, *sf_common, *sf_unicast;
+    linkaddr_t addr;
+    int i;
+
+    tsch_schedule_init();
+
+    // Orchestra's EB and common shared slotframes, and a long unicast
+    // slotframe holding one Rx or Tx link per neighbor of a coordinator
+    sf_eb = tsch_schedule_add_slotframe(0, 397);
+    sf_common = tsch_schedule_add_slotframe(2, 31);
+    sf_unicast = tsch_schedule_add_slotframe(1, 1021);
+
+    tsch_schedule_add_link(sf_eb, LINK_OPTION_TX, LINK_TYPE_ADVERTISING_ONLY,
+                           &tsch_broadcast_address, 0, 0);
+    tsch_schedule_add_link(sf_common, LINK_OPTION_RX | LINK_OPTION_TX | LINK_OPTION_SHARED,
+                           LINK_TYPE_ADVERTISING, &tsch_broadcast_address, 0, 1);
+
+    linkaddr_copy(&addr, &linkaddr_null);
+    for (i = 0; i < TSCH_SCHED_LINKS; i++) {
+        addr.u8[LINKADDR_SIZE - 1] = i;
+        addr.u8[LINKADDR_SIZE - 2] = i >> 8;
+        tsch_schedule_add_link(sf_unicast,
+                               (i & 1) ? LINK_OPTION_RX : LINK_OPTION_TX | LINK_OPTION_SHARED,
+                               LINK_TYPE_NORMAL, &addr,
+                               (i * 397) % 1021, 2 + i % 14);
+    }
+}
+
+PROCESS_THREAD(tsch_schedule_test_process, ev, data)
+{
+    static struct tsch_asn_t asn;
+    static int i, mismatch;
+    static clock_time_t start, list_time, cursor_time;
+    struct tsch_link *ref, *ref_backup, *link, *backup;
+    uint16_t ref_offset, offset;
+
+    PROCESS_BEGIN();
+
+    ns_log("tsch schedule test process start\n");
+
+    setup_schedule();
+
+    // follow the slot operation: jump to the next active link, with an
+    // occasional resync somewhere else
+    mismatch = 0;
+    TSCH_ASN_INIT(asn, 0, 0);
+    for (i = 0; i < TSCH_SCHED_SLOTS; i++) {
+        ref = list_next_active_link(&asn, &ref_offset, &ref_backup);
+        link = tsch_schedule_get_next_active_link(&asn, &offset, &backup);
+        if (ref != link || ref_offset != offset || ref_backup != backup) {
+            mismatch++;
+        }
+        if (i % 1000 == 999) {
+            TSCH_ASN_INIT(asn, 0, random_rand());
+        } else {
+            TSCH_ASN_INC(asn, offset);
+        }
+    }
+
+    TSCH_ASN_INIT(asn, 0, 0);
+    start = clock_time();
+    for (i = 0; i < TSCH_SCHED_SLOTS; i++) {
+        found = list_next_active_link(&asn, &offset, &backup);
+        TSCH_ASN_INC(asn, offset);
+    }
+    list_time = clock_time() - start;
+
+    TSCH_ASN_INIT(asn, 0, 0);
+    start = clock_time();
+    for (i = 0; i < TSCH_SCHED_SLOTS; i++) {
+        found = tsch_schedule_get_next_active_link(&asn, &offset, &backup);
+        TSCH_ASN_INC(asn, offset);
+    }
+    cursor_time = clock_time() - start;
+
+    ns_log("%d links, %d slots: walk %lu lookups/s, cursor %lu lookups/s\n",
+           TSCH_SCHED_LINKS + 2, TSCH_SCHED_SLOTS,
+           (unsigned long)((double)TSCH_SCHED_SLOTS * CLOCK_SECOND /
+                           (list_time ? list_time : 1)),
+           (unsigned long)((double)TSCH_SCHED_SLOTS * CLOCK_SECOND /
+                           (cursor_time ? cursor_time : 1)));
+
+    ns_log("tsch schedule test: -------- %s\n", mismatch == 0 ? "SUCCESS" : "FAIL");
+
+    PROCESS_END();
+}
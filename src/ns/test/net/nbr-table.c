@@ -0,0 +1,168 @@
+#include "ns/contiki.h"
+#include "ns/lib/py/nstd.h"
+#include <stdio.h>
+#include <string.h>
+
+// Randomly adds, removes, locks and looks up neighbors from a pool of
+// addresses larger than the table, and checks every lookup through the
+// hash index against a linear scan of the neighbor list. The table is
+// compiled in with the default least used replacement policy, so adding
+// to a full table evicts neighbors and removes them from the index too.
+// Link it instead of the port's nbr-table object.
+
+#undef NBR_TABLE_FIND_REMOVABLE
+#include "ns/net/nbr-table.c"
+
+#if !NBR_TABLE_HASH_SIZE
+#error the nbr-table test needs the hash index, NBR_TABLE_CONF_HASH_SIZE is 0
+#endif
+
+#define NBR_TEST_ADDRS  (4 * NBR_TABLE_MAX_NEIGHBORS)
+#define NBR_TEST_ROUNDS 20000
+
+PROCESS(nbr_table_test_process, "nbr-table test process");
+AUTOSTART_PROCESSES(&nbr_table_test_process);
+
+typedef struct {
+    uint16_t value;
+} nbr_test_t;
+
+NBR_TABLE(nbr_test_t, nbr_test);
+
+static linkaddr_t addrs[NBR_TEST_ADDRS];
+static uint32_t seed = 1;
+static int failed;
+
+static uint32_t next_random(void)
+{
+    // xorshift32, the same sequence on every platform
+    seed ^= seed << 13;
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+    return seed;
+}
+
+static int linear_index(const linkaddr_t *lladdr)
+{
+    nbr_table_key_t *key;
+
+    for (key = list_head(nbr_table_keys); key != NULL; key = list_item_next(key)) {
+        if (linkaddr_cmp(lladdr, &key->lladdr)) {
+            return index_from_key(key);
+        }
+    }
+    return -1;
+}
+
+static int all_locked(void)
+{
+    nbr_table_key_t *key;
+
+    for (key = list_head(nbr_table_keys); key != NULL; key = list_item_next(key)) {
+        if (!locked_map[index_from_key(key)]) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static void check_lookup(int round, int a)
+{
+    int expected = linear_index(&addrs[a]);
+    int got = index_from_lladdr(&addrs[a]);
+    nbr_test_t *item = nbr_table_get_from_lladdr(nbr_test, &addrs[a]);
+
+    if (got != expected) {
+        ns_log("nbr-table: round %d: address %d at %d, expected %d\n",
+               round, a, got, expected);
+        failed++;
+    } else if ((item != NULL) != (expected != -1 && (used_map[expected] & (1 << nbr_test->index)) != 0)) {
+        ns_log("nbr-table: round %d: address %d %sin the table\n",
+               round, a, item != NULL ? "" : "not ");
+        failed++;
+    }
+}
+
+static void check_all(int round)
+{
+    int slots = 0;
+    int i;
+
+    for (i = 0; i < NBR_TEST_ADDRS; i++) {
+        check_lookup(round, i);
+    }
+    for (i = 0; i < NBR_TABLE_HASH_SIZE; i++) {
+        slots += hash_slots[i] != 0;
+    }
+    if (slots != list_length(nbr_table_keys)) {
+        ns_log("nbr-table: round %d: %d index slots for %d neighbors\n",
+               round, slots, list_length(nbr_table_keys));
+        failed++;
+    }
+}
+
+PROCESS_THREAD(nbr_table_test_process, ev, data)
+{
+    static int round;
+    nbr_test_t *item;
+    int a;
+
+    PROCESS_BEGIN();
+
+    ns_log("nbr-table test process start\n");
+
+    for (a = 0; a < NBR_TEST_ADDRS; a++) {
+        addrs[a].u8[0] = 0x02;
+        addrs[a].u8[LINKADDR_SIZE - 2] = a >> 3;
+        addrs[a].u8[LINKADDR_SIZE - 1] = a;
+    }
+    nbr_table_register(nbr_test, NULL);
+
+    for (round = 0; round < NBR_TEST_ROUNDS && failed == 0; round++) {
+        a = next_random() % NBR_TEST_ADDRS;
+        item = nbr_table_get_from_lladdr(nbr_test, &addrs[a]);
+
+        switch (next_random() % 4) {
+        case 0:
+        case 1:
+            if (item == NULL) {
+                int was = linear_index(&addrs[a]);
+                item = nbr_table_add_lladdr(nbr_test, &addrs[a],
+                                            NBR_TABLE_REASON_UNDEFINED, NULL);
+                if (item == NULL && (was != -1 || !all_locked())) {
+                    ns_log("nbr-table: round %d: address %d not added\n", round, a);
+                    failed++;
+                } else if (item != NULL &&
+                           !linkaddr_cmp(nbr_table_get_lladdr(nbr_test, item), &addrs[a])) {
+                    ns_log("nbr-table: round %d: address %d added as another\n", round, a);
+                    failed++;
+                }
+            }
+            break;
+        case 2:
+            if (item != NULL) {
+                nbr_table_remove(nbr_test, item);
+            }
+            break;
+        default:
+            // a locked neighbor is never evicted
+            if (item != NULL && !nbr_get_bit(locked_map, nbr_test, item) &&
+                next_random() % 2 == 0) {
+                nbr_table_lock(nbr_test, item);
+            } else if (item != NULL) {
+                nbr_table_unlock(nbr_test, item);
+            }
+            break;
+        }
+
+        check_lookup(round, next_random() % NBR_TEST_ADDRS);
+        if (round % NBR_TEST_ADDRS == 0) {
+            check_all(round);
+        }
+    }
+    check_all(round);
+
+    ns_log("nbr-table: -------- %s\n", failed == 0 ? "SUCCESS" : "FAIL");
+
+    PROCESS_END();
+}
@@ -0,0 +1,74 @@
+#include "ns/contiki.h"
+#include "ns/net/packetbuf.h"
+#include "ns/net/queuebuf.h"
+#include "ns/lib/py/nstd.h"
+#include <stdio.h>
+#include <string.h>
+
+// Rewrites the packetbuf in place, without changing its length, after
+// it was copied to or from a queuebuf, and queues it again. The new
+// queuebuf must hold the rewritten bytes and the old one must keep its
+// own, also with QUEUEBUF_CONF_SHARED 1.
+
+#define QUEUEBUF_TEST_LEN 32
+
+PROCESS(queuebuf_test_process, "queuebuf test process");
+AUTOSTART_PROCESSES(&queuebuf_test_process);
+
+static int failed;
+
+static void check(const char *name, struct queuebuf *q, uint8_t first)
+{
+    if (q == NULL) {
+        ns_log("queuebuf: %s: not queued\n", name);
+        failed++;
+    } else if (queuebuf_datalen(q) != QUEUEBUF_TEST_LEN ||
+               ((uint8_t *)queuebuf_dataptr(q))[0] != first) {
+        ns_log("queuebuf: %s: holds %d, expected %d\n", name,
+               ((uint8_t *)queuebuf_dataptr(q))[0], first);
+        failed++;
+    }
+}
+
+PROCESS_THREAD(queuebuf_test_process, ev, data)
+{
+    static uint8_t frame[QUEUEBUF_TEST_LEN];
+    static struct queuebuf *q1, *q2, *q3;
+
+    PROCESS_BEGIN();
+
+    ns_log("queuebuf test process start\n");
+
+    memset(frame, 1, sizeof(frame));
+    packetbuf_clear();
+    packetbuf_copyfrom(frame, sizeof(frame));
+
+    // queued, then written in place
+    q1 = queuebuf_new_from_packetbuf();
+    ((uint8_t *)packetbuf_dataptr())[0] = 2;
+    q2 = queuebuf_new_from_packetbuf();
+    check("first", q1, 1);
+    check("written after queueing", q2, 2);
+
+    // loaded from a queuebuf, then written in place
+    queuebuf_to_packetbuf(q1);
+    ((uint8_t *)packetbuf_dataptr())[0] = 3;
+    q3 = queuebuf_new_from_packetbuf();
+    check("loaded", q1, 1);
+    check("written after loading", q3, 3);
+
+    // loading the written over queuebuf again restores its bytes
+    queuebuf_to_packetbuf(q1);
+    if (((const uint8_t *)packetbuf_dataptr_const())[0] != 1) {
+        ns_log("queuebuf: packetbuf not restored\n");
+        failed++;
+    }
+
+    queuebuf_free(q1);
+    queuebuf_free(q2);
+    queuebuf_free(q3);
+
+    ns_log("queuebuf: -------- %s\n", failed == 0 ? "SUCCESS" : "FAIL");
+
+    PROCESS_END();
+}
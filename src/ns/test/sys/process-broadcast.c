@@ -0,0 +1,95 @@
+#include "ns/contiki.h"
+#include "ns/lib/py/nstd.h"
+#include <stdio.h>
+#include <string.h>
+
+// Starts more processes than the event queue can ever hold and posts
+// broadcasts to them, each followed by an event to half of the queue's
+// worth of processes. Every broadcast must take a single queue entry
+// and reach each process in the order it was posted.
+
+#define BCAST_TEST_PROCESSES (PROCESS_EVENTS_MAX + 16)
+#define BCAST_TEST_DIRECT    (PROCESS_EVENTS_MAX / 2)
+#define BCAST_TEST_ROUNDS    4
+
+PROCESS(process_broadcast_test_process, "process broadcast test process");
+AUTOSTART_PROCESSES(&process_broadcast_test_process);
+
+static struct process receivers[BCAST_TEST_PROCESSES];
+static int received[BCAST_TEST_PROCESSES];
+static int errors;
+static process_event_t bcast_event, direct_event;
+
+static PT_THREAD(receiver_thread(struct pt *process_pt,
+                                 process_event_t ev, process_data_t data))
+{
+    int i = PROCESS_CURRENT() - receivers;
+    int step = i < BCAST_TEST_DIRECT ? 2 : 1;
+
+    PROCESS_BEGIN();
+
+    while (1) {
+        PROCESS_WAIT_EVENT_UNTIL(ev == bcast_event || ev == direct_event);
+        // each broadcast comes before the event posted after it
+        if (ev != (received[i] % step == 0 ? bcast_event : direct_event) ||
+            (int)(intptr_t)data != received[i] / step) {
+            errors++;
+        }
+        received[i]++;
+    }
+
+    PROCESS_END();
+}
+
+PROCESS_THREAD(process_broadcast_test_process, ev, data)
+{
+    static struct etimer et;
+    static int round;
+    int i;
+
+    PROCESS_BEGIN();
+
+    ns_log("process broadcast test process start\n");
+
+    bcast_event = process_alloc_event();
+    direct_event = process_alloc_event();
+
+    for (i = 0; i < BCAST_TEST_PROCESSES; i++) {
+        memset(&receivers[i], 0, sizeof(receivers[i]));
+#if !PROCESS_CONF_NO_PROCESS_NAMES
+        receivers[i].name = "receiver";
+#endif
+        receivers[i].thread = receiver_thread;
+        process_start(&receivers[i], NULL);
+    }
+
+    for (round = 0; round < BCAST_TEST_ROUNDS; round++) {
+        if (process_post(PROCESS_BROADCAST, bcast_event,
+                         (process_data_t)(intptr_t)round) != PROCESS_ERR_OK) {
+            ns_log("process broadcast: broadcast %d did not fit\n", round);
+            errors++;
+        }
+        for (i = 0; i < BCAST_TEST_DIRECT; i++) {
+            if (process_post(&receivers[i], direct_event,
+                             (process_data_t)(intptr_t)round) != PROCESS_ERR_OK) {
+                ns_log("process broadcast: event %d to process %d did not fit\n", round, i);
+                errors++;
+            }
+        }
+        // let the processes receive them all before the next round
+        etimer_set(&et, CLOCK_SECOND / 4);
+        PROCESS_WAIT_EVENT_UNTIL(ev == PROCESS_EVENT_TIMER);
+    }
+
+    for (i = 0; i < BCAST_TEST_PROCESSES; i++) {
+        if (received[i] != (i < BCAST_TEST_DIRECT ? 2 : 1) * BCAST_TEST_ROUNDS) {
+            ns_log("process broadcast: process %d received %d events\n", i, received[i]);
+            errors++;
+        }
+        process_exit(&receivers[i]);
+    }
+
+    ns_log("process broadcast: -------- %s\n", errors == 0 ? "SUCCESS" : "FAIL");
+
+    PROCESS_END();
+}
@@ -0,0 +1,54 @@
+#include "ns/contiki.h"
+#include "ns/sys/ctimer.h"
+#include "ns/sys/etimer.h"
+#include "ns/lib/py/nstd.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+// Stops and frees a ctimer whose timer event is already queued to the
+// ctimer process. The event must be dropped with the ctimer, so neither
+// the callback runs nor the freed memory is read. Run it under
+// AddressSanitizer to catch the latter.
+
+PROCESS(ctimer_stop_test_process, "ctimer stop test process");
+AUTOSTART_PROCESSES(&ctimer_stop_test_process);
+
+static int called;
+
+static void ctimer_callback(void *ptr)
+{
+    called++;
+}
+
+PROCESS_THREAD(ctimer_stop_test_process, ev, data)
+{
+    static struct etimer et;
+    static struct ctimer *c;
+
+    PROCESS_BEGIN();
+
+    ns_log("ctimer stop test process start\n");
+
+    // served before the ctimer process, so both timers expiring in the
+    // same tick leave the ctimer event queued when we wake up
+    process_set_priority(PROCESS_CURRENT(), PROCESS_PRIORITY_NETWORK);
+
+    c = malloc(sizeof(*c));
+    ctimer_set(c, CLOCK_SECOND / 4, ctimer_callback, NULL);
+    etimer_set(&et, CLOCK_SECOND / 4);
+    PROCESS_WAIT_EVENT_UNTIL(ev == PROCESS_EVENT_TIMER);
+
+    if (!etimer_expired(&c->etimer)) {
+        ns_log("ctimer stop: ctimer did not expire with the etimer\n");
+    }
+    ctimer_stop(c);
+    free(c);
+
+    // give the ctimer process time to receive anything left for it
+    etimer_set(&et, CLOCK_SECOND / 4);
+    PROCESS_WAIT_EVENT_UNTIL(ev == PROCESS_EVENT_TIMER);
+
+    ns_log("ctimer stop: -------- %s\n", called == 0 ? "SUCCESS" : "FAIL");
+
+    PROCESS_END();
+}
@@ -307,6 +307,8 @@ void mp_unix_mark_exec(void);
 #define MICROPY_PORT_ROOT_POINTERS \
     const char *readline_hist[50]; \
     void *mmap_region_head; \
+    mp_obj_t *ns_thread_pool; \
+    mp_obj_t *ns_coap_res_pool; \
 
 // We need to provide a declaration/definition of alloca()
 // unless support for it is disabled.
@@ -102,6 +102,8 @@ extern const struct _mp_obj_module_t mp_module_os;
     { MP_ROM_QSTR(MP_QSTR_uos), MP_ROM_PTR(&mp_module_os) }, \
 
 #define MICROPY_PORT_ROOT_POINTERS \
+    mp_obj_t *ns_thread_pool; \
+    mp_obj_t *ns_coap_res_pool; \
 
 //////////////////////////////////////////
 // Do not change anything beyond this line
@@ -1,19 +1,60 @@
 #include "ns/contiki.h"
 #include "port_unix.h"
 
-static struct timeval start;
+#if defined(__linux__)
+#include <sys/timerfd.h>
+#define UNIX_CLOCK_TIMERFD 1
+#else
+#define UNIX_CLOCK_TIMERFD 0
+#endif
+
+static struct timespec start;
+
+#if UNIX_CLOCK_TIMERFD
+// wakes the select() loop at the exact next etimer deadline
+static int timer_fd = -1;
+static bool timer_armed;
+static clock_time_t timer_deadline;
+#endif
+
+// deadline already handed to etimer_process, so it is measured only once
+static bool deadline_polled;
+static clock_time_t polled_deadline;
+// wakeup latency past the etimer deadlines, in clock ticks
+static unsigned long stats_expirations;
+static clock_time_t stats_total_latency;
+static clock_time_t stats_max_latency;
+
+static void clock_monotonic(struct timespec *ts)
+{
+    clock_gettime(CLOCK_MONOTONIC, ts);
+}
 
 void clock_init(void)
 {
-    gettimeofday(&start, NULL);
+    unix_sim_init();
+    clock_monotonic(&start);
+#if UNIX_CLOCK_TIMERFD
+    if (timer_fd < 0) {
+        timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    }
+    timer_armed = false;
+#endif
+    deadline_polled = false;
+    stats_expirations = 0;
+    stats_total_latency = 0;
+    stats_max_latency = 0;
 }
 
 clock_time_t clock_time(void)
 {
-    struct timeval tv;
-    gettimeofday(&tv, NULL);
-    timersub(&tv, &start, &tv);
-    return (clock_time_t)tv.tv_sec * US_PER_S + (clock_time_t)tv.tv_usec;
+    struct timespec ts;
+    if (unix_sim_enabled()) {
+        return unix_sim_now();
+    }
+    clock_monotonic(&ts);
+    return (clock_time_t)(ts.tv_sec - start.tv_sec) * US_PER_S +
+           (clock_time_t)((ts.tv_nsec - start.tv_nsec) / 1000);
 }
 
 unsigned long clock_seconds(void)
@@ -24,6 +65,9 @@ unsigned long clock_seconds(void)
 void clock_wait(clock_time_t i)
 {
     clock_time_t t0;
+    if (unix_sim_enabled()) {
+        return; // busy waits take no virtual time
+    }
     t0 = clock_time();
     while (clock_time() - t0 < (clock_time_t)i) {
         // do nothing
@@ -40,11 +84,103 @@ void clock_delay(unsigned int i)
     clock_delay_usec(i);
 }
 
+bool unix_clock_timer_active(void)
+{
+#if UNIX_CLOCK_TIMERFD
+    return timer_fd >= 0 && !unix_sim_enabled();
+#else
+    return false;
+#endif
+}
+
+void unix_clock_update_fd_set(fd_set *read_fd_set, int *max_fd)
+{
+#if UNIX_CLOCK_TIMERFD
+    struct itimerspec its;
+    clock_time_t next;
+
+    if (!unix_clock_timer_active()) {
+        return;
+    }
+
+    if (!etimer_pending()) {
+        if (timer_armed) {
+            memset(&its, 0, sizeof(its));
+            timerfd_settime(timer_fd, 0, &its, NULL);
+            timer_armed = false;
+        }
+        return;
+    }
+
+    next = etimer_next_expiration_time();
+    if (!timer_armed || next != timer_deadline) {
+        // absolute expiry so the time spent getting here doesn't add up
+        memset(&its, 0, sizeof(its));
+        its.it_value.tv_sec = start.tv_sec + next / US_PER_S;
+        its.it_value.tv_nsec = start.tv_nsec + (long)(next % US_PER_S) * 1000;
+        if (its.it_value.tv_nsec >= 1000000000L) {
+            its.it_value.tv_sec++;
+            its.it_value.tv_nsec -= 1000000000L;
+        }
+        timerfd_settime(timer_fd, TFD_TIMER_ABSTIME, &its, NULL);
+        timer_armed = true;
+        timer_deadline = next;
+    }
+
+    FD_SET(timer_fd, read_fd_set);
+    if (*max_fd < timer_fd) {
+        *max_fd = timer_fd;
+    }
+#else
+    (void)read_fd_set;
+    (void)max_fd;
+#endif
+}
+
 void etimer_pending_process(void)
 {
-    if ((clock_time() % US_PER_MS) == 0) {
-        if (etimer_pending()) {
-            etimer_request_poll();
+    clock_time_t next;
+    clock_time_t late;
+
+#if UNIX_CLOCK_TIMERFD
+    if (unix_clock_timer_active() && timer_armed) {
+        uint64_t expirations;
+        if (read(timer_fd, &expirations, sizeof(expirations)) > 0) {
+            timer_armed = false;
         }
     }
+#endif
+
+    if (!etimer_pending()) {
+        return;
+    }
+
+    next = etimer_next_expiration_time();
+    late = clock_time() - next;
+    if ((long)late < 0) {
+        return;
+    }
+
+    etimer_request_poll();
+
+    if (deadline_polled && polled_deadline == next) {
+        return;
+    }
+    deadline_polled = true;
+    polled_deadline = next;
+
+    stats_expirations++;
+    stats_total_latency += late;
+    if (late > stats_max_latency) {
+        stats_max_latency = late;
+    }
+}
+
+void unix_etimer_stats(unsigned long *expirations,
+                       unsigned long *mean_latency,
+                       unsigned long *max_latency)
+{
+    *expirations = stats_expirations;
+    *mean_latency = stats_expirations ? stats_total_latency / stats_expirations : 0;
+    *max_latency = stats_max_latency;
 }
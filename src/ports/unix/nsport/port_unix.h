@@ -1,6 +1,7 @@
 #ifndef NSPORT_PORT_UNIX_H_
 #define NSPORT_PORT_UNIX_H_
 
+#include "ns/contiki.h"
 #include <assert.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -16,13 +17,29 @@
 #include <sys/stat.h>
 #include <sys/time.h>
 #include <unistd.h>
+#include <stdbool.h>
 #define POLL poll
 
+// upper bound of a single blocking wait in unix_process_wait()
+#define UNIX_PROCESS_MAX_WAIT_TIME CLOCK_SECOND
+
 void rtimer_alarm_process(void);
+bool rtimer_alarm_next(rtimer_clock_t *alarm);
 void etimer_pending_process(void);
 
+// etimer deadline wakeups, see clock.c
+bool unix_clock_timer_active(void);
+void unix_clock_update_fd_set(fd_set *read_fd_set, int *max_fd);
+void unix_etimer_stats(unsigned long *expirations,
+                       unsigned long *mean_latency,
+                       unsigned long *max_latency);
+
 void unix_radio_update_fd_set(fd_set *read_fd_set, fd_set *write_fd_set, int *max_fd);
 void unix_radio_process(void);
+void unix_radio_set_neighbors(const uint16_t *ids, size_t num);
+bool unix_radio_pending(void);
+int unix_radio_fd(void);
+bool unix_radio_ack_deadline(rtimer_clock_t *deadline);
 
 void unix_uart_restore(void);
 void unix_uart_enable(void);
@@ -30,6 +47,17 @@ void unix_uart_disable(void);
 void unix_uart_update_fd_set(fd_set *read_fd_set, fd_set *write_fd_set, fd_set *error_fd_set, int *max_fd);
 void unix_uart_process(void);
 
+// virtual time simulation, see sim-clock.c
+#define UNIX_SIM_SEED_ENV "NESPY_SIM_SEED"
+
+void unix_sim_init(void);
+bool unix_sim_enabled(void);
+unsigned long unix_sim_seed(void);
+clock_time_t unix_sim_now(void);
+void unix_sim_node_busy(uint16_t node);
+void unix_sim_idle(clock_time_t wait);
+
 void unix_process_update(void);
+void unix_process_wait(void);
 
 #endif // NSPORT_PORT_UNIX_H_
@@ -3,11 +3,49 @@
 
 // CSMA config
 #define CSMA_CONF_SEND_SOFT_ACK 1
+// send up to 4 more queued frames to a neighbor right after an ack
+#define CSMA_CONF_BURST_MAX 4
 
 // ack wait timeout implement in radio driver
 #define CSMA_CONF_ACK_WAIT_TIME 0
 #define CSMA_CONF_AFTER_ACK_DETECTED_WAIT_TIME 0
 
+// Event queue config, grows from the heap when a burst fills it
+#define PROCESS_CONF_STATS 1
+#define PROCESS_CONF_EVENTS_GROW 32
+#define PROCESS_CONF_EVENTS_MAX 256
+#define HEAPMEM_CONF_ARENA_SIZE 8192
+
+// Queuebuf config, share packet bytes between queues and packetbuf
+#define QUEUEBUF_CONF_SHARED 1
+#define QUEUEBUF_CONF_STATS 1
+
+// 6LoWPAN config, reassemble from several senders at once and forward
+// the fragments of routed packets as they come
+#define SICSLOWPAN_CONF_REASS_CONTEXTS 8
+#define SICSLOWPAN_CONF_FRAG_FORWARDING 1
+#define SICSLOWPAN_CONF_VRB_ENTRIES 8
+
+// Timer config
+#define ETIMER_CONF_HEAP_SIZE 256
+
+// Routing table config
+#define UIP_DS6_ROUTE_CONF_LPM 1
+
+// Checksum config, vector kernels follow the compiler target flags
+#define UIP_CONF_CHKSUM_WIDE 1
+#define UIP_CONF_CHKSUM_SIMD 1
+
+// AES config, AES-NI on x86-64 hosts that have it, T-tables otherwise
+#if defined(__x86_64__) && defined(__GNUC__)
+#define AES_128_CONF aes_128_ni_driver
+#else
+#define AES_128_CONF aes_128_ttable_driver
+#endif
+
+// use the host libc for the ns_* string and memory helpers
+#define NS_STD_CONF_LIBC 1
+
 // TCP config
 #define UIP_CONF_TCP 1
 
@@ -23,6 +61,8 @@
 #ifdef APP_CONF_WITH_COAP
 // enable client-side support for COAP observe
 #define COAP_OBSERVE_CLIENT     1
+// dispatch requests through a hash of the resource paths
+#define COAP_RESOURCE_HASH_SIZE 128
 #endif
 
 #endif // PROJECT_CONF_H_
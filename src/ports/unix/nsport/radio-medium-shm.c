@@ -0,0 +1,204 @@
+#include "ns/contiki.h"
+#include "radio-medium.h"
+#include "port_unix.h"
+#include <errno.h>
+#include <sys/mman.h>
+
+// Shared memory medium: all nodes on the host map one segment holding a
+// receive ring per node id. A transmitting node copies the frame straight
+// into the ring of each destination and only sends a 1-byte doorbell
+// datagram when that ring was empty, so a busy receiver costs no syscall
+// and nodes that aren't neighbors cost nothing at all.
+//
+// The rings are bounded multi-producer / single-consumer queues: writers
+// reserve a slot by advancing `tail`, and each slot `seq` tells whether it
+// is free (seq == pos), published (seq == pos + 1) or consumed.
+
+#define SHM_MEDIUM_NAME "/nespy-radio-medium"
+
+typedef struct {
+    uint32_t seq;
+    uint8_t len;
+    uint8_t data[UNIX_RADIO_FRAME_SIZE];
+} shm_slot_t;
+
+typedef struct {
+    uint32_t head;
+    uint32_t tail;
+    uint32_t present;
+    shm_slot_t slot[UNIX_RADIO_SHM_RING_SIZE];
+} shm_ring_t;
+
+typedef struct {
+    shm_ring_t ring[UNIX_RADIO_MAX_NODES];
+} shm_medium_t;
+
+static shm_medium_t *medium;
+static shm_ring_t *self_ring;
+static uint16_t self_node;
+static int doorbell_fd = -1;
+
+static void shm_detach(void)
+{
+    if (self_ring != NULL) {
+        __atomic_store_n(&self_ring->present, 0, __ATOMIC_SEQ_CST);
+    }
+}
+
+static void shm_init(uint16_t node)
+{
+    int fd;
+
+    if (node >= UNIX_RADIO_MAX_NODES) {
+        fprintf(stderr, "radio: node id %u exceeds shm medium size (%u)\n",
+                node, UNIX_RADIO_MAX_NODES);
+        exit(EXIT_FAILURE);
+    }
+
+    fd = shm_open(SHM_MEDIUM_NAME, O_RDWR | O_CREAT, 0600);
+    if (fd == -1) {
+        perror("shm_open");
+        exit(EXIT_FAILURE);
+    }
+
+    // every node truncates to the same size, a fresh segment is zero filled
+    if (ftruncate(fd, sizeof(shm_medium_t)) == -1) {
+        perror("ftruncate");
+        exit(EXIT_FAILURE);
+    }
+
+    medium = mmap(NULL, sizeof(shm_medium_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (medium == MAP_FAILED) {
+        perror("mmap");
+        exit(EXIT_FAILURE);
+    }
+    close(fd);
+
+    self_node = node;
+    self_ring = &medium->ring[node];
+
+    // reset our ring before announcing it, stale frames of a previous run are dropped
+    __atomic_store_n(&self_ring->present, 0, __ATOMIC_SEQ_CST);
+    for (uint32_t i = 0; i < UNIX_RADIO_SHM_RING_SIZE; i++) {
+        __atomic_store_n(&self_ring->slot[i].seq, i, __ATOMIC_RELAXED);
+    }
+    __atomic_store_n(&self_ring->head, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&self_ring->tail, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&self_ring->present, 1, __ATOMIC_SEQ_CST);
+
+    atexit(shm_detach);
+
+    doorbell_fd = unix_radio_udp_open(UNIX_RADIO_BASE_PORT + node);
+}
+
+static int shm_fd(void)
+{
+    return doorbell_fd;
+}
+
+// push a frame into a ring, return false if it is full. `was_empty` tells
+// whether the consumer may be sleeping on its doorbell.
+static bool ring_push(shm_ring_t *ring, const uint8_t *buf, uint8_t len, bool *was_empty)
+{
+    uint32_t pos = __atomic_load_n(&ring->tail, __ATOMIC_RELAXED);
+
+    while (1) {
+        shm_slot_t *slot = &ring->slot[pos % UNIX_RADIO_SHM_RING_SIZE];
+        uint32_t seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+        int32_t diff = (int32_t)(seq - pos);
+
+        if (diff == 0) {
+            if (__atomic_compare_exchange_n(&ring->tail, &pos, pos + 1, true,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                slot->len = len;
+                memcpy(slot->data, buf, len);
+                __atomic_store_n(&slot->seq, pos + 1, __ATOMIC_SEQ_CST);
+                *was_empty = __atomic_load_n(&ring->head, __ATOMIC_SEQ_CST) == pos;
+                return true;
+            }
+        } else if (diff < 0) {
+            return false;
+        } else {
+            pos = __atomic_load_n(&ring->tail, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+static void shm_deliver(uint16_t node, const uint8_t *buf, uint8_t len)
+{
+    shm_ring_t *ring;
+    bool was_empty = false;
+
+    if (node == self_node || node >= UNIX_RADIO_MAX_NODES) {
+        return;
+    }
+
+    ring = &medium->ring[node];
+
+    if (!__atomic_load_n(&ring->present, __ATOMIC_ACQUIRE)) {
+        return;
+    }
+
+    unix_sim_node_busy(node);
+
+    // a full ring behaves like a lost frame on air
+    if (ring_push(ring, buf, len, &was_empty) && was_empty) {
+        const uint8_t doorbell = 0;
+        unix_radio_udp_send(doorbell_fd, UNIX_RADIO_BASE_PORT + node, &doorbell, 1);
+    }
+}
+
+static void shm_transmit(const uint8_t *buf, uint8_t len, const uint16_t *dst, size_t dst_num)
+{
+    if (dst != NULL) {
+        for (size_t i = 0; i < dst_num; i++) {
+            shm_deliver(dst[i], buf, len);
+        }
+    } else {
+        for (uint16_t i = 0; i < UNIX_RADIO_MAX_NODES; i++) {
+            shm_deliver(i, buf, len);
+        }
+    }
+}
+
+static bool shm_pending(void)
+{
+    uint32_t pos = self_ring->head;
+    shm_slot_t *slot = &self_ring->slot[pos % UNIX_RADIO_SHM_RING_SIZE];
+    return __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) == pos + 1;
+}
+
+static int shm_receive(uint8_t *buf, uint8_t size)
+{
+    uint8_t doorbell[16];
+    uint32_t pos;
+    shm_slot_t *slot;
+    int len;
+
+    // drain doorbells first, a frame published after this still rings again
+    while (recv(doorbell_fd, (char *)doorbell, sizeof(doorbell), MSG_DONTWAIT) > 0) {
+        // discard
+    }
+
+    if (!shm_pending()) {
+        return 0;
+    }
+
+    pos = self_ring->head;
+    slot = &self_ring->slot[pos % UNIX_RADIO_SHM_RING_SIZE];
+    len = MIN(slot->len, size);
+    memcpy(buf, slot->data, len);
+    __atomic_store_n(&slot->seq, pos + UNIX_RADIO_SHM_RING_SIZE, __ATOMIC_RELEASE);
+    __atomic_store_n(&self_ring->head, pos + 1, __ATOMIC_SEQ_CST);
+
+    return len;
+}
+
+const struct unix_radio_medium unix_radio_medium_shm = {
+    "shm",
+    shm_init,
+    shm_fd,
+    shm_transmit,
+    shm_receive,
+    shm_pending,
+};
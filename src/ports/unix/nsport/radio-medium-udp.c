@@ -0,0 +1,111 @@
+#include "ns/contiki.h"
+#include "radio-medium.h"
+#include "port_unix.h"
+#include <errno.h>
+
+// Loopback UDP medium: every frame is a datagram sent to the port of each
+// destination node. Without a topology the frame is sent to every port of
+// the well-known node id range.
+
+enum {
+    WELLKNOWN_NODE_ID = 34,
+};
+
+static int sock_fd = -1;
+static uint16_t self_node;
+
+int unix_radio_udp_open(uint16_t port)
+{
+    int fd;
+    struct sockaddr_in sockaddr;
+    memset(&sockaddr, 0, sizeof(sockaddr));
+    sockaddr.sin_family = AF_INET;
+    sockaddr.sin_port = htons(port);
+    sockaddr.sin_addr.s_addr = INADDR_ANY;
+
+    fd = (int)socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+
+    if (fd == -1) {
+        perror("socket");
+        exit(EXIT_FAILURE);
+    }
+
+    if (bind(fd, (struct sockaddr *)&sockaddr, sizeof(sockaddr)) == -1) {
+        perror("bind");
+        exit(EXIT_FAILURE);
+    }
+
+    return fd;
+}
+
+void unix_radio_udp_send(int fd, uint16_t port, const uint8_t *buf, uint8_t len)
+{
+    ssize_t rval;
+    struct sockaddr_in sockaddr;
+    memset(&sockaddr, 0, sizeof(sockaddr));
+    sockaddr.sin_family = AF_INET;
+    sockaddr.sin_port = htons(port);
+    sockaddr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    rval = sendto(fd, (const char *)buf, len, 0, (struct sockaddr *)&sockaddr, sizeof(sockaddr));
+    if (rval < 0) {
+        perror("sendto");
+        exit(EXIT_FAILURE);
+    }
+}
+
+static void udp_init(uint16_t node)
+{
+    self_node = node;
+    sock_fd = unix_radio_udp_open(UNIX_RADIO_BASE_PORT + node);
+}
+
+static int udp_fd(void)
+{
+    return sock_fd;
+}
+
+static void udp_transmit(const uint8_t *buf, uint8_t len, const uint16_t *dst, size_t dst_num)
+{
+    if (dst != NULL) {
+        for (size_t i = 0; i < dst_num; i++) {
+            if (dst[i] != self_node) {
+                unix_radio_udp_send(sock_fd, UNIX_RADIO_BASE_PORT + dst[i], buf, len);
+            }
+        }
+    } else {
+        for (uint16_t i = 0; i <= WELLKNOWN_NODE_ID; i++) {
+            if (i != self_node) {
+                unix_radio_udp_send(sock_fd, UNIX_RADIO_BASE_PORT + i, buf, len);
+            }
+        }
+    }
+}
+
+static int udp_receive(uint8_t *buf, uint8_t size)
+{
+    ssize_t rval = recv(sock_fd, (char *)buf, size, MSG_DONTWAIT);
+    if (rval < 0) {
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            return 0;
+        }
+        perror("recvfrom");
+        exit(EXIT_FAILURE);
+    }
+    return (int)rval;
+}
+
+static bool udp_pending(void)
+{
+    // the socket receive queue is reported through udp_fd()
+    return false;
+}
+
+const struct unix_radio_medium unix_radio_medium_udp = {
+    "udp",
+    udp_init,
+    udp_fd,
+    udp_transmit,
+    udp_receive,
+    udp_pending,
+};
@@ -0,0 +1,63 @@
+#ifndef NSPORT_RADIO_MEDIUM_H_
+#define NSPORT_RADIO_MEDIUM_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// every node owns a loopback UDP port (base + node id), the udp medium
+// carries the frames over it while the shm medium only uses it as doorbell
+#define UNIX_RADIO_BASE_PORT 9000
+
+#define UNIX_RADIO_FRAME_SIZE 127
+
+// highest node id that can be attached to the shm medium
+#ifdef UNIX_RADIO_CONF_MAX_NODES
+#define UNIX_RADIO_MAX_NODES UNIX_RADIO_CONF_MAX_NODES
+#else
+#define UNIX_RADIO_MAX_NODES 256
+#endif
+
+// number of frames each node can have waiting in its shm receive ring
+#ifdef UNIX_RADIO_CONF_SHM_RING_SIZE
+#define UNIX_RADIO_SHM_RING_SIZE UNIX_RADIO_CONF_SHM_RING_SIZE
+#else
+#define UNIX_RADIO_SHM_RING_SIZE 32
+#endif
+
+// maximum number of entries in this node topology (adjacency) table
+#ifdef UNIX_RADIO_CONF_MAX_NEIGHBORS
+#define UNIX_RADIO_MAX_NEIGHBORS UNIX_RADIO_CONF_MAX_NEIGHBORS
+#else
+#define UNIX_RADIO_MAX_NEIGHBORS 64
+#endif
+
+// medium used by unix_radio_driver, see unix_radio_medium_udp/shm
+#ifdef UNIX_RADIO_CONF_MEDIUM
+#define UNIX_RADIO_MEDIUM UNIX_RADIO_CONF_MEDIUM
+#else
+#define UNIX_RADIO_MEDIUM unix_radio_medium_shm
+#endif
+
+struct unix_radio_medium {
+    const char *name;
+    // attach this node to the medium
+    void (*init)(uint16_t node);
+    // file descriptor which becomes readable when frames are waiting
+    int (*fd)(void);
+    // deliver a frame to the given nodes, or to every node if dst is NULL
+    void (*transmit)(const uint8_t *buf, uint8_t len, const uint16_t *dst, size_t dst_num);
+    // fetch the next waiting frame, return its length or 0 if none
+    int (*receive)(uint8_t *buf, uint8_t size);
+    // frames are waiting even if fd() isn't readable
+    bool (*pending)(void);
+};
+
+extern const struct unix_radio_medium unix_radio_medium_udp;
+extern const struct unix_radio_medium unix_radio_medium_shm;
+
+// loopback UDP helpers shared by the mediums
+int unix_radio_udp_open(uint16_t port);
+void unix_radio_udp_send(int fd, uint16_t port, const uint8_t *buf, uint8_t len);
+
+#endif // NSPORT_RADIO_MEDIUM_H_
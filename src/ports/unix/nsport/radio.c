@@ -7,6 +7,7 @@
 #include "ns/net/mac/csma/csma.h"
 #include "ns/lib/py/nstd.h"
 #include "port_unix.h"
+#include "radio-medium.h"
 #include <stdbool.h>
 
 /* Log configuration */
@@ -14,12 +15,13 @@
 #define LOG_MODULE "RADIO"
 #define LOG_LEVEL LOG_LEVEL_RADIO
 
-#define DEFAULT_PORT 9000
 #define ACK_WAIT_TIME 100 // 100ms ack timeout
 
+// file with one "<node> <neighbor> <neighbor> ..." line per node
+#define TOPOLOGY_ENV "NESPY_RADIO_TOPOLOGY"
+
 enum {
-    WELLKNOWN_NODE_ID = 34,
-    UNIX_RADIO_BUFFER_SIZE = 127,
+    UNIX_RADIO_BUFFER_SIZE = UNIX_RADIO_FRAME_SIZE,
 };
 
 typedef enum _radio_state_t {
@@ -48,7 +50,10 @@ static bool radio_ack_wait = false;
 static uint32_t ack_timeout;
 static uint8_t radio_rx_buf[UNIX_RADIO_BUFFER_SIZE];
 static uint8_t radio_tx_buf[UNIX_RADIO_BUFFER_SIZE];
-static int sock_fd;
+static const struct unix_radio_medium *radio_medium = &UNIX_RADIO_MEDIUM;
+static uint16_t radio_neighbors[UNIX_RADIO_MAX_NEIGHBORS];
+static size_t radio_neighbors_num;
+static bool radio_has_topology = false;
 
 static void unix_radio_init(void);
 static void unix_radio_update(void);
@@ -94,6 +99,8 @@ PROCESS_THREAD(unix_radio_thread, ev, data)
 {
     PROCESS_BEGIN();
 
+    process_set_priority(PROCESS_CURRENT(), PROCESS_PRIORITY_MAC);
+
     while (1) {
         PROCESS_WAIT_EVENT_UNTIL(ev == PROCESS_EVENT_POLL);
         packetbuf_clear();
@@ -160,7 +167,7 @@ static int unix_transmit(unsigned short len)
 
     // wait until transmit process is finished
     while (radio_state == RADIO_STATE_TRANSMIT) {
-        unix_process_update();
+        unix_process_wait();
     }
 
     // reset transmit broadcast flag
@@ -236,40 +243,103 @@ static radio_result_t unix_set_object(radio_param_t param, const void *src, size
     return RADIO_RESULT_NOT_SUPPORTED;
 }
 
-static void unix_radio_init(void)
+static void unix_radio_load_topology(void)
 {
-    struct sockaddr_in sockaddr;
-    memset(&sockaddr, 0, sizeof(sockaddr));
-    radio_port = DEFAULT_PORT + node_id;
-    sockaddr.sin_family = AF_INET;
-    sockaddr.sin_port = htons(radio_port);
-    sockaddr.sin_addr.s_addr = INADDR_ANY;
+    char line[512];
+    const char *path = getenv(TOPOLOGY_ENV);
+    FILE *file;
 
-    sock_fd = (int)socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (path == NULL) {
+        return;
+    }
 
-    if (sock_fd == -1) {
-        perror("socket");
+    file = fopen(path, "r");
+    if (file == NULL) {
+        perror(TOPOLOGY_ENV);
         exit(EXIT_FAILURE);
     }
 
-    if (bind(sock_fd, (struct sockaddr *)&sockaddr, sizeof(sockaddr)) == -1) {
-        perror("bind");
+    while (fgets(line, sizeof(line), file) != NULL) {
+        uint16_t ids[UNIX_RADIO_MAX_NEIGHBORS];
+        size_t num = 0;
+        char *pos = line;
+        char *end;
+        long node = strtol(pos, &end, 10);
+
+        // skip empty lines, comments and other nodes
+        if (end == pos || node != node_id) {
+            continue;
+        }
+
+        for (pos = end; num < UNIX_RADIO_MAX_NEIGHBORS; pos = end) {
+            long id = strtol(pos, &end, 10);
+            if (end == pos) {
+                break;
+            }
+            ids[num++] = (uint16_t)id;
+        }
+
+        unix_radio_set_neighbors(ids, num);
+        break;
+    }
+
+    fclose(file);
+}
+
+static void unix_radio_init(void)
+{
+    radio_port = UNIX_RADIO_BASE_PORT + node_id;
+    if (unix_sim_enabled() && radio_medium != &unix_radio_medium_shm) {
+        fprintf(stderr, "radio: virtual time requires the shm medium\n");
         exit(EXIT_FAILURE);
     }
+    radio_medium->init(node_id);
+    unix_radio_load_topology();
+    LOG_INFO("medium %s, %s topology\r\n", radio_medium->name,
+             radio_has_topology ? "static" : "full");
+}
+
+void unix_radio_set_neighbors(const uint16_t *ids, size_t num)
+{
+    radio_neighbors_num = MIN(num, UNIX_RADIO_MAX_NEIGHBORS);
+    memcpy(radio_neighbors, ids, radio_neighbors_num * sizeof(uint16_t));
+    radio_has_topology = true;
+}
+
+bool unix_radio_pending(void)
+{
+    // frames waiting to be read or a frame waiting to be sent
+    return radio_medium->pending() ||
+           (radio_state == RADIO_STATE_TRANSMIT && !radio_ack_wait);
+}
+
+int unix_radio_fd(void)
+{
+    return radio_medium->fd();
+}
+
+bool unix_radio_ack_deadline(rtimer_clock_t *deadline)
+{
+    if (radio_ack_wait && deadline != NULL) {
+        // no-ack is detected once RTIMER_NOW() goes past ack_timeout
+        *deadline = (rtimer_clock_t)(ack_timeout + 1);
+    }
+    return radio_ack_wait;
 }
 
 void unix_radio_update_fd_set(fd_set *read_fd_set, fd_set *write_fd_set, int *max_fd)
 {
+    int fd = radio_medium->fd();
     if (read_fd_set != NULL && (radio_state != RADIO_STATE_TRANSMIT || radio_ack_wait)) {
-        FD_SET(sock_fd, read_fd_set);
-        if (max_fd != NULL && *max_fd < sock_fd) {
-            *max_fd = sock_fd;
+        FD_SET(fd, read_fd_set);
+        if (max_fd != NULL && *max_fd < fd) {
+            *max_fd = fd;
         }
     }
     if (write_fd_set != NULL && radio_state == RADIO_STATE_TRANSMIT && !radio_ack_wait) {
-        FD_SET(sock_fd, write_fd_set);
-        if (max_fd != NULL && *max_fd < sock_fd) {
-            *max_fd = sock_fd;
+        FD_SET(fd, write_fd_set);
+        if (max_fd != NULL && *max_fd < fd) {
+            *max_fd = fd;
         }
     }
 }
@@ -277,9 +347,10 @@ void unix_radio_update_fd_set(fd_set *read_fd_set, fd_set *write_fd_set, int *ma
 void unix_radio_process(void)
 {
     const int flags = POLLIN | POLLRDNORM | POLLERR | POLLNVAL | POLLHUP;
-    struct pollfd pollfd = {sock_fd, flags, 0};
+    struct pollfd pollfd = {radio_medium->fd(), flags, 0};
 
-    if (POLL(&pollfd, 1, 0) > 0 && (pollfd.revents & flags) != 0) {
+    if (radio_medium->pending() ||
+        (POLL(&pollfd, 1, 0) > 0 && (pollfd.revents & flags) != 0)) {
         unix_radio_update();
     }
 
@@ -332,35 +403,19 @@ void unix_radio_process(void)
 
 static void unix_radio_update(void)
 {
-    ssize_t rval = recvfrom(sock_fd, (char *)&radio_rx_buf, sizeof(radio_rx_buf), 0, NULL, NULL);
-    if (rval < 0) {
-        perror("recvfrom");
-        exit(EXIT_FAILURE);
+    int len = radio_medium->receive((uint8_t *)&radio_rx_buf, sizeof(radio_rx_buf));
+    if (len > 0) {
+        radio_rx_len = (uint8_t)len;
+        LOG_DBG("unix radio update recv (%d)\r\n", radio_rx_len);
     }
-    radio_rx_len = (uint8_t)rval;
-    LOG_DBG("unix radio update recv (%d)\r\n", radio_rx_len);
 }
 
 static void unix_radio_transmit(uint8_t *buf, uint8_t len)
 {
-    uint32_t i;
-    struct sockaddr_in sockaddr;
-    memset(&sockaddr, 0, sizeof(sockaddr));
-    sockaddr.sin_family = AF_INET;
-    inet_pton(AF_INET, "127.0.0.1", &sockaddr.sin_addr);
-
-    for (i = 0; i <= WELLKNOWN_NODE_ID; i++) {
-        ssize_t rval;
-        if (node_id == i) {
-            continue;
-        }
-        sockaddr.sin_port = htons(DEFAULT_PORT + i);
-        rval = sendto(sock_fd, (const char *)buf, len, 0, (struct sockaddr *)&sockaddr,
-                      sizeof(sockaddr));
-        if (rval < 0) {
-            perror("sendto");
-            exit(EXIT_FAILURE);
-        }
+    if (radio_has_topology) {
+        radio_medium->transmit(buf, len, radio_neighbors, radio_neighbors_num);
+    } else {
+        radio_medium->transmit(buf, len, NULL, 0);
     }
 }
 
@@ -6,7 +6,15 @@ static uint32_t state = 1;
 
 void random_init(unsigned short seed)
 {
-    state = (uint32_t)time(NULL) + (3600 * seed);
+    if (unix_sim_enabled()) {
+        // reproducible sequence per simulation seed and node
+        state = ((uint32_t)unix_sim_seed() + (3600 * seed)) & 0x7fffffff;
+        if (state == 0) {
+            state = 1;
+        }
+    } else {
+        state = (uint32_t)time(NULL) + (3600 * seed);
+    }
 }
 
 unsigned short random_rand(void)
@@ -34,6 +34,14 @@ void rtimer_alarm_process(void)
     }
 }
 
+bool rtimer_alarm_next(rtimer_clock_t *alarm)
+{
+    if (is_ms_running && alarm != NULL) {
+        *alarm = (rtimer_clock_t)ms_alarm;
+    }
+    return is_ms_running;
+}
+
 void rtimer_arch_init(void)
 {
     // init by clock_init();
@@ -0,0 +1,316 @@
+#include "ns/contiki.h"
+#include "ns/sys/node-id.h"
+#include "radio-medium.h"
+#include "port_unix.h"
+#include <errno.h>
+#include <sched.h>
+#include <sys/mman.h>
+
+// Virtual time for discrete-event simulation of many unix nodes.
+//
+// Enabled by setting NESPY_SIM_SEED in the environment of every node. All
+// nodes then map one shared segment holding the virtual clock and, per node,
+// whether it is busy and the virtual time of its next local deadline. Only
+// one node runs at a time, the one holding the turn, so a seeded run does the
+// same thing every time. A node that runs out of work hands the turn to the
+// busy node with the lowest id; once no node is busy the clock jumps straight
+// to the earliest deadline and the turn goes to the lowest id owning it. The
+// next node is woken up through its radio doorbell port. A frame sent to a
+// node also marks it busy, so time can't pass under an in-flight frame.
+// Requires the shm radio medium for frame delivery.
+//
+// A node that dies without detaching (killed, crashed) is found by its pid
+// and detached by the others, also when it dies holding the lock.
+
+#define SIM_CLOCK_NAME "/nespy-sim-clock"
+#define SIM_DEADLINE_NONE UINT64_MAX
+#define SIM_TURN_NONE UINT32_MAX
+// spins on the lock between checks that its holder is still alive
+#define SIM_LOCK_CHECK_SPINS 1024
+// how often (ms) a node waiting for its turn checks the running one
+#define SIM_WAIT_CHECK_MS 100
+
+typedef struct {
+    uint32_t attached;
+    uint32_t busy;
+    int32_t pid;
+    uint64_t deadline;
+} sim_node_t;
+
+typedef struct {
+    // pid of the node holding the lock, 0 if free
+    int32_t lock;
+    // id of the node running, SIM_TURN_NONE if none
+    uint32_t turn;
+    uint64_t now;
+    sim_node_t node[UNIX_RADIO_MAX_NODES];
+} sim_clock_t;
+
+static sim_clock_t *sim;
+static sim_node_t *self;
+static int32_t self_pid;
+static unsigned long sim_seed;
+static int wakeup_fd = -1;
+
+static bool sim_pid_alive(int32_t pid)
+{
+    return kill(pid, 0) == 0 || errno != ESRCH;
+}
+
+static void sim_lock(void)
+{
+    unsigned spins = 0;
+    int32_t owner = 0;
+
+    while (!__atomic_compare_exchange_n(&sim->lock, &owner, self_pid, false,
+                                        __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+        // a node that died holding the lock can't release it anymore
+        if (++spins % SIM_LOCK_CHECK_SPINS == 0 && !sim_pid_alive(owner) &&
+            __atomic_compare_exchange_n(&sim->lock, &owner, self_pid, false,
+                                        __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+            fprintf(stderr, "sim: lock holder %d died, taking the lock\n", (int)owner);
+            return;
+        }
+        owner = 0;
+        sched_yield();
+    }
+}
+
+static void sim_unlock(void)
+{
+    __atomic_store_n(&sim->lock, 0, __ATOMIC_RELEASE);
+}
+
+// detach a node that died, must hold the lock
+static bool sim_node_alive(uint32_t id)
+{
+    sim_node_t *n = &sim->node[id];
+
+    if (sim_pid_alive(n->pid)) {
+        return true;
+    }
+    fprintf(stderr, "sim: node %u died, detaching it\n", (unsigned)id);
+    n->attached = 0;
+    n->busy = 0;
+    n->deadline = SIM_DEADLINE_NONE;
+    if (sim->turn == id) {
+        sim->turn = SIM_TURN_NONE;
+    }
+    return false;
+}
+
+// give the turn to the next node if none is running, must hold the lock
+static void sim_schedule(void)
+{
+    while (sim->turn == SIM_TURN_NONE) {
+        uint64_t next = SIM_DEADLINE_NONE;
+        uint32_t id = SIM_TURN_NONE;
+        uint32_t i;
+        sim_node_t *n;
+
+        // busy nodes first, lowest id first
+        for (i = 0; i < UNIX_RADIO_MAX_NODES; i++) {
+            n = &sim->node[i];
+            if (n->attached && __atomic_load_n(&n->busy, __ATOMIC_SEQ_CST)) {
+                id = i;
+                break;
+            }
+        }
+
+        // else the earliest deadline, lowest id first on a tie
+        if (id == SIM_TURN_NONE) {
+            for (i = 0; i < UNIX_RADIO_MAX_NODES; i++) {
+                n = &sim->node[i];
+                if (n->attached && n->deadline < next) {
+                    next = n->deadline;
+                    id = i;
+                }
+            }
+            if (id == SIM_TURN_NONE) {
+                return;
+            }
+            if (next > sim->now) {
+                __atomic_store_n(&sim->now, next, __ATOMIC_RELEASE);
+            }
+            n = &sim->node[id];
+            n->deadline = SIM_DEADLINE_NONE;
+            __atomic_store_n(&n->busy, 1, __ATOMIC_SEQ_CST);
+        }
+
+        if (!sim_node_alive(id)) {
+            continue;
+        }
+        sim->turn = id;
+        if (&sim->node[id] != self) {
+            const uint8_t doorbell = 0;
+            unix_radio_udp_send(wakeup_fd, UNIX_RADIO_BASE_PORT + id, &doorbell, 1);
+        }
+    }
+}
+
+// block (in real time) until this node holds the turn
+static void sim_wait_turn(void)
+{
+    while (1) {
+        uint8_t doorbell[16];
+        struct pollfd pollfd;
+        bool run;
+
+        sim_lock();
+        if (sim->turn != SIM_TURN_NONE && sim->turn != node_id &&
+            !sim_node_alive(sim->turn)) {
+            sim_schedule();
+        }
+        run = sim->turn == node_id;
+        sim_unlock();
+
+        if (run) {
+            return;
+        }
+
+        // the turn rings the radio doorbell, frames that rang it stay in
+        // the shm ring for when we run
+        pollfd.fd = unix_radio_fd();
+        pollfd.events = POLLIN;
+        pollfd.revents = 0;
+        if (pollfd.fd < 0) {
+            // radio not up yet, still booting
+            usleep(SIM_WAIT_CHECK_MS * 1000 / 10);
+        } else if (POLL(&pollfd, 1, SIM_WAIT_CHECK_MS) > 0) {
+            while (recv(pollfd.fd, (char *)doorbell, sizeof(doorbell), MSG_DONTWAIT) > 0) {
+                // discard
+            }
+        }
+    }
+}
+
+static void sim_detach(void)
+{
+    sim_lock();
+    self->attached = 0;
+    self->busy = 0;
+    self->deadline = SIM_DEADLINE_NONE;
+    if (sim->turn == node_id) {
+        sim->turn = SIM_TURN_NONE;
+    }
+    sim_schedule();
+    sim_unlock();
+}
+
+static bool sim_any_attached(void)
+{
+    bool any = false;
+
+    for (uint16_t i = 0; i < UNIX_RADIO_MAX_NODES; i++) {
+        if (sim->node[i].attached && sim_node_alive(i)) {
+            any = true;
+        }
+    }
+    return any;
+}
+
+void unix_sim_init(void)
+{
+    const char *seed = getenv(UNIX_SIM_SEED_ENV);
+    int fd;
+
+    if (seed == NULL || sim != NULL) {
+        return;
+    }
+
+    if (node_id >= UNIX_RADIO_MAX_NODES) {
+        fprintf(stderr, "sim: node id %u exceeds simulation size (%u)\n",
+                node_id, UNIX_RADIO_MAX_NODES);
+        exit(EXIT_FAILURE);
+    }
+
+    fd = shm_open(SIM_CLOCK_NAME, O_RDWR | O_CREAT, 0600);
+    if (fd == -1) {
+        perror("shm_open");
+        exit(EXIT_FAILURE);
+    }
+
+    if (ftruncate(fd, sizeof(sim_clock_t)) == -1) {
+        perror("ftruncate");
+        exit(EXIT_FAILURE);
+    }
+
+    sim = mmap(NULL, sizeof(sim_clock_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (sim == MAP_FAILED) {
+        perror("mmap");
+        exit(EXIT_FAILURE);
+    }
+    close(fd);
+
+    wakeup_fd = (int)socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (wakeup_fd == -1) {
+        perror("socket");
+        exit(EXIT_FAILURE);
+    }
+
+    sim_seed = strtoul(seed, NULL, 0);
+    self = &sim->node[node_id];
+    self_pid = (int32_t)getpid();
+
+    sim_lock();
+    // the first node attaching starts a new simulation at time zero
+    if (!sim_any_attached()) {
+        sim->now = 0;
+        sim->turn = SIM_TURN_NONE;
+    }
+    self->pid = self_pid;
+    self->attached = 1;
+    self->busy = 1;
+    self->deadline = SIM_DEADLINE_NONE;
+    sim_schedule();
+    sim_unlock();
+
+    atexit(sim_detach);
+
+    // booting is a turn like any other
+    sim_wait_turn();
+}
+
+bool unix_sim_enabled(void)
+{
+    return sim != NULL;
+}
+
+unsigned long unix_sim_seed(void)
+{
+    return sim_seed;
+}
+
+clock_time_t unix_sim_now(void)
+{
+    return (clock_time_t)__atomic_load_n(&sim->now, __ATOMIC_ACQUIRE);
+}
+
+void unix_sim_node_busy(uint16_t node)
+{
+    sim_node_t *n;
+
+    if (sim == NULL || node >= UNIX_RADIO_MAX_NODES) {
+        return;
+    }
+
+    n = &sim->node[node];
+    if (__atomic_load_n(&n->attached, __ATOMIC_ACQUIRE)) {
+        __atomic_store_n(&n->busy, 1, __ATOMIC_SEQ_CST);
+    }
+}
+
+void unix_sim_idle(clock_time_t wait)
+{
+    sim_lock();
+
+    // only the running node gets here, so no frame can be on its way to us
+    self->deadline = sim->now + wait;
+    __atomic_store_n(&self->busy, unix_radio_pending() ? 1 : 0, __ATOMIC_SEQ_CST);
+    sim->turn = SIM_TURN_NONE;
+    sim_schedule();
+
+    sim_unlock();
+
+    sim_wait_turn();
+}
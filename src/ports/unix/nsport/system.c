@@ -1,17 +1,14 @@
+#include "ns/contiki.h"
 #include "port_unix.h"
 #include <errno.h>
 
-void unix_process_update(void)
+static void unix_process_select(struct timeval *timeout)
 {
     fd_set read_fds;
     fd_set write_fds;
     fd_set error_fds;
     int max_fd = -1;
     int rval;
-    struct timeval timeout;
-
-    timeout.tv_sec = 0;
-    timeout.tv_usec = 0;
 
     FD_ZERO(&read_fds);
     FD_ZERO(&write_fds);
@@ -19,8 +16,9 @@ void unix_process_update(void)
 
     unix_uart_update_fd_set(&read_fds, &write_fds, &error_fds, &max_fd);
     unix_radio_update_fd_set(&read_fds, &write_fds, &max_fd);
+    unix_clock_update_fd_set(&read_fds, &max_fd);
 
-    rval = select(max_fd + 1, &read_fds, &write_fds, &error_fds, &timeout);
+    rval = select(max_fd + 1, &read_fds, &write_fds, &error_fds, timeout);
 
     if ((rval < 0) && (errno != EINTR))
     {
@@ -33,3 +31,72 @@ void unix_process_update(void)
     rtimer_alarm_process();
     etimer_pending_process();
 }
+
+// time (in clock ticks) we can sleep before the netstack has work to do
+static clock_time_t unix_process_next_wait_time(void)
+{
+    clock_time_t wait = UNIX_PROCESS_MAX_WAIT_TIME;
+    rtimer_clock_t alarm;
+
+    if (process_nevents() > 0 || unix_radio_pending()) {
+        return 0;
+    }
+
+    // with a deadline timer armed the etimer wakes us up through its fd
+    if (etimer_pending() && !unix_clock_timer_active()) {
+        clock_time_t now = clock_time();
+        clock_time_t next = etimer_next_expiration_time();
+        if ((long)(next - now) <= 0) {
+            return 0;
+        }
+        wait = MIN(wait, next - now);
+    }
+
+    if (rtimer_alarm_next(&alarm)) {
+        rtimer_clock_t now = rtimer_arch_now();
+        if (!RTIMER_CLOCK_LT(now, alarm)) {
+            return 0;
+        }
+        wait = MIN(wait, (clock_time_t)(alarm - now) * (CLOCK_SECOND / RTIMER_ARCH_SECOND));
+    }
+
+    if (unix_radio_ack_deadline(&alarm)) {
+        rtimer_clock_t now = rtimer_arch_now();
+        if (!RTIMER_CLOCK_LT(now, alarm)) {
+            return 0;
+        }
+        wait = MIN(wait, (clock_time_t)(alarm - now) * (CLOCK_SECOND / RTIMER_ARCH_SECOND));
+    }
+
+    return wait;
+}
+
+void unix_process_update(void)
+{
+    struct timeval timeout;
+
+    timeout.tv_sec = 0;
+    timeout.tv_usec = 0;
+
+    unix_process_select(&timeout);
+}
+
+void unix_process_wait(void)
+{
+    struct timeval timeout;
+    clock_time_t wait = unix_process_next_wait_time();
+
+    if (unix_sim_enabled()) {
+        // virtual time doesn't pass while we sleep, we only block (in real
+        // time) until it is our turn again
+        if (wait > 0) {
+            unix_sim_idle(wait);
+        }
+        wait = 0;
+    }
+
+    timeout.tv_sec = wait / US_PER_S;
+    timeout.tv_usec = wait % US_PER_S;
+
+    unix_process_select(&timeout);
+}